@@ -0,0 +1,74 @@
+#include "AllocationCounter.h"
+
+#ifdef FRACTAL_COUNT_ALLOCATIONS
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#ifdef _MSC_VER
+#include <malloc.h>
+#endif
+
+namespace {
+	std::atomic<std::uint64_t> allocations{ 0 };
+
+	// MSVC's free cannot release aligned blocks, so they get their own pair of calls
+	void* alignedMalloc(std::size_t size, std::size_t alignment) {
+#ifdef _MSC_VER
+		return _aligned_malloc(size, alignment);
+#else
+		// aligned_alloc wants a whole number of alignments
+		return std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+#endif
+	}
+
+	void alignedFree(void* memory) {
+#ifdef _MSC_VER
+		_aligned_free(memory);
+#else
+		std::free(memory);
+#endif
+	}
+}
+
+// The array forms call these by default, so replacing the scalar ones covers both.
+void* operator new(std::size_t size) {
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	if (void* memory = std::malloc(size ? size : 1)) {
+		return memory;
+	}
+	throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept {
+	std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept {
+	std::free(memory);
+}
+
+// Types over-aligned with alignas, such as ThreadPool's blocks, come through these instead
+void* operator new(std::size_t size, std::align_val_t alignment) {
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	if (void* memory = alignedMalloc(size ? size : 1, static_cast<std::size_t>(alignment))) {
+		return memory;
+	}
+	throw std::bad_alloc();
+}
+
+void operator delete(void* memory, std::align_val_t) noexcept {
+	alignedFree(memory);
+}
+
+void operator delete(void* memory, std::size_t, std::align_val_t) noexcept {
+	alignedFree(memory);
+}
+
+std::uint64_t allocationCount() {
+	return allocations.load(std::memory_order_relaxed);
+}
+#else
+std::uint64_t allocationCount() {
+	return 0;
+}
+#endif
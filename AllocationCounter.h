@@ -0,0 +1,10 @@
+#pragma once
+
+#include <cstdint>
+
+// Number of heap allocations made through operator new so far, over-aligned ones included.
+// Counting is only compiled in when FRACTAL_COUNT_ALLOCATIONS is defined, as the Debug
+// configurations do, which replaces the global operator new; otherwise this always
+// returns 0. The frame loop compares it before and after a frame to
+// check the steady state allocates nothing.
+std::uint64_t allocationCount();
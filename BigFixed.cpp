@@ -0,0 +1,198 @@
+#include "BigFixed.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+	void negateLimbs(std::uint32_t* limbs, int count) {
+		std::uint64_t carry = 1;
+		for (int i = 0; i < count; ++i) {
+			carry += static_cast<std::uint32_t>(~limbs[i]);
+			limbs[i] = static_cast<std::uint32_t>(carry);
+			carry >>= 32;
+		}
+	}
+
+	// out[0, 2n) = a * b for n < KARATSUBA_LIMBS. The partial products are summed as
+	// separate 32-bit halves into 64-bit columns, which cannot overflow below 2^32 terms,
+	// so the loop over b carries nothing from one step to the next and vectorizes. The
+	// carries are resolved in a single pass at the end.
+	void schoolbook(const std::uint32_t* a, const std::uint32_t* b, int n, std::uint32_t* out) {
+		std::uint64_t low[2 * BigFixed::KARATSUBA_LIMBS];
+		std::uint64_t high[2 * BigFixed::KARATSUBA_LIMBS];
+		std::fill_n(low, 2 * n, 0);
+		std::fill_n(high, 2 * n, 0);
+		for (int i = 0; i < n; ++i) {
+			const std::uint64_t ai = a[i];
+			std::uint64_t* lowRow = low + i;
+			std::uint64_t* highRow = high + i;
+			for (int j = 0; j < n; ++j) {
+				const std::uint64_t p = ai * b[j];
+				lowRow[j] += static_cast<std::uint32_t>(p);
+				highRow[j] += p >> 32;
+			}
+		}
+		std::uint64_t carry = 0;
+		for (int k = 0; k < 2 * n; ++k) {
+			carry += low[k] + (k > 0 ? high[k - 1] : 0);
+			out[k] = static_cast<std::uint32_t>(carry);
+			carry >>= 32;
+		}
+	}
+
+	// Limbs of scratch space karatsuba needs for n-limb operands
+	int scratchLimbs(int n) {
+		if (n < BigFixed::KARATSUBA_LIMBS) {
+			return 0;
+		}
+		const int k = n - n / 2;
+		return 4 * (k + 1) + scratchLimbs(k + 1);
+	}
+
+	// out[0, 2n) = a * b. With a = a1 B^m + a0 and likewise b, the middle term
+	// a0 b1 + a1 b0 is (a0 + a1)(b0 + b1) - a0 b0 - a1 b1, so three half-size products
+	// take the place of four.
+	void karatsuba(const std::uint32_t* a, const std::uint32_t* b, int n, std::uint32_t* out, std::uint32_t* scratch) {
+		if (n < BigFixed::KARATSUBA_LIMBS) {
+			schoolbook(a, b, n, out);
+			return;
+		}
+		const int m = n / 2;
+		const int k = n - m;
+		karatsuba(a, b, m, out, scratch);
+		karatsuba(a + m, b + m, k, out + 2 * m, scratch);
+
+		std::uint32_t* sumA = scratch;
+		std::uint32_t* sumB = sumA + k + 1;
+		std::uint32_t* middle = sumB + k + 1;
+		std::uint64_t carryA = 0;
+		std::uint64_t carryB = 0;
+		for (int i = 0; i < k; ++i) {
+			carryA += static_cast<std::uint64_t>(a[m + i]) + (i < m ? a[i] : 0);
+			carryB += static_cast<std::uint64_t>(b[m + i]) + (i < m ? b[i] : 0);
+			sumA[i] = static_cast<std::uint32_t>(carryA);
+			sumB[i] = static_cast<std::uint32_t>(carryB);
+			carryA >>= 32;
+			carryB >>= 32;
+		}
+		sumA[k] = static_cast<std::uint32_t>(carryA);
+		sumB[k] = static_cast<std::uint32_t>(carryB);
+		karatsuba(sumA, sumB, k + 1, middle, middle + 2 * (k + 1));
+
+		// middle -= a0 b0 + a1 b1, which never goes negative
+		std::int64_t borrow = 0;
+		for (int i = 0; i < 2 * (k + 1); ++i) {
+			borrow += static_cast<std::int64_t>(middle[i]) - (i < 2 * m ? out[i] : 0) - (i < 2 * k ? out[2 * m + i] : 0);
+			middle[i] = static_cast<std::uint32_t>(borrow);
+			borrow >>= 32;
+		}
+
+		std::uint64_t carry = 0;
+		for (int i = m; i < 2 * n; ++i) {
+			carry += static_cast<std::uint64_t>(out[i]) + (i - m < 2 * (k + 1) ? middle[i - m] : 0);
+			out[i] = static_cast<std::uint32_t>(carry);
+			carry >>= 32;
+		}
+	}
+}
+
+BigFixed::BigFixed(int fractionLimbs, double value) : BigFixed(fractionLimbs, FloatExp(value)) {}
+
+BigFixed::BigFixed(int fractionLimbs, const FloatExp& value) : limbs(static_cast<size_t>(fractionLimbs) + 1, 0u) {
+	if (value.getMantissa() == 0.0 || !std::isfinite(value.getMantissa())) {
+		return;
+	}
+	// The mantissa is in [1, 2), so its 53 bits make an integer times 2^(exponent - 52)
+	const std::uint64_t mantissa = static_cast<std::uint64_t>(std::ldexp(std::abs(value.getMantissa()), 52));
+	// Bit b of the mantissa lands on bit `lowest + b` of the limbs; the sign bit stays clear
+	const std::int64_t lowest = 32 * static_cast<std::int64_t>(fractionLimbs) + value.getExponent() - 52;
+	const std::int64_t top = 32 * static_cast<std::int64_t>(limbs.size()) - 1;
+	for (int b = 0; b < 53; ++b) {
+		const std::int64_t bit = lowest + b;
+		if (bit >= 0 && bit < top && ((mantissa >> b) & 1u)) {
+			limbs[bit / 32] |= 1u << (bit % 32);
+		}
+	}
+	if (value.getMantissa() < 0.0) {
+		negate();
+	}
+}
+
+void BigFixed::negate() {
+	negateLimbs(limbs.data(), static_cast<int>(limbs.size()));
+}
+
+double BigFixed::toDouble() const {
+	return toFloatExp().toDouble();
+}
+
+FloatExp BigFixed::toFloatExp() const {
+	thread_local std::vector<std::uint32_t> magnitude;
+	magnitude = limbs;
+	const bool negative = isNegative();
+	if (negative) {
+		negateLimbs(magnitude.data(), static_cast<int>(magnitude.size()));
+	}
+
+	int top = static_cast<int>(magnitude.size()) - 1;
+	while (top >= 0 && magnitude[top] == 0) {
+		--top;
+	}
+	if (top < 0) {
+		return FloatExp();
+	}
+	// Three limbs hold at least 65 significant bits, more than a double keeps
+	const int lowest = std::max(top - 2, 0);
+	double value = 0.0;
+	for (int i = top; i >= lowest; --i) {
+		value = value * 4294967296.0 + magnitude[i];
+	}
+	return FloatExp(negative ? -value : value, 32 * static_cast<std::int64_t>(lowest - getFractionLimbs()));
+}
+
+BigFixed& BigFixed::operator+=(const BigFixed& other) {
+	std::uint64_t carry = 0;
+	for (size_t i = 0; i < limbs.size(); ++i) {
+		carry += static_cast<std::uint64_t>(limbs[i]) + other.limbs[i];
+		limbs[i] = static_cast<std::uint32_t>(carry);
+		carry >>= 32;
+	}
+	return *this;
+}
+
+BigFixed& BigFixed::operator-=(const BigFixed& other) {
+	std::int64_t borrow = 0;
+	for (size_t i = 0; i < limbs.size(); ++i) {
+		borrow += static_cast<std::int64_t>(limbs[i]) - other.limbs[i];
+		limbs[i] = static_cast<std::uint32_t>(borrow);
+		borrow >>= 32;
+	}
+	return *this;
+}
+
+void BigFixed::multiply(const BigFixed& a, const BigFixed& b, BigFixed& product) {
+	// Per thread, so concurrent products neither share nor reallocate them
+	thread_local std::vector<std::uint32_t> magnitudeA;
+	thread_local std::vector<std::uint32_t> magnitudeB;
+	thread_local std::vector<std::uint32_t> wide;
+	thread_local std::vector<std::uint32_t> scratch;
+
+	const int n = static_cast<int>(a.limbs.size());
+	magnitudeA = a.limbs;
+	magnitudeB = b.limbs;
+	if (a.isNegative()) {
+		negateLimbs(magnitudeA.data(), n);
+	}
+	if (b.isNegative()) {
+		negateLimbs(magnitudeB.data(), n);
+	}
+	wide.resize(2 * static_cast<size_t>(n));
+	scratch.resize(static_cast<size_t>(scratchLimbs(n)) + 1);
+	karatsuba(magnitudeA.data(), magnitudeB.data(), n, wide.data(), scratch.data());
+
+	// Dropping the low fraction limbs puts the point back in place
+	const int fractionLimbs = n - 1;
+	std::copy(wide.begin() + fractionLimbs, wide.begin() + fractionLimbs + n, product.limbs.begin());
+	if (a.isNegative() != b.isNegative()) {
+		product.negate();
+	}
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "FloatExp.h"
+#include <cstdint>
+#include <vector>
+
+// Fixed-point number of arbitrary precision, for reference orbits past the reach of a
+// double. The limbs are 32-bit, least significant first, in two's complement over the
+// whole number; the top limb is the integer part and the rest are the fraction. The limb
+// count is fixed when a number is made, and all operands of one operation must share it.
+//
+// 32-bit limbs keep every partial product in a 64-bit integer, so the schoolbook kernel is
+// plain unsigned multiplies and adds with no carry chain in the inner loop, which the
+// compiler turns into vector code (vpmuludq on AVX2). Longer products split with
+// Karatsuba down to that kernel.
+class BigFixed {
+private:
+	std::vector<std::uint32_t> limbs;
+
+	void negate();
+
+public:
+	// Below this many limbs products go straight to the schoolbook kernel
+	static constexpr int KARATSUBA_LIMBS = 32;
+
+	// Fraction limbs needed for `bits` bits after the point
+	static int limbsForBits(int bits) { return (bits + 31) / 32; }
+
+	BigFixed() = default;
+	// Exact for any double that fits the integer limb and the fraction bits
+	explicit BigFixed(int fractionLimbs, double value = 0.0);
+	// The same for a FloatExp; bits below the fraction limbs are dropped
+	BigFixed(int fractionLimbs, const FloatExp& value);
+
+	int getFractionLimbs() const { return static_cast<int>(limbs.size()) - 1; }
+	bool isNegative() const { return !limbs.empty() && (limbs.back() & 0x80000000u); }
+
+	// Rounded to the nearest double from the top three non-zero limbs, so limbs below those
+	// only matter at a tie; values below the double range become 0
+	double toDouble() const;
+	// Rounded the same way, but without the range limit of a double
+	FloatExp toFloatExp() const;
+
+	BigFixed& operator+=(const BigFixed& other);
+	BigFixed& operator-=(const BigFixed& other);
+
+	// product = a * b, truncated to the fraction limbs. product must already have the
+	// operands' limb count and may not be either of them. Safe to call from several
+	// threads at once, each with its own product.
+	static void multiply(const BigFixed& a, const BigFixed& b, BigFixed& product);
+};
@@ -0,0 +1,304 @@
+#include "Buddhabrot.h"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <type_traits>
+
+namespace {
+	// The main cardioid and the period-2 bulb of the Mandelbrot set: orbits starting there
+	// never escape
+	bool insideCardioidOrBulb(double x, double y) {
+		const double shifted = x - 0.25;
+		const double q = shifted * shifted + y * y;
+		if (q * (q + shifted) <= 0.25 * y * y) {
+			return true;
+		}
+		return (x + 1.0) * (x + 1.0) + y * y <= 1.0 / 16.0;
+	}
+}
+
+// Replays the orbit from (px, py) that escaped after `steps` iterations and calls
+// visit(pixel) for each of its points inside the view
+template<class Kernel, class Visit>
+void Buddhabrot::traceOrbit(double px, double py, int steps, const KernelParams& params, const Mapping& mapping, const Visit& visit) {
+	double x = Kernel::julia ? px : 0.0;
+	double y = Kernel::julia ? py : 0.0;
+	const double cx = Kernel::julia ? params.juliaX : px;
+	const double cy = Kernel::julia ? params.juliaY : py;
+	// The points before the escape; the last one is past the bailout
+	for (int i = 1; i < steps; ++i) {
+		Kernel::step(x, y, cx, cy);
+		const double column = (x - mapping.xMin) * mapping.xScale;
+		const double row = (mapping.yMax - y) * mapping.yScale;
+		if (column >= 0.0 && row >= 0.0 && column < mapping.width && row < mapping.height) {
+			visit(static_cast<std::uint32_t>(row) * static_cast<std::uint32_t>(mapping.width) + static_cast<std::uint32_t>(column));
+		}
+	}
+}
+
+void Buddhabrot::resize(int newWidth, int newHeight) {
+	width = newWidth;
+	height = newHeight;
+	const size_t pixels = static_cast<size_t>(width) * height;
+	ThreadPool& pool = ThreadPool::shared();
+	const int workers = pool.getWorkerCount();
+
+	// Every worker allocates and clears its own buffer, so it lands on the worker's node
+	workerDensity.assign(workers, FirstTouchVector<float>());
+	pool.parallelFor(workers, [&](int, int worker) {
+		if (workerDensity[worker].size() != pixels) {
+			workerDensity[worker] = FirstTouchVector<float>(pixels);
+			std::fill(workerDensity[worker].begin(), workerDensity[worker].end(), 0.0f);
+		}
+	});
+	// One whose index another worker took first
+	for (FirstTouchVector<float>& buffer : workerDensity) {
+		if (buffer.size() != pixels) {
+			buffer = FirstTouchVector<float>(pixels);
+			std::fill(buffer.begin(), buffer.end(), 0.0f);
+		}
+	}
+
+	density = FirstTouchVector<float>(pixels);
+	field = FirstTouchVector<float>(pixels);
+	pool.parallelFor(height, [&](int row, int) {
+		const size_t offset = static_cast<size_t>(row) * width;
+		std::fill(density.begin() + offset, density.begin() + offset + width, 0.0f);
+		std::fill(field.begin() + offset, field.begin() + offset + width, -1.0f);
+	});
+	rowPeak.assign(height, 0.0f);
+	rowSum.assign(height, 0.0);
+	rowFilled.assign(height, 0);
+
+	streams = std::vector<Stream>(workers);
+	for (int i = 0; i < workers; ++i) {
+		streams[i].random.seed(0x9E3779B97F4A7C15ull * (i + 1));
+		streams[i].chains.resize(kernelLanes<double>);
+	}
+	orbitCount = 0;
+}
+
+void Buddhabrot::restart(const View& newView) {
+	view = newView;
+	metropolis = std::max(view.xRange, view.yRange) < METROPOLIS_RANGE;
+	ThreadPool::shared().parallelFor(height, [&](int row, int) {
+		const size_t offset = static_cast<size_t>(row) * width;
+		std::fill(density.begin() + offset, density.begin() + offset + width, 0.0f);
+		for (FirstTouchVector<float>& buffer : workerDensity) {
+			std::fill(buffer.begin() + offset, buffer.begin() + offset + width, 0.0f);
+		}
+	});
+	for (Stream& stream : streams) {
+		for (Chain& chain : stream.chains) {
+			chain.pixels.clear();
+			chain.stay = 0;
+		}
+		stream.proposals = 0;
+		stream.accepted = 0;
+	}
+	orbitCount = 0;
+}
+
+template<class Kernel>
+void Buddhabrot::traceUniform(Stream& stream, float* target, int orbits, const Mapping& mapping, const KernelParams& params) {
+	constexpr int Lanes = kernelLanes<double>;
+	constexpr bool FILTER = std::is_same_v<Kernel, MandelbrotKernel>;
+	double px[Lanes], py[Lanes], zx[Lanes], zy[Lanes];
+	float values[Lanes];
+	int steps[Lanes];
+	std::uniform_real_distribution<double> plane(-SAMPLE_RADIUS, SAMPLE_RADIUS);
+
+	for (int start = 0; start < orbits; start += Lanes) {
+		for (int l = 0; l < Lanes; ++l) {
+			do {
+				px[l] = plane(stream.random);
+				py[l] = plane(stream.random);
+			} while (FILTER && insideCardioidOrBulb(px[l], py[l]));
+		}
+		iterateBatch<Kernel, double>(px, py, zx, zy, values, steps, params);
+		for (int l = 0; l < Lanes; ++l) {
+			if (steps[l] > 0) {
+				traceOrbit<Kernel>(px[l], py[l], steps[l], params, mapping, [target](std::uint32_t pixel) { target[pixel] += 1.0f; });
+			}
+		}
+	}
+}
+
+// One chain per lane, so the proposals of a round are escape-tested as one batch. A chain
+// that stays on its point for n proposals has that orbit recorded once with weight n / f,
+// f being the orbit's points in the view, when it finally moves or the call ends.
+template<class Kernel>
+void Buddhabrot::traceMetropolis(Stream& stream, float* target, int orbits, const Mapping& mapping, const KernelParams& params) {
+	constexpr int Lanes = kernelLanes<double>;
+	constexpr bool FILTER = std::is_same_v<Kernel, MandelbrotKernel>;
+	double px[Lanes], py[Lanes], zx[Lanes], zy[Lanes];
+	float values[Lanes];
+	int steps[Lanes];
+	bool rejected[Lanes];
+	std::uniform_real_distribution<double> unit(0.0, 1.0);
+
+	// Small mutations are spread log-uniformly between a ten-thousandth and a tenth of the view
+	const double extent = std::max(mapping.width / mapping.xScale, mapping.height / mapping.yScale);
+	const double farRadius = extent * 0.1;
+	const double nearRadius = extent * 1e-4;
+	const double twoPi = 6.283185307179586;
+
+	auto record = [target](Chain& chain) {
+		const float weight = static_cast<float>(chain.stay) / static_cast<float>(chain.pixels.size());
+		for (std::uint32_t pixel : chain.pixels) {
+			target[pixel] += weight;
+		}
+		chain.stay = 0;
+	};
+
+	for (int start = 0; start < orbits; start += Lanes) {
+		for (int l = 0; l < Lanes; ++l) {
+			const Chain& chain = stream.chains[l];
+			if (chain.pixels.empty()) {
+				// Seeds come from the view itself, where z1 = c already counts for the Mandelbrot set
+				px[l] = mapping.xMin + unit(stream.random) * mapping.width / mapping.xScale;
+				py[l] = mapping.yMax - unit(stream.random) * mapping.height / mapping.yScale;
+			}
+			else if (unit(stream.random) < LARGE_MUTATION) {
+				px[l] = (unit(stream.random) * 2.0 - 1.0) * SAMPLE_RADIUS;
+				py[l] = (unit(stream.random) * 2.0 - 1.0) * SAMPLE_RADIUS;
+			}
+			else {
+				const double radius = farRadius * std::exp(std::log(nearRadius / farRadius) * unit(stream.random));
+				const double angle = twoPi * unit(stream.random);
+				px[l] = chain.x + radius * std::cos(angle);
+				py[l] = chain.y + radius * std::sin(angle);
+			}
+			rejected[l] = FILTER && insideCardioidOrBulb(px[l], py[l]);
+		}
+
+		double testX[Lanes], testY[Lanes];
+		for (int l = 0; l < Lanes; ++l) {
+			// A point far outside escapes at once instead of holding the batch to the limit
+			testX[l] = rejected[l] ? 2.0 * SAMPLE_RADIUS : px[l];
+			testY[l] = rejected[l] ? 2.0 * SAMPLE_RADIUS : py[l];
+		}
+		iterateBatch<Kernel, double>(testX, testY, zx, zy, values, steps, params);
+
+		for (int l = 0; l < Lanes; ++l) {
+			Chain& chain = stream.chains[l];
+			std::vector<std::uint32_t>& proposal = stream.proposal;
+			proposal.clear();
+			if (!rejected[l] && steps[l] > 0) {
+				traceOrbit<Kernel>(px[l], py[l], steps[l], params, mapping, [&proposal](std::uint32_t pixel) { proposal.push_back(pixel); });
+			}
+
+			if (chain.pixels.empty()) {
+				if (!proposal.empty()) {
+					chain.x = px[l];
+					chain.y = py[l];
+					chain.pixels.swap(proposal);
+					chain.stay = 1;
+				}
+				continue;
+			}
+
+			// Both kinds of proposal are symmetric, so the acceptance is the ratio of the counts
+			++stream.proposals;
+			const double current = static_cast<double>(chain.pixels.size());
+			if (!proposal.empty() && unit(stream.random) * current < static_cast<double>(proposal.size())) {
+				record(chain);
+				chain.x = px[l];
+				chain.y = py[l];
+				chain.pixels.swap(proposal);
+				chain.stay = 1;
+				++stream.accepted;
+			}
+			else {
+				++chain.stay;
+			}
+		}
+	}
+
+	for (Chain& chain : stream.chains) {
+		if (chain.stay > 0) {
+			record(chain);
+		}
+	}
+}
+
+void Buddhabrot::accumulate(double centerX, double centerY, double xRange, double yRange, Formula formula, const KernelParams& params, int orbits) {
+	const View newView{ centerX, centerY, xRange, yRange, formula, params.juliaX, params.juliaY, params.maxIterations };
+	if (orbitCount == 0 || !(newView == view)) {
+		restart(newView);
+	}
+
+	using Trace = void (Buddhabrot::*)(Stream&, float*, int, const Mapping&, const KernelParams&);
+	Trace trace;
+	switch (formula) {
+	case Formula::Multibrot3: trace = metropolis ? &Buddhabrot::traceMetropolis<Multibrot3Kernel> : &Buddhabrot::traceUniform<Multibrot3Kernel>; break;
+	case Formula::Multibrot4: trace = metropolis ? &Buddhabrot::traceMetropolis<Multibrot4Kernel> : &Buddhabrot::traceUniform<Multibrot4Kernel>; break;
+	case Formula::Multibrot5: trace = metropolis ? &Buddhabrot::traceMetropolis<Multibrot5Kernel> : &Buddhabrot::traceUniform<Multibrot5Kernel>; break;
+	case Formula::BurningShip: trace = metropolis ? &Buddhabrot::traceMetropolis<BurningShipKernel> : &Buddhabrot::traceUniform<BurningShipKernel>; break;
+	case Formula::Tricorn: trace = metropolis ? &Buddhabrot::traceMetropolis<TricornKernel> : &Buddhabrot::traceUniform<TricornKernel>; break;
+	case Formula::Julia: trace = metropolis ? &Buddhabrot::traceMetropolis<JuliaKernel> : &Buddhabrot::traceUniform<JuliaKernel>; break;
+	case Formula::Mandelbrot:
+	default: trace = metropolis ? &Buddhabrot::traceMetropolis<MandelbrotKernel> : &Buddhabrot::traceUniform<MandelbrotKernel>; break;
+	}
+
+	const Mapping mapping{ centerX - xRange * 0.5, centerY + yRange * 0.5, width / xRange, height / yRange, width, height };
+	const int streamCount = static_cast<int>(streams.size());
+	const int perStream = (std::max(orbits, 1) + streamCount - 1) / streamCount;
+	ThreadPool::shared().parallelFor(streamCount, [&](int index, int worker) {
+		(this->*trace)(streams[index], workerDensity[worker].data(), perStream, mapping, params);
+	});
+	orbitCount += static_cast<long long>(perStream) * streamCount;
+	reduce(params.maxIterations);
+}
+
+// Folds the workers' buffers into the density row by row, clearing them for the next call,
+// then maps the density to the field on a log scale relative to the mean of the visited
+// pixels, which keeps the picture the same however many orbits it took
+void Buddhabrot::reduce(int maxIterations) {
+	ThreadPool& pool = ThreadPool::shared();
+	pool.parallelFor(height, [&](int row, int) {
+		const size_t offset = static_cast<size_t>(row) * width;
+		float* sum = density.data() + offset;
+		for (FirstTouchVector<float>& buffer : workerDensity) {
+			float* source = buffer.data() + offset;
+			for (int x = 0; x < width; ++x) {
+				sum[x] += source[x];
+				source[x] = 0.0f;
+			}
+		}
+		float peak = 0.0f;
+		double total = 0.0;
+		int filled = 0;
+		for (int x = 0; x < width; ++x) {
+			peak = std::max(peak, sum[x]);
+			total += sum[x];
+			filled += sum[x] > 0.0f ? 1 : 0;
+		}
+		rowPeak[row] = peak;
+		rowSum[row] = total;
+		rowFilled[row] = filled;
+	});
+
+	const float peak = rowPeak.empty() ? 0.0f : *std::max_element(rowPeak.begin(), rowPeak.end());
+	const double total = std::accumulate(rowSum.begin(), rowSum.end(), 0.0);
+	const long long filled = std::accumulate(rowFilled.begin(), rowFilled.end(), 0ll);
+	const double mean = filled > 0 ? total / filled : 1.0;
+	const double scale = peak > 0.0f ? maxIterations / std::log1p(peak / mean) : 0.0;
+	pool.parallelFor(height, [&](int row, int) {
+		const size_t offset = static_cast<size_t>(row) * width;
+		for (int x = 0; x < width; ++x) {
+			const float value = density[offset + x];
+			field[offset + x] = value > 0.0f ? static_cast<float>(std::log1p(value / mean) * scale) : -1.0f;
+		}
+	});
+}
+
+float Buddhabrot::getAcceptance() const {
+	long long proposals = 0;
+	long long accepted = 0;
+	for (const Stream& stream : streams) {
+		proposals += stream.proposals;
+		accepted += stream.accepted;
+	}
+	return proposals > 0 ? static_cast<float>(accepted) / proposals : 0.0f;
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include "Kernels.h"
+#include "ThreadPool.h"
+#include <cstdint>
+#include <random>
+#include <vector>
+
+// Orbit-density rendering: instead of colouring a point by how fast it escapes, every point
+// an escaping orbit visits is counted in the pixel it lands on. Orbits are picked at random
+// and escape-tested in batches with the same kernels the escape-time engine runs; only those
+// that escape are traced a second time, with the kernel's step, to record their points.
+//
+// Each worker of the shared ThreadPool counts into its own density buffer, so the hot loop
+// is a plain add with no atomics; every accumulate() ends with a reduction over the rows that
+// folds the buffers into one and turns it into a field of pseudo iteration counts for the
+// palette.
+//
+// Wide views take their starting points uniformly from the plane around the set, skipping
+// the main cardioid and the period-2 bulb, whose orbits never escape and would keep a whole
+// batch iterating to the limit. In narrower views almost none of those orbits ever pass
+// through, so the points come from Metropolis-Hastings chains instead: a chain moves to a
+// nearby point, or now and then to one anywhere, and keeps it with a probability given by how
+// many of its orbit's points land in the view. The chains spend their time on the orbits
+// that matter, and each orbit they visit is weighted by the inverse of its count so the
+// density still estimates the uniform one.
+class Buddhabrot {
+private:
+	// Everything the density depends on
+	struct View {
+		double centerX, centerY, xRange, yRange;
+		Formula formula;
+		double juliaX, juliaY;
+		int maxIterations;
+
+		bool operator==(const View&) const = default;
+	};
+
+	// A Metropolis chain: its point, the pixels its orbit puts in the view, and for how many
+	// proposals it has stayed there without being recorded yet. No pixels until seeded.
+	struct Chain {
+		double x = 0.0;
+		double y = 0.0;
+		std::vector<std::uint32_t> pixels;
+		int stay = 0;
+	};
+
+	// The random state and chains of one parallelFor index, kept across calls
+	struct Stream {
+		std::mt19937_64 random;
+		std::vector<Chain> chains;	// one per batch lane
+		std::vector<std::uint32_t> proposal;	// pixels of the orbit being proposed
+		long long proposals = 0;
+		long long accepted = 0;
+	};
+
+	// Where the plane ends up on screen, for the sampling threads
+	struct Mapping {
+		double xMin, yMax;
+		double xScale, yScale;	// pixels per unit
+		int width, height;
+	};
+
+	int width = 0;
+	int height = 0;
+	std::vector<FirstTouchVector<float>> workerDensity;	// per pool worker, since the last reduction
+	FirstTouchVector<float> density;	// all orbits so far
+	FirstTouchVector<float> field;
+	std::vector<Stream> streams;
+	View view{};
+	bool metropolis = false;
+	long long orbitCount = 0;
+
+	// Rows' peak density, summed density and non-empty pixels, from the reduction
+	std::vector<float> rowPeak;
+	std::vector<double> rowSum;
+	std::vector<int> rowFilled;
+
+	void restart(const View& newView);
+	template<class Kernel, class Visit>
+	static void traceOrbit(double px, double py, int steps, const KernelParams& params, const Mapping& mapping, const Visit& visit);
+	template<class Kernel>
+	void traceUniform(Stream& stream, float* target, int orbits, const Mapping& mapping, const KernelParams& params);
+	template<class Kernel>
+	void traceMetropolis(Stream& stream, float* target, int orbits, const Mapping& mapping, const KernelParams& params);
+	void reduce(int maxIterations);
+
+public:
+	// Views narrower than this are sampled by the Metropolis chains
+	static constexpr double METROPOLIS_RANGE = 1.0;
+	// Starting points are taken from [-SAMPLE_RADIUS, SAMPLE_RADIUS] on both axes
+	static constexpr double SAMPLE_RADIUS = 2.0;
+	// Chance that a chain proposes a point anywhere rather than one close by
+	static constexpr double LARGE_MUTATION = 0.1;
+
+	// Each pool worker gets a density buffer of this size, which it first touches itself
+	void resize(int newWidth, int newHeight);
+
+	// Traces about `orbits` more starting points into the density. A view, formula or limit
+	// other than last time's clears it first. Custom formulas have no kernel of their own and
+	// are rendered as the Mandelbrot set. The field is up to date when it returns.
+	void accumulate(double centerX, double centerY, double xRange, double yRange, Formula formula, const KernelParams& params, int orbits);
+
+	int getWidth() const { return width; }
+	int getHeight() const { return height; }
+	// The density on a log scale in [0, maxIterations], -1 where no orbit has been, row 0 at
+	// the top of the image
+	const FirstTouchVector<float>& getField() const { return field; }
+	long long getOrbitCount() const { return orbitCount; }
+	bool isMetropolis() const { return metropolis; }
+	// Fraction of the chains' proposals that were kept
+	float getAcceptance() const;
+};
@@ -0,0 +1,77 @@
+#include "ComputeEngine.h"
+#include <algorithm>
+
+bool ComputeEngine::create(int newWidth, int newHeight) {
+	width = newWidth;
+	height = newHeight;
+	const std::ptrdiff_t fieldSize = static_cast<std::ptrdiff_t>(width) * height * sizeof(float);
+
+	if (!fieldBuffer) {
+		gl.genBuffers(1, &fieldBuffer);
+		gl.genBuffers(1, &queueBuffer);
+		gl.genBuffers(1, &orbitBuffer);
+		glGenTextures(1, &valuesTexture);
+	}
+	orbitsAllocated = false;
+	gl.bindBuffer(GlEnum::SHADER_STORAGE_BUFFER, fieldBuffer);
+	gl.bufferData(GlEnum::SHADER_STORAGE_BUFFER, fieldSize, nullptr, GlEnum::DYNAMIC_COPY);
+	gl.bindBuffer(GlEnum::SHADER_STORAGE_BUFFER, queueBuffer);
+	gl.bufferData(GlEnum::SHADER_STORAGE_BUFFER, 2 * sizeof(GLuint), nullptr, GlEnum::DYNAMIC_DRAW);
+	gl.bindBuffer(GlEnum::SHADER_STORAGE_BUFFER, 0);
+
+	gl.activeTexture(GlEnum::TEXTURE0 + VALUES_UNIT);
+	glBindTexture(GL_TEXTURE_2D, valuesTexture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GlEnum::R32F, width, height, 0, GL_RED, GL_FLOAT, nullptr);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	gl.activeTexture(GlEnum::TEXTURE0);
+	return fieldBuffer != 0 && valuesTexture != 0;
+}
+
+void ComputeEngine::render(GLuint program, int maxIterations) {
+	const int passes = std::max((maxIterations + DISPATCH_ITERATIONS - 1) / DISPATCH_ITERATIONS, 1);
+	if (passes > 1 && !orbitsAllocated) {
+		gl.bindBuffer(GlEnum::SHADER_STORAGE_BUFFER, orbitBuffer);
+		gl.bufferData(GlEnum::SHADER_STORAGE_BUFFER, static_cast<std::ptrdiff_t>(width) * height * ORBIT_BYTES, nullptr, GlEnum::DYNAMIC_COPY);
+		orbitsAllocated = true;
+	}
+	gl.bindBufferBase(GlEnum::SHADER_STORAGE_BUFFER, 0, fieldBuffer);
+	gl.bindBufferBase(GlEnum::SHADER_STORAGE_BUFFER, 1, queueBuffer);
+	gl.bindBufferBase(GlEnum::SHADER_STORAGE_BUFFER, 2, orbitBuffer);
+
+	const int tiles = ((width + TILE_SIZE - 1) / TILE_SIZE) * ((height + TILE_SIZE - 1) / TILE_SIZE);
+	gl.useProgram(program);
+	for (int pass = 0; pass < passes; ++pass) {
+		const GLuint queue[2] = { 0, static_cast<GLuint>(pass) };
+		gl.bindBuffer(GlEnum::SHADER_STORAGE_BUFFER, queueBuffer);
+		gl.bufferSubData(GlEnum::SHADER_STORAGE_BUFFER, 0, sizeof(queue), queue);
+		gl.bindBuffer(GlEnum::SHADER_STORAGE_BUFFER, 0);
+		// Just enough groups that the tiles run out before the groups do
+		gl.dispatchCompute(static_cast<GLuint>((tiles + TILES_PER_GROUP - 1) / TILES_PER_GROUP), 1, 1);
+		// The next pass reads the orbits this one parked
+		gl.memoryBarrier(GlEnum::SHADER_STORAGE_BARRIER_BIT | GlEnum::BUFFER_UPDATE_BARRIER_BIT);
+	}
+	gl.useProgram(0);
+	gl.memoryBarrier(GlEnum::PIXEL_BUFFER_BARRIER_BIT | GlEnum::BUFFER_UPDATE_BARRIER_BIT);
+
+	// Buffer to texture without leaving the GPU. The unpack binding must not stay set, or
+	// SFML's own texture uploads would read from the buffer.
+	gl.bindBuffer(GlEnum::PIXEL_UNPACK_BUFFER, fieldBuffer);
+	gl.activeTexture(GlEnum::TEXTURE0 + VALUES_UNIT);
+	glBindTexture(GL_TEXTURE_2D, valuesTexture);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RED, GL_FLOAT, nullptr);
+	gl.activeTexture(GlEnum::TEXTURE0);
+	gl.bindBuffer(GlEnum::PIXEL_UNPACK_BUFFER, 0);
+}
+
+void ComputeEngine::bindForColoring() const {
+	gl.activeTexture(GlEnum::TEXTURE0 + VALUES_UNIT);
+	glBindTexture(GL_TEXTURE_2D, valuesTexture);
+	gl.activeTexture(GlEnum::TEXTURE0);
+}
+
+void ComputeEngine::readValues(float* values) const {
+	gl.bindBuffer(GlEnum::SHADER_STORAGE_BUFFER, fieldBuffer);
+	gl.getBufferSubData(GlEnum::SHADER_STORAGE_BUFFER, 0, static_cast<std::ptrdiff_t>(width) * height * sizeof(float), values);
+	gl.bindBuffer(GlEnum::SHADER_STORAGE_BUFFER, 0);
+}
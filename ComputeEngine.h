@@ -0,0 +1,52 @@
+#pragma once
+
+#include "GlFunctions.h"
+
+// GPU iteration through mandelbrot.comp. The escape values land in a shader storage
+// buffer, which is copied into an R32F texture on the GPU through the pixel unpack
+// binding, so the colour pass reads it like any other field and nothing is read back. For
+// histogram colouring the HISTOGRAM variant counts the bins into GpuHistogram as it goes.
+//
+// A dispatch advances each pixel by at most DISPATCH_ITERATIONS, because drivers stop an
+// invocation that runs too long (llvmpipe after 65535 loop iterations). Higher limits take
+// several dispatches in a row, which keep the orbits of unfinished pixels in a buffer that
+// is only allocated once a limit needs it.
+//
+// Like IterationState, everything here is raw GL and touches no texture unit SFML uses.
+class ComputeEngine {
+private:
+	GLuint fieldBuffer = 0;
+	GLuint queueBuffer = 0;
+	GLuint valuesTexture = 0;
+	GLuint orbitBuffer = 0;
+	bool orbitsAllocated = false;
+	int width = 0;
+	int height = 0;
+
+public:
+	// Where the colour pass finds the field
+	static constexpr GLint VALUES_UNIT = 5;
+
+	// Must match mandelbrot.comp
+	static constexpr int TILE_SIZE = 16;
+
+	// Most tiles one workgroup takes from the queue; must match mandelbrot.comp
+	static constexpr int TILES_PER_GROUP = 2;
+
+	// Iterations per pixel and dispatch, and the size of a parked orbit; must match
+	// mandelbrot.comp
+	static constexpr int DISPATCH_ITERATIONS = 2048;
+	static constexpr int ORBIT_BYTES = 24;
+
+	bool create(int width, int height);
+
+	// Runs program, the compiled mandelbrot.comp, over the whole field, in as many
+	// dispatches as maxIterations needs. The FrameParams buffer has to be bound already,
+	// with the same maxIterations.
+	void render(GLuint program, int maxIterations);
+
+	void bindForColoring() const;
+
+	// Copies the field (width * height floats) to values.
+	void readValues(float* values) const;
+};
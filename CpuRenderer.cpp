@@ -0,0 +1,559 @@
+#include "CpuRenderer.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <type_traits>
+
+template<class Rows>
+void CpuRenderer::forEachTile(const Rows& rows) {
+	const int tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+	const int tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+	ThreadPool::shared().parallelFor(tilesX * tilesY, [&](int tile, int) {
+		const int x0 = (tile % tilesX) * TILE_SIZE;
+		const int y0 = (tile / tilesX) * TILE_SIZE;
+		rows(y0, std::min(y0 + TILE_SIZE, height), x0, std::min(x0 + TILE_SIZE, width));
+	});
+}
+
+void CpuRenderer::resize(int newWidth, int newHeight) {
+	width = newWidth;
+	height = newHeight;
+	// Fresh buffers, first written tile by tile on the workers that will render them
+	iterations = FirstTouchVector<float>(static_cast<size_t>(width) * height);
+	escapeSteps = FirstTouchVector<int>(static_cast<size_t>(width) * height);
+	thresholded = FirstTouchVector<float>();
+	forEachTile([this](int y0, int y1, int x0, int x1) {
+		for (int py = y0; py < y1; ++py) {
+			const size_t offset = static_cast<size_t>(py) * width;
+			std::fill(iterations.begin() + offset + x0, iterations.begin() + offset + x1, -1.0f);
+			std::fill(escapeSteps.begin() + offset + x0, escapeSteps.begin() + offset + x1, -1);
+		}
+	});
+	pending.clear();
+	reachedIterations = 0;
+	currentIterations = 0;
+}
+
+void CpuRenderer::render(double centerX, double centerY, double xRange, double yRange, Formula formula, const KernelParams& params,
+	const FormulaProgram* customFormula, IterationHistogram* histogram) {
+	const FormulaProgram* program = formula == Formula::Custom && customFormula && customFormula->isValid() ? customFormula : nullptr;
+	const View newView{ centerX, centerY, xRange, yRange, formula, params.juliaX, params.juliaY, tileIterationCap, mixedPrecision,
+		uniformPrecision, tileMaskVersion };
+	renderedTiles = 0;
+
+	// Only the limit changed: continue or cut the cached orbits instead of starting over.
+	// Fields iterated in more precision than a lower limit needs are still good.
+	const bool sameView = reachedIterations > 0 && newView == view && formula != Formula::Custom;
+	if (sameView && params.maxIterations > reachedIterations) {
+		planPrecision(nextPlan, newView, params.maxIterations, false);
+	}
+	if (sameView && (params.maxIterations <= reachedIterations || nextPlan == precisionPlan)) {
+		if (params.maxIterations > reachedIterations) {
+			resume(params);
+		}
+		else {
+			threshold(params.maxIterations);
+		}
+		if (histogram) {
+			const FirstTouchVector<float>& field = getIterations();
+			histogram->build(field.data(), static_cast<int>(field.size()), params.maxIterations);
+		}
+		return;
+	}
+
+	if (histogram) {
+		histogram->reset(params.maxIterations, ThreadPool::shared().getWorkerCount());
+	}
+	renderFull(newView, params, program, histogram);
+	if (histogram) {
+		histogram->finish();
+	}
+}
+
+void CpuRenderer::setTileMask(const std::vector<std::uint8_t>& mask) {
+	if (mask != tileMask) {
+		tileMask = mask;
+		++tileMaskVersion;
+	}
+}
+
+namespace {
+	// Float and double orbits are kept in the pending OrbitStates; the rest restart
+	bool keepsOrbit(Precision precision) {
+		return precision <= Precision::Double;
+	}
+
+	// Only the Mandelbrot set has a perturbation path for BigFloat tiles
+	Precision highestServed(Formula formula) {
+		return formula == Formula::Mandelbrot ? Precision::BigFloat : Precision::DoubleDouble;
+	}
+
+	// Fixed128 and double-double both resolve the tiles up to 106 bits. Which of them is
+	// faster depends on the machine, most of all on whether std::fma is one instruction, so
+	// both are timed once on a span of interior points and the better of two runs counts.
+	bool doubleDoubleFaster() {
+		static const bool faster = [] {
+			constexpr int COUNT = 64;
+			KernelParams params;
+			params.maxIterations = 1000;
+			float values[COUNT];
+			int steps[COUNT];
+			std::chrono::steady_clock::duration fixedTime = std::chrono::steady_clock::duration::max();
+			std::chrono::steady_clock::duration doubleDoubleTime = fixedTime;
+			for (int run = 0; run < 2; ++run) {
+				const auto start = std::chrono::steady_clock::now();
+				wideSpanKernelFor<Fixed128>(Formula::Mandelbrot)(Fixed128(-0.1), Fixed128(1e-4), Fixed128(0.1), COUNT, values, steps, params);
+				const auto middle = std::chrono::steady_clock::now();
+				wideSpanKernelFor<DoubleDouble>(Formula::Mandelbrot)(DoubleDouble(-0.1), DoubleDouble(1e-4), DoubleDouble(0.1), COUNT, values, steps,
+					params);
+				const auto end = std::chrono::steady_clock::now();
+				fixedTime = std::min(fixedTime, middle - start);
+				doubleDoubleTime = std::min(doubleDoubleTime, end - middle);
+			}
+			return doubleDoubleTime < fixedTime;
+		}();
+		return faster;
+	}
+}
+
+// Raised tiles go up to the cap in the precision planned here, so the plan has to cover it.
+// Custom formulas only run in double. Fixed128 wraps around where a double would grow, so
+// it is kept to views where the built-in kernels cannot overflow it; a Julia set's constant
+// is part of every orbit and has to be in range too. Tiles out of its range take the
+// floating-point precisions instead.
+void CpuRenderer::planPrecision(PrecisionPlanner& planner, const View& newView, int maxIterations, bool custom) {
+	const bool fixed = newView.formula != Formula::Julia
+		|| std::max(std::abs(newView.juliaX), std::abs(newView.juliaY)) <= Fixed128::SAFE_MAGNITUDE;
+	if (custom) {
+		planner.planUniform(Precision::Double, width, height, TILE_SIZE);
+	}
+	else if (newView.mixedPrecision) {
+		const int highest = std::max(maxIterations, newView.tileIterationCap);
+		planner.plan(newView.centerX, newView.centerY, newView.xRange, newView.yRange, highest, width, height, TILE_SIZE, fixed,
+			doubleDoubleFaster());
+	}
+	else if (newView.uniformPrecision == Precision::Fixed128) {
+		const double magnitude = std::max(std::abs(newView.centerX) + 0.5 * newView.xRange, std::abs(newView.centerY) + 0.5 * newView.yRange);
+		const bool inRange = fixed && magnitude <= Fixed128::SAFE_MAGNITUDE;
+		planner.planUniform(inRange ? Precision::Fixed128 : Precision::DoubleDouble, width, height, TILE_SIZE);
+	}
+	else {
+		planner.planUniform(newView.uniformPrecision, width, height, TILE_SIZE);
+	}
+	if (!custom) {
+		planner.cap(highestServed(newView.formula));
+	}
+}
+
+void CpuRenderer::prepareReference(int maxIterations) {
+	const int limbs = BigFixed::limbsForBits(PrecisionPlanner::requiredBits(std::min(view.xRange / width, view.yRange / height), 1.0,
+		maxIterations));
+	if (referenceIterations >= maxIterations && referenceLimbs == limbs) {
+		return;
+	}
+	reference.compute(BigFixed(limbs, view.centerX), BigFixed(limbs, view.centerY), maxIterations);
+	referenceIterations = maxIterations;
+	referenceLimbs = limbs;
+}
+
+// The deltas are the pixels' offsets from the centre, which a double holds to well below a
+// pixel; perturbedLanes takes over where they are too small for one.
+void CpuRenderer::perturbLanes(const std::uint32_t* pixels, int count, const KernelParams& params) {
+	const double dx = view.xRange / width;
+	const double dy = view.yRange / height;
+	FloatExp dcx[PERTURBED_LANES], dcy[PERTURBED_LANES];
+	float values[PERTURBED_LANES];
+	int steps[PERTURBED_LANES];
+	for (int l = 0; l < PERTURBED_LANES; ++l) {
+		const std::uint32_t pixel = pixels[l < count ? l : count - 1];
+		const int column = static_cast<int>(pixel % width);
+		const int row = static_cast<int>(pixel / width);
+		dcx[l] = FloatExp((column + 0.5 - 0.5 * width) * dx);
+		dcy[l] = FloatExp((0.5 * height - row - 0.5) * dy);
+	}
+	perturbedLanes<PERTURBED_LANES>(reference, dcx, dcy, params.maxIterations, values, steps);
+	for (int l = 0; l < count; ++l) {
+		iterations[pixels[l]] = values[l];
+		escapeSteps[pixels[l]] = steps[l];
+	}
+}
+
+void CpuRenderer::renderFull(const View& newView, const KernelParams& params, const FormulaProgram* program, IterationHistogram* histogram) {
+	const SpanKernel kernel = spanKernelFor(newView.formula);
+	const SpanKernel floatKernel = spanKernelFor<float>(newView.formula);
+	const WideSpanKernelOf<Fixed128> fixedKernel = wideSpanKernelFor<Fixed128>(newView.formula);
+	const WideSpanKernelOf<DoubleDouble> doubleDoubleKernel = wideSpanKernelFor<DoubleDouble>(newView.formula);
+	const double dx = newView.xRange / width;
+	const double dy = newView.yRange / height;
+	const double xMin = newView.centerX - 0.5 * newView.xRange;
+	const double yMax = newView.centerY + 0.5 * newView.yRange;
+	const Fixed128 fixedDx(dx);
+	const DoubleDouble doubleDoubleDx(dx);
+
+	const int tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+	const int tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+	const int tileCount = tilesX * tilesY;
+	if (!(newView == view)) {
+		referenceIterations = 0;
+	}
+	view = newView;	// raised tiles locate their pixels through it
+	planPrecision(precisionPlan, newView, params.maxIterations, program != nullptr);
+	if (precisionPlan.getCount(Precision::BigFloat) > 0) {
+		prepareReference(std::max(params.maxIterations, tileIterationCap));
+	}
+
+	ThreadPool& pool = ThreadPool::shared();
+	workerPending.resize(pool.getWorkerCount());
+	for (std::vector<OrbitState>& local : workerPending) {
+		local.clear();
+	}
+	std::atomic<int> raised = 0;
+	const bool masked = tileMask.size() == static_cast<size_t>(tileCount);
+	// A masked render leaves the other tiles to someone else, images included
+	if (symmetry && !masked) {
+		mirror.plan(newView.formula, newView.centerX, newView.centerY, newView.xRange, newView.yRange, width, height);
+	}
+	else {
+		mirror.clear();
+	}
+
+	pool.parallelFor(tileCount, [&](int tile, int worker) {
+		if ((masked && !tileMask[tile]) || (cancelFlag && cancelFlag->load(std::memory_order_relaxed))) {
+			return;
+		}
+		const int x0 = (tile % tilesX) * TILE_SIZE;
+		const int y0 = (tile / tilesX) * TILE_SIZE;
+		const int spanWidth = x0 + TILE_SIZE < width ? TILE_SIZE : width - x0;
+		const int y1 = y0 + TILE_SIZE < height ? y0 + TILE_SIZE : height;
+		double zx[TILE_SIZE], zy[TILE_SIZE];
+		std::vector<OrbitState>& tilePending = workerPending[worker];
+		const size_t tileBegin = tilePending.size();
+		const Precision precision = precisionPlan.getTile(tile);
+		const SpanKernel tileKernel = precision == Precision::Float ? floatKernel : kernel;
+
+		for (int py = y0; py < y1; ++py) {
+			// Sample at pixel centres, the same points gl_FragCoord gives the shader.
+			double y = yMax - (py + 0.5) * dy;
+			double x = xMin + (x0 + 0.5) * dx;
+			const size_t offset = static_cast<size_t>(py) * width + x0;
+			float* out = &iterations[offset];
+			if (mirror.coversSpan(py, x0, x0 + spanWidth)) {
+				// Filled in by mirrorField; until then it must not look late to raiseTile
+				std::fill(escapeSteps.begin() + offset, escapeSteps.begin() + offset + spanWidth, -1);
+				continue;
+			}
+			if (program) {
+				program->renderSpan(x, dx, y, spanWidth, out, params);
+			}
+			else if (!keepsOrbit(precision)) {
+				int* steps = &escapeSteps[offset];
+				if (precision == Precision::Fixed128) {
+					Fixed128 fixedX, fixedY;
+					wideSpanStart(x0, py, fixedX, fixedY);
+					fixedKernel(fixedX, fixedDx, fixedY, spanWidth, out, steps, params);
+				}
+				else if (precision == Precision::DoubleDouble) {
+					DoubleDouble doubleDoubleX, doubleDoubleY;
+					wideSpanStart(x0, py, doubleDoubleX, doubleDoubleY);
+					doubleDoubleKernel(doubleDoubleX, doubleDoubleDx, doubleDoubleY, spanWidth, out, steps, params);
+				}
+				else {
+					std::uint32_t pixels[PERTURBED_LANES];
+					for (int start = 0; start < spanWidth; start += PERTURBED_LANES) {
+						const int lanes = std::min(PERTURBED_LANES, spanWidth - start);
+						for (int l = 0; l < lanes; ++l) {
+							pixels[l] = static_cast<std::uint32_t>(offset + start + l);
+						}
+						perturbLanes(pixels, lanes, params);
+					}
+				}
+				for (int i = 0; i < spanWidth; ++i) {
+					if (steps[i] < 0) {
+						tilePending.push_back({ static_cast<std::uint32_t>(offset + i), params.maxIterations, 0.0, 0.0 });
+					}
+				}
+			}
+			else {
+				int* steps = &escapeSteps[offset];
+				tileKernel(x, dx, y, spanWidth, SpanOutput{ out, steps, zx, zy }, params);
+				for (int i = 0; i < spanWidth; ++i) {
+					if (steps[i] < 0) {
+						tilePending.push_back({ static_cast<std::uint32_t>(offset + i), params.maxIterations, zx[i], zy[i] });
+					}
+				}
+			}
+		}
+
+		const int tileOrbits = static_cast<int>(tilePending.size() - tileBegin);
+		if (!program && tileIterationCap > params.maxIterations && tileOrbits > 0) {
+			const int remaining = raiseTile(&tilePending[tileBegin], tileOrbits, x0, y0, spanWidth, y1 - y0, params);
+			raised += remaining < tileOrbits || (remaining > 0 && tilePending[tileBegin].iterations > params.maxIterations) ? 1 : 0;
+			tilePending.resize(tileBegin + remaining);
+		}
+
+		if (histogram) {
+			for (int py = y0; py < y1; ++py) {
+				if (mirror.coversSpan(py, x0, x0 + spanWidth)) {
+					continue;
+				}
+				const float* out = &iterations[static_cast<size_t>(py) * width + x0];
+				for (int i = 0; i < spanWidth; ++i) {
+					histogram->add(worker, out[i]);
+				}
+			}
+		}
+	});
+
+	pending.clear();
+	for (const std::vector<OrbitState>& local : workerPending) {
+		pending.insert(pending.end(), local.begin(), local.end());
+	}
+	const bool cancelled = cancelFlag && cancelFlag->load();
+	if (mirror.isActive() && !cancelled) {
+		mirrorField(histogram);
+	}
+	mirroredPixels = mirror.getCopiedCount();
+	reachedIterations = program || cancelled ? 0 : params.maxIterations;
+	currentIterations = params.maxIterations;
+	resumedPixels = 0;
+	raisedTiles = raised.load();
+	renderedTiles = masked ? static_cast<int>(tileMask.size() - std::count(tileMask.begin(), tileMask.end(), 0)) : tileCount;
+}
+
+void CpuRenderer::mirrorField(IterationHistogram* histogram) {
+	ThreadPool::shared().parallelFor(mirror.getRow1() - mirror.getRow0(), [&](int index, int worker) {
+		const int py = mirror.getRow0() + index;
+		const size_t offset = static_cast<size_t>(py) * width;
+		const size_t image = static_cast<size_t>(mirror.mirrorRow(py)) * width;
+		for (int x0 = 0; x0 < width; x0 += TILE_SIZE) {
+			const int x1 = std::min(x0 + TILE_SIZE, width);
+			if (!mirror.coversSpan(py, x0, x1)) {
+				continue;
+			}
+			for (int x = x0; x < x1; ++x) {
+				const size_t from = image + mirror.mirrorColumn(x);
+				iterations[offset + x] = iterations[from];
+				escapeSteps[offset + x] = escapeSteps[from];
+				if (histogram) {
+					histogram->add(worker, iterations[offset + x]);
+				}
+			}
+		}
+	});
+
+	// The copies continue from the mirrored z. An image past double keeps no z, so a copy
+	// that lies in a tile of double or less starts its orbit over.
+	const size_t images = pending.size();
+	for (size_t i = 0; i < images; ++i) {
+		OrbitState orbit = pending[i];
+		const int column = mirror.mirrorColumn(static_cast<int>(orbit.pixel % width));
+		const int row = mirror.mirrorRow(static_cast<int>(orbit.pixel / width));
+		if (row < 0 || row >= height || column < 0 || column >= width || !isMirrored(column, row)) {
+			continue;
+		}
+		const bool restartsImage = !keepsOrbit(pixelPrecision(orbit.pixel));
+		orbit.pixel = static_cast<std::uint32_t>(row) * width + column;
+		orbit.zy = mirror.isHalfTurn() ? orbit.zy : -orbit.zy;
+		if (restartsImage && keepsOrbit(pixelPrecision(orbit.pixel))) {
+			orbit.iterations = 0;
+			orbit.zx = 0.0;
+			orbit.zy = 0.0;
+			if (view.formula == Formula::Julia) {
+				pixelPoint(static_cast<int>(orbit.pixel), orbit.zx, orbit.zy);
+			}
+		}
+		pending.push_back(orbit);
+	}
+}
+
+void CpuRenderer::pixelPoint(int pixel, double& x, double& y) const {
+	const double dx = view.xRange / width;
+	const double dy = view.yRange / height;
+	const double xMin = view.centerX - 0.5 * view.xRange;
+	const double yMax = view.centerY + 0.5 * view.yRange;
+	const int column = pixel % width;
+	const int row = pixel / width;
+	const int spanStart = column - column % TILE_SIZE;
+	x = (xMin + (spanStart + 0.5) * dx) + dx * static_cast<double>(column - spanStart);
+	y = yMax - (row + 0.5) * dy;
+}
+
+// The offsets from the centre are small enough for a double to hold to well below a pixel;
+// only adding them to the centre needs the extra bits.
+template<class T>
+void CpuRenderer::wideSpanStart(int column, int row, T& x, T& y) const {
+	const double dx = view.xRange / width;
+	const double dy = view.yRange / height;
+	x = T(view.centerX) + T((column + 0.5 - 0.5 * width) * dx);
+	y = T(view.centerY) + T((0.5 * height - row - 0.5) * dy);
+}
+
+template<class T>
+void CpuRenderer::pixelPoint(int pixel, T& x, T& y) const {
+	const int column = pixel % width;
+	const int spanStart = column - column % TILE_SIZE;
+	wideSpanStart(spanStart, pixel / width, x, y);
+	x += T(view.xRange / width) * T(column - spanStart);
+}
+
+// Float orbits are stored widened to double, so narrowing them again is exact and a float
+// tile continues exactly as if it had never stopped.
+template<class T>
+void CpuRenderer::continueLanes(OrbitState* orbits, int count, const KernelParams& params) {
+	constexpr int Lanes = kernelLanes<T>;
+	T px[Lanes], py[Lanes], zx[Lanes], zy[Lanes];
+	float values[Lanes];
+	int steps[Lanes];
+	constexpr bool restart = !std::is_floating_point_v<T>;
+	for (int l = 0; l < Lanes; ++l) {
+		// Tail lanes repeat the last orbit, as in renderSpan
+		const OrbitState& orbit = orbits[l < count ? l : count - 1];
+		if constexpr (restart) {
+			pixelPoint(static_cast<int>(orbit.pixel), px[l], py[l]);
+			zx[l] = view.formula == Formula::Julia ? px[l] : T();
+			zy[l] = view.formula == Formula::Julia ? py[l] : T();
+		}
+		else {
+			double x, y;
+			pixelPoint(static_cast<int>(orbit.pixel), x, y);
+			px[l] = static_cast<T>(x);
+			py[l] = static_cast<T>(y);
+			zx[l] = static_cast<T>(orbit.zx);
+			zy[l] = static_cast<T>(orbit.zy);
+		}
+	}
+	batchKernelFor<T>(view.formula)(px, py, zx, zy, restart ? 0 : orbits[0].iterations, values, steps, params);
+	for (int l = 0; l < count; ++l) {
+		OrbitState& orbit = orbits[l];
+		iterations[orbit.pixel] = values[l];
+		escapeSteps[orbit.pixel] = steps[l];
+		orbit.iterations = params.maxIterations;
+		if constexpr (!restart) {
+			orbit.zx = static_cast<double>(zx[l]);
+			orbit.zy = static_cast<double>(zy[l]);
+		}
+	}
+}
+
+void CpuRenderer::continueOrbits(OrbitState* orbits, int count, const KernelParams& params) {
+	const Precision precision = pixelPrecision(orbits[0].pixel);
+	if (precision == Precision::Float) {
+		for (int start = 0; start < count; start += kernelLanes<float>) {
+			continueLanes<float>(orbits + start, std::min(kernelLanes<float>, count - start), params);
+		}
+	}
+	else if (precision == Precision::Fixed128) {
+		for (int start = 0; start < count; start += kernelLanes<Fixed128>) {
+			continueLanes<Fixed128>(orbits + start, std::min(kernelLanes<Fixed128>, count - start), params);
+		}
+	}
+	else if (precision == Precision::DoubleDouble) {
+		for (int start = 0; start < count; start += kernelLanes<DoubleDouble>) {
+			continueLanes<DoubleDouble>(orbits + start, std::min(kernelLanes<DoubleDouble>, count - start), params);
+		}
+	}
+	else if (precision == Precision::BigFloat) {
+		std::uint32_t pixels[PERTURBED_LANES];
+		for (int start = 0; start < count; start += PERTURBED_LANES) {
+			const int lanes = std::min(PERTURBED_LANES, count - start);
+			for (int l = 0; l < lanes; ++l) {
+				pixels[l] = orbits[start + l].pixel;
+				orbits[start + l].iterations = params.maxIterations;
+			}
+			perturbLanes(pixels, lanes, params);
+		}
+	}
+	else {
+		for (int start = 0; start < count; start += kernelLanes<double>) {
+			continueLanes<double>(orbits + start, std::min(kernelLanes<double>, count - start), params);
+		}
+	}
+}
+
+// A tile is still resolving when at least 1% of its pixels escaped in the last quarter
+// of the iterations it was given; the unescaped ones next to them are likely to follow.
+int CpuRenderer::raiseTile(OrbitState* orbits, int count, int x0, int y0, int spanWidth, int rows,
+	const KernelParams& params) {
+	KernelParams raised = params;
+	int previous = 0;
+	while (count > 0 && raised.maxIterations < tileIterationCap) {
+		const int lateStart = previous + (raised.maxIterations - previous) * 3 / 4;
+		int late = 0;
+		for (int py = y0; py < y0 + rows; ++py) {
+			const int* steps = &escapeSteps[static_cast<size_t>(py) * width + x0];
+			for (int i = 0; i < spanWidth; ++i) {
+				late += steps[i] > lateStart ? 1 : 0;
+			}
+		}
+		if (late * 100 < spanWidth * rows) {
+			break;
+		}
+
+		previous = raised.maxIterations;
+		raised.maxIterations = std::min(raised.maxIterations * 2, tileIterationCap);
+		continueOrbits(orbits, count, raised);
+		count = static_cast<int>(std::remove_if(orbits, orbits + count, [this](const OrbitState& orbit) {
+			return escapeSteps[orbit.pixel] >= 0;
+		}) - orbits);
+	}
+	return count;
+}
+
+// Pending orbits continue from wherever they stopped, in batches like a span, just gathered
+// from wherever the pixels are. Orbits of one tile stopped at the same iteration in the
+// same precision, so a batch only splits where a raised tile or a precision change begins
+// or ends.
+void CpuRenderer::resume(const KernelParams& params) {
+	constexpr int BATCH = kernelLanes<float>;
+	const int count = static_cast<int>(pending.size());
+	constexpr int CHUNK = 16 * BATCH;
+	const int chunks = (count + CHUNK - 1) / CHUNK;
+	if (precisionPlan.getCount(Precision::BigFloat) > 0) {
+		prepareReference(params.maxIterations);
+	}
+
+	// pending runs worker by worker in tile order, so chunks mostly start where their
+	// tiles were rendered
+	ThreadPool::shared().parallelFor(chunks, [&](int chunk, int) {
+		const int end = std::min(chunk * CHUNK + CHUNK, count);
+		for (int first = chunk * CHUNK; first < end;) {
+			const Precision precision = pixelPrecision(pending[first].pixel);
+			int last = first + 1;
+			while (last < end && pending[last].iterations == pending[first].iterations && pixelPrecision(pending[last].pixel) == precision) {
+				++last;
+			}
+			if (pending[first].iterations < params.maxIterations) {
+				continueOrbits(&pending[first], last - first, params);
+			}
+			first = last;
+		}
+	});
+
+	resumedPixels = count;
+	pending.erase(std::remove_if(pending.begin(), pending.end(), [this](const OrbitState& orbit) {
+		return escapeSteps[orbit.pixel] >= 0;
+	}), pending.end());
+	reachedIterations = params.maxIterations;
+	currentIterations = params.maxIterations;
+}
+
+// Pixels that took more than maxIterations to escape count as inside again. The field at
+// reachedIterations stays as it is, so raising the limit back is free as well.
+void CpuRenderer::threshold(int maxIterations) {
+	currentIterations = maxIterations;
+	resumedPixels = 0;
+	if (maxIterations == reachedIterations) {
+		return;
+	}
+
+	if (thresholded.size() != iterations.size()) {
+		thresholded = FirstTouchVector<float>(iterations.size());
+	}
+	forEachTile([this, maxIterations](int y0, int y1, int x0, int x1) {
+		for (int py = y0; py < y1; ++py) {
+			for (size_t i = static_cast<size_t>(py) * width + x0, end = static_cast<size_t>(py) * width + x1; i < end; ++i) {
+				thresholded[i] = escapeSteps[i] >= 0 && escapeSteps[i] <= maxIterations ? iterations[i] : -1.0f;
+			}
+		}
+	});
+}
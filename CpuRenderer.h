@@ -0,0 +1,189 @@
+#pragma once
+
+#include "FormulaCompiler.h"
+#include "Histogram.h"
+#include "Kernels.h"
+#include "MirrorPlan.h"
+#include "Perturbation.h"
+#include "PrecisionPlanner.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+// Multithreaded CPU escape-time engine. Splits the frame into square tiles that the workers
+// of the shared ThreadPool pick up, and runs the specialized span kernel for the current
+// formula over each tile row. The result is a field of smooth iteration counts, one per
+// pixel, row 0 at the top of the image (yMax).
+//
+// The orbits of pixels that did not escape are kept, so when only maxIterations changes
+// a higher limit continues those pixels from where they stopped and a lower one just
+// re-thresholds the field. Custom formulas always render from scratch.
+//
+// With a tile iteration cap set, a tile whose pixels are still escaping close to the limit
+// has its unescaped pixels continued past it, doubling the limit until the late escapes
+// thin out or the cap is reached. Only the tiles on an unresolved boundary pay for that.
+//
+// With mixed precision on, every tile iterates in the cheapest precision that still
+// resolves its pixels, as PrecisionPlanner decides: float tiles run twice the lanes of
+// double ones. The plan depends on the limit as well, so a higher limit only resumes while
+// no tile needs more precision than it was iterated in. Tiles past double run the Fixed128
+// or the DoubleDouble kernel, and Mandelbrot tiles past both are iterated as deltas from a
+// BigFixed reference orbit at the centre of the view, see Perturbation.h. The other formulas
+// have no perturbation, so their tiles past double-double stay in it and are counted as
+// unserved in the plan. The orbits of all these are not kept, since a double cannot hold
+// them, so a higher limit restarts their pixels.
+//
+// Where the view straddles an axis of symmetry of the formula, the tile rows that are mirror
+// images of others are skipped and filled from them afterwards, orbits included, so the
+// default overview costs a little over half. See MirrorPlan.
+//
+// Each worker starts on its own band of tiles and first touches the field rows of that band,
+// so on a NUMA machine most of a tile's pixels live on the node that renders it.
+//
+// The view is a centre and a size rather than its corners, which would round onto the
+// same double once the view is narrower than the spacing of doubles at the centre.
+class CpuRenderer {
+private:
+	// Where an unescaped pixel's orbit stopped
+	struct OrbitState {
+		std::uint32_t pixel;
+		int iterations;	// done so far; above the frame's limit in raised tiles
+		double zx, zy;
+	};
+
+	// Everything but maxIterations that the cached orbits depend on
+	struct View {
+		double centerX, centerY, xRange, yRange;
+		Formula formula;
+		double juliaX, juliaY;
+		int tileIterationCap;
+		bool mixedPrecision;
+		Precision uniformPrecision;
+		int tileMaskVersion;
+
+		bool operator==(const View&) const = default;
+	};
+
+	int width = 0;
+	int height = 0;
+	FirstTouchVector<float> iterations;	// at reachedIterations
+	FirstTouchVector<int> escapeSteps;	// iterations to escape per pixel, -1 inside
+	std::vector<OrbitState> pending;	// pixels still inside at reachedIterations
+	std::vector<std::vector<OrbitState>> workerPending;
+	FirstTouchVector<float> thresholded;	// the field for a limit below reachedIterations
+	View view{};
+	int reachedIterations = 0;	// 0 when nothing can be resumed
+	int currentIterations = 0;
+	int resumedPixels = 0;
+	int tileIterationCap = 0;
+	int raisedTiles = 0;
+	int renderedTiles = 0;
+	std::vector<std::uint8_t> tileMask;	// empty renders every tile
+	int tileMaskVersion = 0;
+	const std::atomic<bool>* cancelFlag = nullptr;
+	bool mixedPrecision = true;
+	bool symmetry = true;
+	MirrorPlan mirror;	// of the last full render
+	int mirroredPixels = 0;
+	Precision uniformPrecision = Precision::Double;
+	PrecisionPlanner precisionPlan;	// of the field
+	PrecisionPlanner nextPlan;	// for the requested limit
+	ReferenceOrbit reference;	// at the centre of the view, for BigFloat tiles
+	int referenceIterations = 0;	// the limit it was computed for, 0 for none
+	int referenceLimbs = 0;
+
+	// Lanes of a perturbed batch
+	static constexpr int PERTURBED_LANES = 8;
+
+	void planPrecision(PrecisionPlanner& planner, const View& newView, int maxIterations, bool custom);
+	void renderFull(const View& newView, const KernelParams& params, const FormulaProgram* program, IterationHistogram* histogram);
+	void resume(const KernelParams& params);
+	// Continues up to kernelLanes<T> orbits that all stopped at the same iteration, up to
+	// params.maxIterations. Fixed128 and DoubleDouble orbits start over from the first
+	// iteration.
+	template<class T>
+	void continueLanes(OrbitState* orbits, int count, const KernelParams& params);
+	// Makes the reference orbit of the view cover maxIterations
+	void prepareReference(int maxIterations);
+	// Iterates up to PERTURBED_LANES pixels of BigFloat tiles from the start, against the
+	// reference orbit, and writes their results to the field
+	void perturbLanes(const std::uint32_t* pixels, int count, const KernelParams& params);
+	// continueLanes for any number of orbits that stopped at the same iteration, in tiles of
+	// the same precision
+	void continueOrbits(OrbitState* orbits, int count, const KernelParams& params);
+	// Raises the limit of one tile while it is still resolving; orbits are the tile's
+	// unescaped pixels at params.maxIterations. Returns how many are still unescaped.
+	int raiseTile(OrbitState* orbits, int count, int x0, int y0, int spanWidth, int rows, const KernelParams& params);
+	void threshold(int maxIterations);
+	// Fills the tile spans the mirror plan skipped, and gives them the pending orbits of
+	// their images
+	void mirrorField(IterationHistogram* histogram);
+	// Whether renderFull skipped the pixel's tile span to copy it
+	bool isMirrored(int column, int row) const {
+		const int x0 = column - column % TILE_SIZE;
+		return mirror.coversSpan(row, x0, std::min(x0 + TILE_SIZE, width));
+	}
+	// Runs rows(y0, y1, x0, x1) for the pixels of every tile on the pool, each tile on the
+	// worker that starts with it in renderFull
+	template<class Rows>
+	void forEachTile(const Rows& rows);
+
+	// The pixel's point in the plane, computed exactly as the span kernels compute it
+	void pixelPoint(int pixel, double& x, double& y) const;
+	template<class T>
+	void pixelPoint(int pixel, T& x, T& y) const;
+	// Where the span of a tile row starts in Fixed128 or DoubleDouble
+	template<class T>
+	void wideSpanStart(int column, int row, T& x, T& y) const;
+	Precision pixelPrecision(std::uint32_t pixel) const {
+		return precisionPlan.getPixel(static_cast<int>(pixel % width), static_cast<int>(pixel / width));
+	}
+
+public:
+	static constexpr int TILE_SIZE = 64;
+
+	void resize(int newWidth, int newHeight);
+
+	// Highest limit a tile may be raised to; 0 (the default) keeps every tile at the frame's
+	// maxIterations. Takes effect with the next full render.
+	void setTileIterationCap(int cap) { tileIterationCap = cap; }
+	// Off iterates every tile in the uniform precision, double unless set otherwise. Takes
+	// effect with the next full render.
+	void setMixedPrecision(bool enabled) { mixedPrecision = enabled; }
+	void setUniformPrecision(Precision precision) { uniformPrecision = precision; }
+	// Off iterates the mirror images of symmetric views as well. The picture is the same
+	// either way. Takes effect with the next full render.
+	void setSymmetry(bool enabled) { symmetry = enabled; }
+	// Renders only the tiles whose flag is set, one flag per tile in row-major order; the
+	// pixels of the others keep whatever they held. An empty mask renders every tile. Takes
+	// effect with the next full render, which a changed mask forces.
+	void setTileMask(const std::vector<std::uint8_t>& mask);
+	// While *flag is set, a full render skips the tiles it has not started, for a render
+	// running on another thread that is no longer wanted. The field it leaves is incomplete
+	// and is not resumed. Null (the default) never cancels.
+	void setCancelFlag(const std::atomic<bool>* flag) { cancelFlag = flag; }
+	// customFormula is used when formula is Formula::Custom. When histogram is given it is
+	// rebuilt for the new field.
+	void render(double centerX, double centerY, double xRange, double yRange, Formula formula, const KernelParams& params,
+		const FormulaProgram* customFormula = nullptr, IterationHistogram* histogram = nullptr);
+
+	int getWidth() const { return width; }
+	int getHeight() const { return height; }
+	const FirstTouchVector<float>& getIterations() const {
+		return currentIterations < reachedIterations ? thresholded : iterations;
+	}
+
+	// Unescaped pixels kept for resuming, and how many the last render continued (0 for
+	// a full render).
+	int getPendingCount() const { return static_cast<int>(pending.size()); }
+	int getResumedCount() const { return resumedPixels; }
+	int getRaisedTileCount() const { return raisedTiles; }
+	// Tiles the last render iterated from scratch; 0 when it resumed or re-thresholded
+	int getRenderedTileCount() const { return renderedTiles; }
+	// Pixels the last full render copied from their mirror images
+	int getMirroredCount() const { return mirroredPixels; }
+	// The precision of each tile in the last full render
+	const PrecisionPlanner& getPrecisionPlan() const { return precisionPlan; }
+};
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cmath>
+
+// Unevaluated sum of two doubles, hi + lo with |lo| at most half an ulp of hi, for about
+// 106 mantissa bits. Unlike Fixed128 it is floating point, so it has no range limit past a
+// double's and keeps its relative precision near the origin, at the cost of a few more
+// operations per product: see the arithmetic below. Escaped orbits overflow to infinity or
+// NaN in hi like a double.
+//
+// The algorithms are the error-free transformations of Dekker and Knuth; they rely on
+// every operation being rounded to double, so this must not be built with fast-math.
+class DoubleDouble {
+private:
+	double hi = 0.0;
+	double lo = 0.0;
+
+	DoubleDouble(double newHi, double newLo) : hi(newHi), lo(newLo) {}
+
+	// a + b exactly, as the rounded sum and its error
+	static DoubleDouble twoSum(double a, double b) {
+		const double s = a + b;
+		const double bb = s - a;
+		return DoubleDouble(s, (a - (s - bb)) + (b - bb));
+	}
+
+	// Renormalizes hi + lo where |hi| >= |lo|
+	static DoubleDouble quickTwoSum(double a, double b) {
+		const double s = a + b;
+		return DoubleDouble(s, b - (s - a));
+	}
+
+public:
+	DoubleDouble() = default;
+	explicit DoubleDouble(int value) : hi(value) {}
+	explicit DoubleDouble(double value) : hi(value) {}
+
+	explicit operator double() const { return hi; }
+
+	DoubleDouble operator-() const { return DoubleDouble(-hi, -lo); }
+
+	// The sloppy sum: the low words are added without their own error term, which loses
+	// nothing the orbit can see, since z^2 + c only adds numbers of similar magnitude
+	friend DoubleDouble operator+(const DoubleDouble& a, const DoubleDouble& b) {
+		const DoubleDouble s = twoSum(a.hi, b.hi);
+		return quickTwoSum(s.hi, s.lo + a.lo + b.lo);
+	}
+	friend DoubleDouble operator-(const DoubleDouble& a, const DoubleDouble& b) { return a + -b; }
+	DoubleDouble& operator+=(const DoubleDouble& other) { return *this = *this + other; }
+	DoubleDouble& operator-=(const DoubleDouble& other) { return *this = *this - other; }
+
+	// The error of hi * hi from a fused multiply-add, plus the cross terms; lo * lo is below
+	// the precision
+	friend DoubleDouble operator*(const DoubleDouble& a, const DoubleDouble& b) {
+		const double p = a.hi * b.hi;
+		const double e = std::fma(a.hi, b.hi, -p) + (a.hi * b.lo + a.lo * b.hi);
+		return quickTwoSum(p, e);
+	}
+
+	// False whenever hi is NaN, like the comparisons of a double
+	friend bool operator>(const DoubleDouble& a, const DoubleDouble& b) { return a.hi > b.hi || (a.hi == b.hi && a.lo > b.lo); }
+	friend bool operator<=(const DoubleDouble& a, const DoubleDouble& b) { return a.hi < b.hi || (a.hi == b.hi && a.lo <= b.lo); }
+	friend bool operator==(const DoubleDouble& a, const DoubleDouble& b) { return a.hi == b.hi && a.lo == b.lo; }
+
+	// Found by the kernels' `using std::abs`
+	friend DoubleDouble abs(const DoubleDouble& x) { return x.hi < 0.0 ? -x : x; }
+};
@@ -0,0 +1,255 @@
+#include "ExpMap.h"
+#include "Nucleus.h"
+#include "PrecisionPlanner.h"
+#include "ThreadPool.h"
+#include <SFML/Graphics/Image.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+
+namespace {
+	const double TWO_PI = 6.283185307179586;
+
+	// Strip samples iterated side by side in FloatExp
+	constexpr int DEEP_LANES = 8;
+
+	// Rings smaller than this go through FloatExp
+	const double DEEP_LOG_RADIUS = FloatExp::DOUBLE_EXPONENT * 0.6931471805599453;
+}
+
+ExpMapCapture::ExpMapCapture(const ExpMapSettings& s) : settings(s) {
+	settings.angularSamples = std::max(settings.angularSamples, 64);
+	settings.frameCount = std::max(settings.frameCount, 1);
+	settings.zoomDepth = std::max(settings.zoomDepth, 0.0);
+	logStartHalfWidth = std::log(settings.startHalfWidth);
+	logEndHalfWidth = logStartHalfWidth - settings.zoomDepth * std::log(10.0);
+
+	double diagonal = std::hypot(1.0, static_cast<double>(settings.frameHeight) / settings.frameWidth);
+	logRadiusStep = TWO_PI / settings.angularSamples;
+	logRadiusTop = logStartHalfWidth + std::log(diagonal);
+	double logRadiusBottom = logEndHalfWidth - std::log(static_cast<double>(settings.frameWidth));
+	totalRows = static_cast<int>(std::ceil((logRadiusTop - logRadiusBottom) / logRadiusStep)) + 2;
+
+	std::filesystem::create_directories(settings.outputDirectory);
+	reference = std::async(std::launch::async, [this] { computeReference(); });
+}
+
+ExpMapCapture::~ExpMapCapture() {
+	cancelled = true;
+	if (reference.valid()) {
+		reference.wait();
+	}
+}
+
+void ExpMapCapture::computeReference() {
+	// One reference orbit at the zoom centre serves every ring of the strip, because every
+	// sample is a pure offset from that centre.
+	//
+	// Past what a double resolves, a reference iterated in double drifts off the true orbit
+	// of the centre, so deeper videos iterate it with as many fraction bits as the last
+	// frame's pixels need, as PrecisionPlanner counts them. A nucleus is refined at that
+	// precision too, since the double nucleus is only within 1e-16 or so of the true one,
+	// and the video then zooms into the refined nucleus.
+	const double logPixel = logEndHalfWidth - std::log(settings.frameWidth * 0.5);
+	const double magnitude = std::max(std::hypot(settings.centerX, settings.centerY), 1.0);
+	const int guardBits = PrecisionPlanner::GUARD_BITS + static_cast<int>(std::ceil(std::log2(std::max(settings.maxIterations, 1))));
+	const int fractionBits = static_cast<int>(std::ceil(-logPixel / std::log(2.0))) + guardBits;
+	const int bits = fractionBits + static_cast<int>(std::ceil(std::log2(magnitude)));
+	const bool periodic = settings.period > 0 && settings.period < settings.maxIterations;
+	if (PrecisionPlanner::precisionFor(bits) > Precision::Double) {
+		const int limbs = BigFixed::limbsForBits(fractionBits);
+		BigFixed cx(limbs, settings.centerX);
+		BigFixed cy(limbs, settings.centerY);
+		if (periodic && refineNucleus(cx, cy, settings.period, 64, &cancelled)) {
+			orbit.computePeriodic(cx, cy, settings.period, &cancelled);
+		}
+		else {
+			// Without the nucleus the reference is the centre, iterated in full
+			orbit.compute(BigFixed(limbs, settings.centerX), BigFixed(limbs, settings.centerY), settings.maxIterations, &cancelled);
+		}
+	}
+	else if (periodic) {
+		orbit.computePeriodic(settings.centerX, settings.centerY, settings.period);
+	}
+	else {
+		orbit.compute(settings.centerX, settings.centerY, settings.maxIterations);
+	}
+}
+
+double ExpMapCapture::logFrameHalfWidth(int frame) const {
+	if (settings.frameCount == 1) {
+		return logStartHalfWidth;
+	}
+	double t = static_cast<double>(frame) / (settings.frameCount - 1);
+	return logStartHalfWidth + t * (logEndHalfWidth - logStartHalfWidth);
+}
+
+int ExpMapCapture::firstRowForFrame(int frame) const {
+	double diagonal = std::hypot(1.0, static_cast<double>(settings.frameHeight) / settings.frameWidth);
+	double v = (logRadiusTop - (logFrameHalfWidth(frame) + std::log(diagonal))) / logRadiusStep - 0.5;
+	return std::max(0, static_cast<int>(std::floor(v)));
+}
+
+int ExpMapCapture::lastRowForFrame(int frame) const {
+	// The innermost pixel of a frame sits half a pixel away from the centre.
+	double v = (logRadiusTop - (logFrameHalfWidth(frame) - std::log(static_cast<double>(settings.frameWidth)))) / logRadiusStep - 0.5;
+	return std::min(totalRows - 1, static_cast<int>(std::ceil(v)) + 1);
+}
+
+void ExpMapCapture::renderRows(int count) {
+	const int columns = settings.angularSamples;
+	for (int i = 0; i < count; ++i) {
+		rows.emplace_back(columns);
+	}
+
+	const int firstNew = static_cast<int>(rows.size()) - count;
+	const int groupsPerRow = (columns + DEEP_LANES - 1) / DEEP_LANES;
+	const int groups = count * groupsPerRow;
+
+	// Every sample of a row sits on the same ring, so a whole row is either in double range
+	// or not
+	ThreadPool::shared().parallelFor(groups, [&](int index, int) {
+		int row = index / groupsPerRow;
+		int first = (index % groupsPerRow) * DEEP_LANES;
+		double logRadius = logRadiusTop - (nextRow + row + 0.5) * logRadiusStep;
+		std::vector<float>& samples = rows[firstNew + row];
+
+		if (logRadius < DEEP_LOG_RADIUS) {
+			renderDeepSamples(samples.data(), logRadius, first);
+			return;
+		}
+		double radius = std::exp(logRadius);
+		for (int column = first; column < std::min(first + DEEP_LANES, columns); ++column) {
+			double angle = (column + 0.5) * logRadiusStep;
+			samples[column] = perturbedIterations(orbit, radius * std::cos(angle), radius * std::sin(angle), settings.maxIterations);
+		}
+	});
+
+	nextRow += count;
+}
+
+void ExpMapCapture::renderDeepSamples(float* row, double logRadius, int first) {
+	const int columns = settings.angularSamples;
+	const int lanes = std::min(DEEP_LANES, columns - first);
+	const FloatExp radius = FloatExp::fromLog(logRadius);
+	FloatExp dcx[DEEP_LANES], dcy[DEEP_LANES];
+	float values[DEEP_LANES];
+	for (int l = 0; l < DEEP_LANES; ++l) {
+		// Tail lanes repeat the last column, as in the CPU kernels
+		double angle = (first + std::min(l, lanes - 1) + 0.5) * logRadiusStep;
+		dcx[l] = radius * std::cos(angle);
+		dcy[l] = radius * std::sin(angle);
+	}
+	perturbedLanes<DEEP_LANES>(orbit, dcx, dcy, settings.maxIterations, values);
+	std::copy(values, values + lanes, row + first);
+}
+
+float ExpMapCapture::sampleStrip(double u, double v) const {
+	const int columns = settings.angularSamples;
+	double clamped = std::min(std::max(v, static_cast<double>(firstStoredRow)), static_cast<double>(nextRow - 1));
+
+	int v0 = static_cast<int>(std::floor(clamped));
+	int v1 = std::min(v0 + 1, nextRow - 1);
+	float fv = static_cast<float>(clamped - v0);
+
+	int u0 = static_cast<int>(std::floor(u));
+	float fu = static_cast<float>(u - u0);
+	u0 = ((u0 % columns) + columns) % columns;
+	int u1 = (u0 + 1) % columns;
+
+	const std::vector<float>& top = rows[v0 - firstStoredRow];
+	const std::vector<float>& bottom = rows[v1 - firstStoredRow];
+	float a = top[u0];
+	float b = top[u1];
+	float c = bottom[u0];
+	float d = bottom[u1];
+
+	// Interpolating across the set boundary would smear escape counts into the interior.
+	if (a < 0.0f || b < 0.0f || c < 0.0f || d < 0.0f) {
+		const std::vector<float>& nearestRow = fv < 0.5f ? top : bottom;
+		return nearestRow[fu < 0.5f ? u0 : u1];
+	}
+
+	float upper = a + (b - a) * fu;
+	float lower = c + (d - c) * fu;
+	return upper + (lower - upper) * fv;
+}
+
+void ExpMapCapture::writeFrame(int frame) {
+	const int width = settings.frameWidth;
+	const int height = settings.frameHeight;
+	// Pixel offsets stay in pixels and only their logarithm is scaled, since the pixel size
+	// itself can be far below the double range.
+	const double logPixelSize = std::log(2.0 / width) + logFrameHalfWidth(frame);
+	const int columns = settings.angularSamples;
+
+	std::vector<sf::Uint8> pixels(static_cast<size_t>(width) * height * 4);
+
+	ThreadPool::shared().parallelFor(height, [&](int py, int) {
+		for (int px = 0; px < width; ++px) {
+			double dx = px + 0.5 - 0.5 * width;
+			double dy = 0.5 * height - py - 0.5;
+			double radius = std::max(std::hypot(dx, dy), 0.25);
+
+			double angle = std::atan2(dy, dx);
+			if (angle < 0.0) {
+				angle += TWO_PI;
+			}
+
+			double u = angle / TWO_PI * columns - 0.5;
+			double v = (logRadiusTop - (std::log(radius) + logPixelSize)) / logRadiusStep - 0.5;
+
+			sf::Color color = settings.palette.color(sampleStrip(u, v), settings.maxIterations);
+			sf::Uint8* out = &pixels[(static_cast<size_t>(py) * width + px) * 4];
+			out[0] = color.r;
+			out[1] = color.g;
+			out[2] = color.b;
+			out[3] = 255;
+		}
+	});
+
+	sf::Image image;
+	image.create(width, height, pixels.data());
+
+	char name[32];
+	std::snprintf(name, sizeof(name), "frame_%05d.png", frame);
+	std::filesystem::path path = std::filesystem::path(settings.outputDirectory) / name;
+	if (!image.saveToFile(path.string())) {
+		std::cerr << "Failed to write " << path.string() << std::endl;
+	}
+}
+
+bool ExpMapCapture::step(int rowBudget) {
+	if (nextFrame >= settings.frameCount) {
+		return false;
+	}
+	if (reference.valid()) {
+		if (reference.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+			return true;
+		}
+		reference.get();
+	}
+
+	// Write at most one frame per call so the UI keeps ticking during long captures.
+	if (nextRow > lastRowForFrame(nextFrame)) {
+		writeFrame(nextFrame);
+		++nextFrame;
+
+		int keepFrom = nextFrame < settings.frameCount ? firstRowForFrame(nextFrame) : nextRow;
+		while (firstStoredRow < keepFrom && !rows.empty()) {
+			rows.pop_front();
+			++firstStoredRow;
+		}
+		return nextFrame < settings.frameCount;
+	}
+
+	renderRows(std::max(1, std::min(rowBudget, totalRows - nextRow)));
+	return true;
+}
+
+float ExpMapCapture::getProgress() const {
+	return static_cast<float>(nextFrame) / settings.frameCount;
+}
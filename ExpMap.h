@@ -0,0 +1,90 @@
+#pragma once
+
+#include "Palette.h"
+#include "Perturbation.h"
+#include <atomic>
+#include <deque>
+#include <future>
+#include <string>
+#include <vector>
+
+struct ExpMapSettings {
+	double centerX = 0.0;
+	double centerY = 0.0;
+	double startHalfWidth = 1.0;	// horizontal half-width of the first frame
+	double zoomDepth = 10.0;	// decades between the first frame and the last
+	int frameWidth = 1920;
+	int frameHeight = 1080;
+	int frameCount = 600;
+	int angularSamples = 4096;		// columns in the log-polar strip
+	int maxIterations = 500;
+	int period = 0;	// when the centre is a nucleus of this period, for a one-period reference orbit
+	PaletteLut palette;
+	std::string outputDirectory = "zoom_frames";
+};
+
+// Renders a zoom video from a single exponential-map (log-polar) strip around the zoom
+// centre. Column u of the strip is the angle, row v is log(radius) going inward, so each
+// row is the same ring of the plane at a slightly smaller scale. Every video frame is just
+// a band of rows resampled back to cartesian pixels.
+//
+// Rows are produced from the outside in and dropped once no remaining frame needs them,
+// so memory stays bounded by one frame's band no matter how deep the zoom goes.
+//
+// Radii and frame sizes are only ever handled as logarithms, and rings below the double
+// range are iterated with FloatExp deltas, so the depth is not limited to 1e-308.
+//
+// A deep video's reference orbit, and the nucleus it starts from, take BigFixed arithmetic
+// that can run for seconds, so they are computed on a thread of their own and the strip
+// only starts once they are done.
+class ExpMapCapture {
+private:
+	ExpMapSettings settings;
+	ReferenceOrbit orbit;
+	std::future<void> reference;	// computing orbit; invalid once step has taken it
+	std::atomic<bool> cancelled{ false };
+
+	double logRadiusTop;	// log of the outermost ring (corner of the first frame)
+	double logRadiusStep;	// 2 * pi / angularSamples, so strip samples are square
+	double logStartHalfWidth;
+	double logEndHalfWidth;
+	int totalRows;
+
+	std::deque<std::vector<float>> rows;
+	int firstStoredRow = 0;
+	int nextRow = 0;
+	int nextFrame = 0;
+
+	double logFrameHalfWidth(int frame) const;
+	int firstRowForFrame(int frame) const;
+	int lastRowForFrame(int frame) const;
+
+	// Runs on the reference thread
+	void computeReference();
+
+	void renderRows(int count);
+	// One strip sample per lane, columns first to first + DEEP_LANES - 1, for rings whose
+	// radius is below the double range
+	void renderDeepSamples(float* row, double logRadius, int first);
+	void writeFrame(int frame);
+	float sampleStrip(double u, double v) const;
+
+public:
+	explicit ExpMapCapture(const ExpMapSettings& settings);
+	// Stops the reference thread, if it is still running, and waits for it
+	~ExpMapCapture();
+
+	// Writes the next frame if its strip rows are all rendered, else renders up to rowBudget
+	// more rows; at most one frame per call, so the UI keeps ticking. Does neither while the
+	// reference orbit is still being computed. Returns false once the last frame has been
+	// written.
+	bool step(int rowBudget);
+
+	// Whether the reference orbit is still being computed
+	bool isComputingReference() const { return reference.valid(); }
+
+	float getProgress() const;
+	int getFramesWritten() const { return nextFrame; }
+	int getRowsRendered() const { return nextRow; }
+	int getTotalRows() const { return totalRows; }
+};
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+// A double mantissa with a 64-bit binary exponent, for values far outside the range of a
+// double: a perturbation delta at a 1e-1000 zoom is just an ordinary FloatExp. The
+// mantissa keeps 53 bits, so arithmetic is as precise as in double, only slower.
+//
+// Non-zero mantissas are kept in [1, 2) in magnitude. Products and sums of those are
+// always normal doubles, so normalizing only reads the exponent bits of the result and
+// never calls frexp.
+class FloatExp {
+private:
+	double mantissa;
+	std::int64_t exponent;
+
+	static constexpr std::int64_t ZERO_EXPONENT = INT64_MIN / 4;	// below any real exponent, and safe to add
+
+	static std::int64_t exponentBits(double value) {
+		std::uint64_t bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+		return static_cast<std::int64_t>((bits >> 52) & 0x7ff) - 1023;
+	}
+
+	// 2^power for power in [-1022, 1023]
+	static double powerOfTwo(std::int64_t power) {
+		const std::uint64_t bits = static_cast<std::uint64_t>(power + 1023) << 52;
+		double value;
+		std::memcpy(&value, &bits, sizeof(value));
+		return value;
+	}
+
+public:
+	// From this exponent up a double holds the value with its full 53 bits. Below it a
+	// product can already land among the subnormals.
+	static constexpr std::int64_t DOUBLE_EXPONENT = -960;
+
+	FloatExp() : mantissa(0.0), exponent(ZERO_EXPONENT) {}
+	FloatExp(double m, std::int64_t e) : mantissa(m), exponent(e) { normalize(); }
+	explicit FloatExp(double value) : FloatExp(value, 0) {}
+
+	// e^logarithm times sign, without going through a double that could underflow
+	static FloatExp fromLog(double logarithm, double sign = 1.0) {
+		const double log2 = logarithm / 0.6931471805599453;
+		const double whole = std::floor(log2);
+		return FloatExp(sign * std::exp2(log2 - whole), static_cast<std::int64_t>(whole));
+	}
+
+	void normalize() {
+		if (mantissa == 0.0 || !std::isfinite(mantissa)) {
+			exponent = mantissa == 0.0 ? ZERO_EXPONENT : exponent;
+			return;
+		}
+		// Subnormal inputs only come from callers, never from the arithmetic below
+		if (std::fpclassify(mantissa) == FP_SUBNORMAL) {
+			mantissa *= 0x1p64;
+			exponent -= 64;
+		}
+		const std::int64_t shift = exponentBits(mantissa);
+		mantissa *= powerOfTwo(-shift);
+		exponent += shift;
+	}
+
+	double getMantissa() const { return mantissa; }
+	std::int64_t getExponent() const { return exponent; }
+
+	// Underflows to zero and overflows to infinity like a double would
+	double toDouble() const {
+		const std::int64_t clamped = exponent < -2000 ? -2000 : (exponent > 2000 ? 2000 : exponent);
+		return std::ldexp(mantissa, static_cast<int>(clamped));
+	}
+
+	// True once the value can be handed to plain double arithmetic without losing bits.
+	// False for zero, which says nothing about the scale of what it will be added to.
+	bool inDoubleRange() const { return exponent >= DOUBLE_EXPONENT; }
+
+	FloatExp operator-() const {
+		FloatExp result = *this;
+		result.mantissa = -mantissa;
+		return result;
+	}
+
+	friend FloatExp operator*(const FloatExp& a, const FloatExp& b) {
+		return FloatExp(a.mantissa * b.mantissa, a.exponent + b.exponent);
+	}
+
+	friend FloatExp operator*(const FloatExp& a, double b) {
+		return a * FloatExp(b);
+	}
+
+	// The smaller operand is shifted onto the larger one's exponent; past 64 bits apart it
+	// no longer shows in the mantissa at all.
+	friend FloatExp operator+(const FloatExp& a, const FloatExp& b) {
+		const std::int64_t difference = a.exponent - b.exponent;
+		if (difference > 64 || b.mantissa == 0.0) {
+			return a;
+		}
+		if (difference < -64 || a.mantissa == 0.0) {
+			return b;
+		}
+		if (difference >= 0) {
+			return FloatExp(a.mantissa + b.mantissa * powerOfTwo(-difference), a.exponent);
+		}
+		return FloatExp(a.mantissa * powerOfTwo(difference) + b.mantissa, b.exponent);
+	}
+
+	friend FloatExp operator-(const FloatExp& a, const FloatExp& b) {
+		return a + -b;
+	}
+
+	friend FloatExp operator/(const FloatExp& a, const FloatExp& b) {
+		return FloatExp(a.mantissa / b.mantissa, a.exponent - b.exponent);
+	}
+};
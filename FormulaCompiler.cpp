@@ -0,0 +1,720 @@
+#include "FormulaCompiler.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+namespace {
+	enum class TokenType {
+		Number,
+		Identifier,
+		Operator,
+		LeftParen,
+		RightParen,
+		End
+	};
+
+	struct Token {
+		TokenType type;
+		std::string text;
+		double value;
+		size_t position;
+	};
+
+	bool tokenize(const std::string& text, std::vector<Token>& tokens, std::string& error) {
+		size_t i = 0;
+		while (i < text.size()) {
+			char ch = text[i];
+			if (std::isspace(static_cast<unsigned char>(ch))) {
+				++i;
+			}
+			else if (std::isdigit(static_cast<unsigned char>(ch)) || ch == '.') {
+				const char* begin = text.c_str() + i;
+				char* end = nullptr;
+				double value = std::strtod(begin, &end);
+				if (end == begin) {
+					error = "Invalid number at position " + std::to_string(i);
+					return false;
+				}
+				tokens.push_back({ TokenType::Number, std::string(begin, static_cast<size_t>(end - begin)), value, i });
+				i += static_cast<size_t>(end - begin);
+			}
+			else if (std::isalpha(static_cast<unsigned char>(ch)) || ch == '_') {
+				size_t start = i;
+				while (i < text.size() && (std::isalnum(static_cast<unsigned char>(text[i])) || text[i] == '_')) {
+					++i;
+				}
+				tokens.push_back({ TokenType::Identifier, text.substr(start, i - start), 0.0, start });
+			}
+			else if (ch == '(') {
+				tokens.push_back({ TokenType::LeftParen, "(", 0.0, i++ });
+			}
+			else if (ch == ')') {
+				tokens.push_back({ TokenType::RightParen, ")", 0.0, i++ });
+			}
+			else if (ch == '+' || ch == '-' || ch == '*' || ch == '/' || ch == '^' || ch == '=') {
+				tokens.push_back({ TokenType::Operator, std::string(1, ch), 0.0, i++ });
+			}
+			else {
+				error = std::string("Unexpected character '") + ch + "' at position " + std::to_string(i);
+				return false;
+			}
+		}
+		tokens.push_back({ TokenType::End, "", 0.0, text.size() });
+		return true;
+	}
+
+	// A parsed subexpression: either a compile-time constant or a register.
+	struct Operand {
+		bool isConstant;
+		std::complex<double> value;
+		int reg;
+	};
+
+	struct FunctionInfo {
+		const char* name;
+		OpCode op;
+	};
+
+	const FunctionInfo FUNCTIONS[] = {
+		{ "exp", OpCode::Exp },
+		{ "log", OpCode::Log },
+		{ "sqrt", OpCode::Sqrt },
+		{ "sin", OpCode::Sin },
+		{ "cos", OpCode::Cos },
+		{ "tan", OpCode::Tan },
+		{ "sinh", OpCode::Sinh },
+		{ "cosh", OpCode::Cosh },
+		{ "abs", OpCode::Abs },
+		{ "conj", OpCode::Conj },
+		{ "re", OpCode::Real },
+		{ "im", OpCode::Imag },
+	};
+
+	std::complex<double> evaluateUnary(OpCode op, std::complex<double> a) {
+		switch (op) {
+		case OpCode::Neg: return -a;
+		case OpCode::Sqr: return a * a;
+		case OpCode::Exp: return std::exp(a);
+		case OpCode::Log: return std::log(a);
+		case OpCode::Sqrt: return std::sqrt(a);
+		case OpCode::Sin: return std::sin(a);
+		case OpCode::Cos: return std::cos(a);
+		case OpCode::Tan: return std::tan(a);
+		case OpCode::Sinh: return std::sinh(a);
+		case OpCode::Cosh: return std::cosh(a);
+		case OpCode::Abs: return { std::abs(a.real()), std::abs(a.imag()) };
+		case OpCode::Conj: return std::conj(a);
+		case OpCode::Real: return { a.real(), 0.0 };
+		case OpCode::Imag: return { a.imag(), 0.0 };
+		default: return a;
+		}
+	}
+
+	std::complex<double> evaluateBinary(OpCode op, std::complex<double> a, std::complex<double> b) {
+		switch (op) {
+		case OpCode::Add: return a + b;
+		case OpCode::Sub: return a - b;
+		case OpCode::Mul: return a * b;
+		case OpCode::Div: return a / b;
+		case OpCode::Pow: return std::pow(a, b);
+		default: return a;
+		}
+	}
+
+	// Recursive-descent parser that emits bytecode as it goes.
+	//
+	//   formula := [ "z" "=" ] expr
+	//   expr    := term { ("+" | "-") term }
+	//   term    := unary { ("*" | "/") unary | implicit-multiply unary }
+	//   unary   := "-" unary | power
+	//   power   := primary [ "^" unary ]
+	//   primary := number | "z" | "c" | "i" | "pi" | "e" | function "(" expr ")" | "(" expr ")"
+	class Parser {
+	private:
+		const std::vector<Token>& tokens;
+		size_t next = 0;
+		std::vector<Instruction>& prologue;
+		std::vector<Instruction>& body;
+		int& registerCount;
+		std::string& error;
+		bool invariant[FormulaProgram::MAX_REGISTERS] = { false };
+		double degree[FormulaProgram::MAX_REGISTERS] = { 0.0 };	// polynomial degree in z, for smooth colouring
+
+		const Token& peek() const { return tokens[next]; }
+
+		bool fail(const std::string& message) {
+			if (error.empty()) {
+				error = message + " at position " + std::to_string(peek().position);
+			}
+			return false;
+		}
+
+		bool allocate(int& reg) {
+			if (registerCount >= FormulaProgram::MAX_REGISTERS) {
+				return fail("Formula is too long");
+			}
+			reg = registerCount++;
+			return true;
+		}
+
+		bool materialize(Operand& operand) {
+			if (!operand.isConstant) {
+				return true;
+			}
+			// Folding can overflow or divide by zero, and GLSL has no literal for the result
+			if (!std::isfinite(operand.value.real()) || !std::isfinite(operand.value.imag())) {
+				return fail("Constant expression is not finite");
+			}
+			int reg = 0;
+			if (!allocate(reg)) {
+				return false;
+			}
+			prologue.push_back({ OpCode::Const, static_cast<std::uint8_t>(reg), 0, 0, 0, operand.value });
+			invariant[reg] = true;
+			operand = { false, {}, reg };
+			return true;
+		}
+
+		// Anything that does not depend on z, such as sin(c), is the same on every iteration
+		// and goes into the prologue instead of the loop body.
+		void emit(const Instruction& instruction, bool isInvariant) {
+			double a = degree[instruction.a];
+			double b = degree[instruction.b];
+			double d = a;
+			switch (instruction.op) {
+			case OpCode::Add:
+			case OpCode::Sub: d = std::max(a, b); break;
+			case OpCode::Mul: d = a + b; break;
+			case OpCode::Div: d = std::max(a - b, 0.0); break;
+			case OpCode::Sqr: d = 2.0 * a; break;
+			case OpCode::PowInt: d = instruction.power * a; break;
+			case OpCode::Sqrt: d = 0.5 * a; break;
+			default: break;
+			}
+			degree[instruction.dst] = d;
+			invariant[instruction.dst] = isInvariant;
+			(isInvariant ? prologue : body).push_back(instruction);
+		}
+
+		bool emitUnary(OpCode op, Operand a, Operand& result, int power = 0) {
+			if (a.isConstant && op != OpCode::PowInt) {
+				result = { true, evaluateUnary(op, a.value), -1 };
+				return true;
+			}
+			int reg = 0;
+			if (!materialize(a) || !allocate(reg)) {
+				return false;
+			}
+			emit({ op, static_cast<std::uint8_t>(reg), static_cast<std::uint8_t>(a.reg), 0, power, {} }, invariant[a.reg]);
+			result = { false, {}, reg };
+			return true;
+		}
+
+		bool emitBinary(OpCode op, Operand a, Operand b, Operand& result) {
+			if (a.isConstant && b.isConstant) {
+				result = { true, evaluateBinary(op, a.value, b.value), -1 };
+				return true;
+			}
+			int reg = 0;
+			if (!materialize(a) || !materialize(b) || !allocate(reg)) {
+				return false;
+			}
+			emit({ op, static_cast<std::uint8_t>(reg), static_cast<std::uint8_t>(a.reg), static_cast<std::uint8_t>(b.reg), 0, {} },
+				invariant[a.reg] && invariant[b.reg]);
+			result = { false, {}, reg };
+			return true;
+		}
+
+		// Integer exponents become repeated multiplication instead of exp(b * log(a)).
+		bool emitPower(Operand base, Operand exponent, Operand& result) {
+			double n = exponent.value.real();
+			bool integral = exponent.isConstant && exponent.value.imag() == 0.0 && n == std::floor(n) && std::abs(n) <= 64.0;
+			if (!integral || base.isConstant) {
+				return emitBinary(OpCode::Pow, base, exponent, result);
+			}
+
+			int power = static_cast<int>(std::abs(n));
+			if (power == 0) {
+				result = { true, { 1.0, 0.0 }, -1 };
+				return true;
+			}
+
+			Operand positive = base;
+			if (power == 2) {
+				if (!emitUnary(OpCode::Sqr, base, positive)) {
+					return false;
+				}
+			}
+			else if (power > 2 && !emitUnary(OpCode::PowInt, base, positive, power)) {
+				return false;
+			}
+
+			if (n < 0.0) {
+				return emitBinary(OpCode::Div, { true, { 1.0, 0.0 }, -1 }, positive, result);
+			}
+			result = positive;
+			return true;
+		}
+
+		bool parsePrimary(Operand& result) {
+			const Token& token = peek();
+			if (token.type == TokenType::Number) {
+				++next;
+				result = { true, { token.value, 0.0 }, -1 };
+				return true;
+			}
+			if (token.type == TokenType::LeftParen) {
+				++next;
+				if (!parseExpression(result)) {
+					return false;
+				}
+				if (peek().type != TokenType::RightParen) {
+					return fail("Expected ')'");
+				}
+				++next;
+				return true;
+			}
+			if (token.type != TokenType::Identifier) {
+				return fail("Expected a value");
+			}
+
+			++next;
+			const std::string& name = token.text;
+			if (name == "z") {
+				result = { false, {}, FormulaProgram::Z_REGISTER };
+				return true;
+			}
+			if (name == "c") {
+				result = { false, {}, FormulaProgram::C_REGISTER };
+				return true;
+			}
+			if (name == "i") {
+				result = { true, { 0.0, 1.0 }, -1 };
+				return true;
+			}
+			if (name == "pi") {
+				result = { true, { 3.14159265358979323846, 0.0 }, -1 };
+				return true;
+			}
+			if (name == "e") {
+				result = { true, { 2.71828182845904523536, 0.0 }, -1 };
+				return true;
+			}
+
+			for (const FunctionInfo& function : FUNCTIONS) {
+				if (name == function.name) {
+					if (peek().type != TokenType::LeftParen) {
+						return fail("Expected '(' after " + name);
+					}
+					++next;
+					Operand argument;
+					if (!parseExpression(argument)) {
+						return false;
+					}
+					if (peek().type != TokenType::RightParen) {
+						return fail("Expected ')'");
+					}
+					++next;
+					return emitUnary(function.op, argument, result);
+				}
+			}
+
+			--next;
+			return fail("Unknown name '" + name + "'");
+		}
+
+		bool parsePower(Operand& result) {
+			if (!parsePrimary(result)) {
+				return false;
+			}
+			if (peek().type == TokenType::Operator && peek().text == "^") {
+				++next;
+				Operand exponent;
+				if (!parseUnary(exponent)) {
+					return false;
+				}
+				return emitPower(result, exponent, result);
+			}
+			return true;
+		}
+
+		bool parseUnary(Operand& result) {
+			if (peek().type == TokenType::Operator && peek().text == "-") {
+				++next;
+				Operand operand;
+				if (!parseUnary(operand)) {
+					return false;
+				}
+				return emitUnary(OpCode::Neg, operand, result);
+			}
+			if (peek().type == TokenType::Operator && peek().text == "+") {
+				++next;
+				return parseUnary(result);
+			}
+			return parsePower(result);
+		}
+
+		bool parseTerm(Operand& result) {
+			if (!parseUnary(result)) {
+				return false;
+			}
+			while (true) {
+				const Token& token = peek();
+				OpCode op;
+				if (token.type == TokenType::Operator && (token.text == "*" || token.text == "/")) {
+					op = token.text == "*" ? OpCode::Mul : OpCode::Div;
+					++next;
+				}
+				else if (token.type == TokenType::Identifier || token.type == TokenType::LeftParen) {
+					// Implicit multiplication, as in "2z" or "3i"
+					op = OpCode::Mul;
+				}
+				else {
+					return true;
+				}
+
+				Operand rhs;
+				if (!parseUnary(rhs) || !emitBinary(op, result, rhs, result)) {
+					return false;
+				}
+			}
+		}
+
+	public:
+		Parser(const std::vector<Token>& tokens, std::vector<Instruction>& prologue, std::vector<Instruction>& body,
+			int& registerCount, std::string& error)
+			: tokens(tokens), prologue(prologue), body(body), registerCount(registerCount), error(error) {
+			invariant[FormulaProgram::C_REGISTER] = true;
+			degree[FormulaProgram::Z_REGISTER] = 1.0;
+		}
+
+		double degreeOf(int reg) const { return degree[reg]; }
+
+		bool parseExpression(Operand& result) {
+			if (!parseTerm(result)) {
+				return false;
+			}
+			while (peek().type == TokenType::Operator && (peek().text == "+" || peek().text == "-")) {
+				OpCode op = peek().text == "+" ? OpCode::Add : OpCode::Sub;
+				++next;
+				Operand rhs;
+				if (!parseTerm(rhs) || !emitBinary(op, result, rhs, result)) {
+					return false;
+				}
+			}
+			return true;
+		}
+
+		bool parseFormula(Operand& result) {
+			// Optional "z =" prefix
+			if (tokens.size() > 2 && tokens[0].type == TokenType::Identifier && tokens[0].text == "z" &&
+				tokens[1].type == TokenType::Operator && tokens[1].text == "=") {
+				next = 2;
+			}
+			if (!parseExpression(result)) {
+				return false;
+			}
+			if (peek().type != TokenType::End) {
+				return fail("Unexpected '" + peek().text + "'");
+			}
+			// The result has to live in a register that the iteration can copy back into z.
+			return materialize(result);
+		}
+	};
+
+	std::string glslNumber(double value) {
+		char text[32];
+		std::snprintf(text, sizeof(text), "%.9g", value);
+		std::string result = text;
+		if (result.find_first_of(".eEn") == std::string::npos) {
+			result += ".0";
+		}
+		return result;
+	}
+}
+
+bool FormulaProgram::compile(const std::string& text, std::string& error) {
+	error.clear();
+
+	std::vector<Token> tokens;
+	if (!tokenize(text, tokens, error)) {
+		return false;
+	}
+
+	std::vector<Instruction> newPrologue;
+	std::vector<Instruction> newBody;
+	int newRegisterCount = 2;
+	Parser parser(tokens, newPrologue, newBody, newRegisterCount, error);
+
+	Operand result;
+	if (!parser.parseFormula(result)) {
+		return false;
+	}
+
+	source = text;
+	prologue = std::move(newPrologue);
+	body = std::move(newBody);
+	registerCount = newRegisterCount;
+	resultRegister = result.reg;
+	// Escape speed follows the leading power of z; fall back to 2 for non-polynomial formulas.
+	double escapeDegree = parser.degreeOf(result.reg);
+	logDegree = std::log(escapeDegree > 1.0 ? escapeDegree : 2.0);
+	valid = true;
+	return true;
+}
+
+namespace {
+	// Runs each instruction across all lanes of the batch before moving on to the next one.
+	template<int L>
+	void executeBatch(const std::vector<Instruction>& code, double (*re)[L], double (*im)[L]) {
+		for (const Instruction& in : code) {
+			double* dr = re[in.dst];
+			double* di = im[in.dst];
+			const double* ar = re[in.a];
+			const double* ai = im[in.a];
+			const double* br = re[in.b];
+			const double* bi = im[in.b];
+
+			switch (in.op) {
+			case OpCode::Const:
+				for (int l = 0; l < L; ++l) { dr[l] = in.constant.real(); di[l] = in.constant.imag(); }
+				break;
+			case OpCode::Add:
+				for (int l = 0; l < L; ++l) { dr[l] = ar[l] + br[l]; di[l] = ai[l] + bi[l]; }
+				break;
+			case OpCode::Sub:
+				for (int l = 0; l < L; ++l) { dr[l] = ar[l] - br[l]; di[l] = ai[l] - bi[l]; }
+				break;
+			case OpCode::Mul:
+				for (int l = 0; l < L; ++l) {
+					double r = ar[l] * br[l] - ai[l] * bi[l];
+					di[l] = ar[l] * bi[l] + ai[l] * br[l];
+					dr[l] = r;
+				}
+				break;
+			case OpCode::Div:
+				for (int l = 0; l < L; ++l) {
+					double d = br[l] * br[l] + bi[l] * bi[l];
+					double r = (ar[l] * br[l] + ai[l] * bi[l]) / d;
+					di[l] = (ai[l] * br[l] - ar[l] * bi[l]) / d;
+					dr[l] = r;
+				}
+				break;
+			case OpCode::Neg:
+				for (int l = 0; l < L; ++l) { dr[l] = -ar[l]; di[l] = -ai[l]; }
+				break;
+			case OpCode::Sqr:
+				for (int l = 0; l < L; ++l) {
+					double r = ar[l] * ar[l] - ai[l] * ai[l];
+					di[l] = 2.0 * ar[l] * ai[l];
+					dr[l] = r;
+				}
+				break;
+			case OpCode::PowInt:
+				for (int l = 0; l < L; ++l) {
+					double xr = ar[l], xi = ai[l];
+					double rr = 1.0, ri = 0.0;
+					for (int e = in.power; e > 0; e >>= 1) {
+						if (e & 1) {
+							double t = rr * xr - ri * xi;
+							ri = rr * xi + ri * xr;
+							rr = t;
+						}
+						double t = xr * xr - xi * xi;
+						xi = 2.0 * xr * xi;
+						xr = t;
+					}
+					dr[l] = rr;
+					di[l] = ri;
+				}
+				break;
+			case OpCode::Exp:
+				for (int l = 0; l < L; ++l) {
+					double m = std::exp(ar[l]);
+					double y = ai[l];
+					dr[l] = m * std::cos(y);
+					di[l] = m * std::sin(y);
+				}
+				break;
+			case OpCode::Log:
+				for (int l = 0; l < L; ++l) {
+					double r = 0.5 * std::log(ar[l] * ar[l] + ai[l] * ai[l]);
+					di[l] = std::atan2(ai[l], ar[l]);
+					dr[l] = r;
+				}
+				break;
+			case OpCode::Sin:
+				for (int l = 0; l < L; ++l) {
+					double x = ar[l], y = ai[l];
+					dr[l] = std::sin(x) * std::cosh(y);
+					di[l] = std::cos(x) * std::sinh(y);
+				}
+				break;
+			case OpCode::Cos:
+				for (int l = 0; l < L; ++l) {
+					double x = ar[l], y = ai[l];
+					dr[l] = std::cos(x) * std::cosh(y);
+					di[l] = -std::sin(x) * std::sinh(y);
+				}
+				break;
+			case OpCode::Sinh:
+				for (int l = 0; l < L; ++l) {
+					double x = ar[l], y = ai[l];
+					dr[l] = std::sinh(x) * std::cos(y);
+					di[l] = std::cosh(x) * std::sin(y);
+				}
+				break;
+			case OpCode::Cosh:
+				for (int l = 0; l < L; ++l) {
+					double x = ar[l], y = ai[l];
+					dr[l] = std::cosh(x) * std::cos(y);
+					di[l] = std::sinh(x) * std::sin(y);
+				}
+				break;
+			case OpCode::Abs:
+				for (int l = 0; l < L; ++l) { dr[l] = std::abs(ar[l]); di[l] = std::abs(ai[l]); }
+				break;
+			case OpCode::Conj:
+				for (int l = 0; l < L; ++l) { dr[l] = ar[l]; di[l] = -ai[l]; }
+				break;
+			case OpCode::Real:
+				for (int l = 0; l < L; ++l) { dr[l] = ar[l]; di[l] = 0.0; }
+				break;
+			case OpCode::Imag:
+				for (int l = 0; l < L; ++l) { dr[l] = ai[l]; di[l] = 0.0; }
+				break;
+			case OpCode::Pow:
+			case OpCode::Sqrt:
+			case OpCode::Tan:
+			default:
+				// Rare, branchy functions go through std::complex lane by lane.
+				for (int l = 0; l < L; ++l) {
+					std::complex<double> a(ar[l], ai[l]);
+					std::complex<double> r = in.op == OpCode::Pow ? std::pow(a, std::complex<double>(br[l], bi[l])) : evaluateUnary(in.op, a);
+					dr[l] = r.real();
+					di[l] = r.imag();
+				}
+				break;
+			}
+		}
+	}
+}
+
+void FormulaProgram::iterateBatch(const double* px, const double* py, float* out, const KernelParams& params) const {
+	constexpr int L = BATCH_LANES;
+	alignas(64) double re[MAX_REGISTERS][L];
+	alignas(64) double im[MAX_REGISTERS][L];
+	double magnitude[L];
+	int escapedAt[L];
+
+	for (int l = 0; l < L; ++l) {
+		re[Z_REGISTER][l] = 0.0;
+		im[Z_REGISTER][l] = 0.0;
+		re[C_REGISTER][l] = px[l];
+		im[C_REGISTER][l] = py[l];
+		magnitude[l] = 0.0;
+		escapedAt[l] = -1;
+	}
+
+	executeBatch<L>(prologue, re, im);
+
+	for (int iteration = 0; iteration < params.maxIterations; ++iteration) {
+		executeBatch<L>(body, re, im);
+
+		int running = 0;
+		const double* rr = re[resultRegister];
+		const double* ri = im[resultRegister];
+		for (int l = 0; l < L; ++l) {
+			double m = rr[l] * rr[l] + ri[l] * ri[l];
+			bool active = escapedAt[l] < 0;
+			bool escapes = active && m > 4.0;
+			re[Z_REGISTER][l] = active ? rr[l] : re[Z_REGISTER][l];
+			im[Z_REGISTER][l] = active ? ri[l] : im[Z_REGISTER][l];
+			magnitude[l] = escapes ? m : magnitude[l];
+			escapedAt[l] = escapes ? iteration : escapedAt[l];
+			running += (active && !escapes) ? 1 : 0;
+		}
+		if (running == 0) {
+			break;
+		}
+	}
+
+	for (int l = 0; l < L; ++l) {
+		out[l] = escapedAt[l] < 0 ? -1.0f : static_cast<float>(escapedAt[l] + 2 - std::log(std::log(std::sqrt(magnitude[l]))) / logDegree);
+	}
+}
+
+void FormulaProgram::renderSpan(double x0, double dx, double y, int count, float* out, const KernelParams& params) const {
+	double px[BATCH_LANES], py[BATCH_LANES];
+	float values[BATCH_LANES];
+
+	for (int start = 0; start < count; start += BATCH_LANES) {
+		int lanes = count - start < BATCH_LANES ? count - start : BATCH_LANES;
+		for (int l = 0; l < BATCH_LANES; ++l) {
+			int index = start + (l < lanes ? l : lanes - 1);
+			px[l] = x0 + dx * index;
+			py[l] = y;
+		}
+		iterateBatch(px, py, values, params);
+		for (int l = 0; l < lanes; ++l) {
+			out[start + l] = values[l];
+		}
+	}
+}
+
+std::string FormulaProgram::glslDefines() const {
+	auto reg = [](int r) {
+		if (r == Z_REGISTER) {
+			return std::string("z");
+		}
+		if (r == C_REGISTER) {
+			return std::string("c");
+		}
+		return "r" + std::to_string(r);
+	};
+
+	auto statement = [&](const Instruction& in) {
+		std::string a = reg(in.a);
+		std::string b = reg(in.b);
+		std::string expression;
+		switch (in.op) {
+		case OpCode::Const: expression = "vec2(" + glslNumber(in.constant.real()) + ", " + glslNumber(in.constant.imag()) + ")"; break;
+		case OpCode::Add: expression = a + " + " + b; break;
+		case OpCode::Sub: expression = a + " - " + b; break;
+		case OpCode::Mul: expression = "cmul(" + a + ", " + b + ")"; break;
+		case OpCode::Div: expression = "cdiv(" + a + ", " + b + ")"; break;
+		case OpCode::Neg: expression = "-" + a; break;
+		case OpCode::Sqr: expression = "cmul(" + a + ", " + a + ")"; break;
+		case OpCode::PowInt: expression = "cpowi(" + a + ", " + std::to_string(in.power) + ")"; break;
+		case OpCode::Pow: expression = "cpow(" + a + ", " + b + ")"; break;
+		case OpCode::Exp: expression = "cexp(" + a + ")"; break;
+		case OpCode::Log: expression = "clog(" + a + ")"; break;
+		case OpCode::Sqrt: expression = "csqrt(" + a + ")"; break;
+		case OpCode::Sin: expression = "csin(" + a + ")"; break;
+		case OpCode::Cos: expression = "ccos(" + a + ")"; break;
+		case OpCode::Tan: expression = "cdiv(csin(" + a + "), ccos(" + a + "))"; break;
+		case OpCode::Sinh: expression = "csinh(" + a + ")"; break;
+		case OpCode::Cosh: expression = "ccosh(" + a + ")"; break;
+		case OpCode::Abs: expression = "abs(" + a + ")"; break;
+		case OpCode::Conj: expression = "vec2(" + a + ".x, -" + a + ".y)"; break;
+		case OpCode::Real: expression = "vec2(" + a + ".x, 0.0)"; break;
+		case OpCode::Imag: expression = "vec2(" + a + ".y, 0.0)"; break;
+		default: expression = a; break;
+		}
+		return "vec2 " + reg(in.dst) + " = " + expression + "; ";
+	};
+
+	// The shader compiler does its own hoisting, so prologue and body are emitted in order.
+	std::string code;
+	for (const Instruction& in : prologue) {
+		code += statement(in);
+	}
+	for (const Instruction& in : body) {
+		code += statement(in);
+	}
+	code += "return " + reg(resultRegister) + ";";
+
+	return "#define CUSTOM_FORMULA_BODY " + code + "\n";
+}
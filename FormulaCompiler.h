@@ -0,0 +1,83 @@
+#pragma once
+
+#include "Kernels.h"
+#include <complex>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// User-entered iteration formulas such as "z = z^3 + sin(c)".
+//
+// The text is parsed once into a small register-based bytecode. Register 0 holds z and
+// register 1 holds c; every other register is written exactly once per iteration, and
+// constant subexpressions are folded at compile time. The CPU interpreter runs each
+// instruction over a whole batch of pixels, so dispatch is paid once per batch rather than
+// once per pixel and each opcode's lane loop vectorizes like the built-in kernels. Terms
+// that do not depend on z are hoisted out of the iteration loop. The same bytecode is
+// translated to GLSL for the shader path.
+enum class OpCode : std::uint8_t {
+	Const,
+	Add,
+	Sub,
+	Mul,
+	Div,
+	Neg,
+	Sqr,
+	PowInt,
+	Pow,
+	Exp,
+	Log,
+	Sqrt,
+	Sin,
+	Cos,
+	Tan,
+	Sinh,
+	Cosh,
+	Abs,
+	Conj,
+	Real,
+	Imag
+};
+
+struct Instruction {
+	OpCode op;
+	std::uint8_t dst;
+	std::uint8_t a;
+	std::uint8_t b;
+	int power;						// exponent for PowInt
+	std::complex<double> constant;	// value for Const
+};
+
+class FormulaProgram {
+private:
+	std::string source;
+	std::vector<Instruction> prologue;	// constants and terms without z, run once per batch
+	std::vector<Instruction> body;		// run every iteration
+	int registerCount = 2;
+	int resultRegister = 0;
+	double logDegree = 0.6931471805599453;
+	bool valid = false;
+
+	void iterateBatch(const double* px, const double* py, float* out, const KernelParams& params) const;
+
+public:
+	static constexpr int Z_REGISTER = 0;
+	static constexpr int C_REGISTER = 1;
+	static constexpr int MAX_REGISTERS = 64;
+	static constexpr int BATCH_LANES = 16;
+
+	// Parses and compiles a formula. On failure the previous program is kept and `error`
+	// describes the problem.
+	bool compile(const std::string& text, std::string& error);
+
+	bool isValid() const { return valid; }
+	const std::string& getSource() const { return source; }
+	int getInstructionCount() const { return static_cast<int>(prologue.size() + body.size()); }
+
+	// Same contract as the built-in span kernels in Kernels.h.
+	void renderSpan(double x0, double dx, double y, int count, float* out, const KernelParams& params) const;
+
+	// A "#define CUSTOM_FORMULA_BODY ..." line implementing the formula with the complex
+	// helpers in mandelbrot.frag, for use together with FORMULA_CUSTOM.
+	std::string glslDefines() const;
+};
@@ -0,0 +1,26 @@
+#include "FrameUniforms.h"
+#include <cstring>
+
+static_assert(sizeof(FrameParams) == 96, "FrameParams must match the std140 layout of the GLSL block");
+
+bool FrameUniforms::create() {
+	gl.genBuffers(1, &buffer);
+	gl.bindBuffer(GlEnum::UNIFORM_BUFFER, buffer);
+	gl.bufferData(GlEnum::UNIFORM_BUFFER, sizeof(FrameParams), nullptr, GlEnum::DYNAMIC_DRAW);
+	gl.bindBuffer(GlEnum::UNIFORM_BUFFER, 0);
+	valid = false;
+	return buffer != 0;
+}
+
+void FrameUniforms::update(const FrameParams& params) {
+	if (!valid || std::memcmp(&params, &uploaded, sizeof(FrameParams)) != 0) {
+		gl.bindBuffer(GlEnum::UNIFORM_BUFFER, buffer);
+		gl.bufferSubData(GlEnum::UNIFORM_BUFFER, 0, sizeof(FrameParams), &params);
+		gl.bindBuffer(GlEnum::UNIFORM_BUFFER, 0);
+		uploaded = params;
+		valid = true;
+	}
+	// Binding points are context state, so rebinding is cheaper than tracking which context
+	// the last draw went to.
+	gl.bindBufferBase(GlEnum::UNIFORM_BUFFER, BINDING, buffer);
+}
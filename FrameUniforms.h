@@ -0,0 +1,38 @@
+#pragma once
+
+#include "GlFunctions.h"
+
+// std140 mirror of the FrameParams block declared in formula.glsl and colorize.frag.
+// Field order and padding must match the GLSL block.
+struct FrameParams {
+	float viewport[4] = {};		// xMin, xMax, yMin, yMax
+	float viewportLow[4] = {};	// what float rounding cut off viewport, for double variants
+	float juliaC[2] = {};
+	float resolution[2] = {};
+	int maxIterations = 0;
+	float paletteOffset = 0.0f;
+	int cdfBins = 0;
+	int iterationBudget = 0;	// per pixel and slice in time-sliced rendering
+	float fieldScale[2] = { 1.0f, 1.0f };	// field pixels per screen pixel
+	float sampleOffset[2] = {};	// of the iterated points from the pixel centres, in pixels
+	float sampleWeight = 1.0f;	// alpha of the colour pass
+	float padding[3] = {};	// std140 rounds the block up to a multiple of 16 bytes
+};
+
+// Per-frame shader parameters in one uniform buffer shared by every pass. The buffer is
+// only written when the parameters differ from the last upload, so a steady frame makes
+// no uniform calls at all and never looks a uniform up by name.
+class FrameUniforms {
+private:
+	FrameParams uploaded;
+	GLuint buffer = 0;
+	bool valid = false;		// `uploaded` matches the buffer contents
+
+public:
+	static constexpr GLuint BINDING = 0;
+
+	bool create();
+
+	// Uploads params if they changed and binds the buffer for the next draws.
+	void update(const FrameParams& params);
+};
@@ -0,0 +1,81 @@
+#include "GlFunctions.h"
+#include <SFML/Window/Context.hpp>
+#include <iostream>
+
+GlFunctions gl;
+
+namespace {
+	template<class F>
+	bool loadFunction(F& function, const char* name) {
+		function = reinterpret_cast<F>(sf::Context::getFunction(name));
+		if (!function) {
+			std::cerr << "Missing OpenGL function " << name << std::endl;
+		}
+		return function != nullptr;
+	}
+}
+
+bool GlFunctions::load() {
+	bool ok = true;
+	ok &= loadFunction(genBuffers, "glGenBuffers");
+	ok &= loadFunction(deleteBuffers, "glDeleteBuffers");
+	ok &= loadFunction(bindBuffer, "glBindBuffer");
+	ok &= loadFunction(bindBufferBase, "glBindBufferBase");
+	ok &= loadFunction(bufferData, "glBufferData");
+	ok &= loadFunction(bufferSubData, "glBufferSubData");
+	ok &= loadFunction(getBufferSubData, "glGetBufferSubData");
+	ok &= loadFunction(getUniformBlockIndex, "glGetUniformBlockIndex");
+	ok &= loadFunction(uniformBlockBinding, "glUniformBlockBinding");
+	ok &= loadFunction(activeTexture, "glActiveTexture");
+
+	ok &= loadFunction(createShader, "glCreateShader");
+	ok &= loadFunction(shaderSource, "glShaderSource");
+	ok &= loadFunction(compileShader, "glCompileShader");
+	ok &= loadFunction(getShaderiv, "glGetShaderiv");
+	ok &= loadFunction(getShaderInfoLog, "glGetShaderInfoLog");
+	ok &= loadFunction(deleteShader, "glDeleteShader");
+	ok &= loadFunction(createProgram, "glCreateProgram");
+	ok &= loadFunction(attachShader, "glAttachShader");
+	ok &= loadFunction(detachShader, "glDetachShader");
+	ok &= loadFunction(linkProgram, "glLinkProgram");
+	ok &= loadFunction(getProgramiv, "glGetProgramiv");
+	ok &= loadFunction(getProgramInfoLog, "glGetProgramInfoLog");
+	ok &= loadFunction(deleteProgram, "glDeleteProgram");
+	ok &= loadFunction(useProgram, "glUseProgram");
+	ok &= loadFunction(getUniformLocation, "glGetUniformLocation");
+	ok &= loadFunction(uniform1i, "glUniform1i");
+
+	ok &= loadFunction(genFramebuffers, "glGenFramebuffers");
+	ok &= loadFunction(deleteFramebuffers, "glDeleteFramebuffers");
+	ok &= loadFunction(bindFramebuffer, "glBindFramebuffer");
+	ok &= loadFunction(framebufferTexture2D, "glFramebufferTexture2D");
+	ok &= loadFunction(checkFramebufferStatus, "glCheckFramebufferStatus");
+	ok &= loadFunction(drawBuffers, "glDrawBuffers");
+	ok &= loadFunction(blitFramebuffer, "glBlitFramebuffer");
+
+	ok &= loadFunction(genQueries, "glGenQueries");
+	ok &= loadFunction(deleteQueries, "glDeleteQueries");
+	ok &= loadFunction(beginQuery, "glBeginQuery");
+	ok &= loadFunction(endQuery, "glEndQuery");
+	ok &= loadFunction(getQueryObjectui64v, "glGetQueryObjectui64v");
+
+	// Optional, so these are looked up without reporting
+	getProgramBinary = reinterpret_cast<decltype(getProgramBinary)>(sf::Context::getFunction("glGetProgramBinary"));
+	programBinary = reinterpret_cast<decltype(programBinary)>(sf::Context::getFunction("glProgramBinary"));
+	programParameteri = reinterpret_cast<decltype(programParameteri)>(sf::Context::getFunction("glProgramParameteri"));
+	dispatchCompute = reinterpret_cast<decltype(dispatchCompute)>(sf::Context::getFunction("glDispatchCompute"));
+	memoryBarrier = reinterpret_cast<decltype(memoryBarrier)>(sf::Context::getFunction("glMemoryBarrier"));
+	clearBufferData = reinterpret_cast<decltype(clearBufferData)>(sf::Context::getFunction("glClearBufferData"));
+
+	// Drivers hand out entry points beyond the context version, so compute also needs 4.3
+	GLint major = 0;
+	GLint minor = 0;
+	glGetIntegerv(GlEnum::MAJOR_VERSION, &major);
+	glGetIntegerv(GlEnum::MINOR_VERSION, &minor);
+	if (major < 4 || (major == 4 && minor < 3)) {
+		dispatchCompute = nullptr;
+		memoryBarrier = nullptr;
+		clearBufferData = nullptr;
+	}
+	return ok;
+}
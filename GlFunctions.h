@@ -0,0 +1,118 @@
+#pragma once
+
+#include <SFML/OpenGL.hpp>
+#include <cstddef>
+#include <cstdint>
+
+#ifndef APIENTRY
+#define APIENTRY
+#endif
+
+// OpenGL entry points past the 1.1 set that <SFML/OpenGL.hpp> declares on Windows. SFML
+// keeps its own loader private, so the renderer loads what it needs through
+// sf::Context::getFunction.
+namespace GlEnum {
+	constexpr GLenum UNIFORM_BUFFER = 0x8A11;
+	constexpr GLenum DYNAMIC_DRAW = 0x88E8;
+	constexpr GLuint INVALID_INDEX = 0xFFFFFFFFu;
+	constexpr GLenum TEXTURE0 = 0x84C0;
+	constexpr GLenum FRAGMENT_SHADER = 0x8B30;
+	constexpr GLenum COMPILE_STATUS = 0x8B81;
+	constexpr GLenum LINK_STATUS = 0x8B82;
+	constexpr GLenum INFO_LOG_LENGTH = 0x8B84;
+	constexpr GLenum PROGRAM_BINARY_RETRIEVABLE_HINT = 0x8257;
+	constexpr GLenum PROGRAM_BINARY_LENGTH = 0x8741;
+	constexpr GLenum NUM_PROGRAM_BINARY_FORMATS = 0x87FE;
+	constexpr GLenum FRAMEBUFFER = 0x8D40;
+	constexpr GLenum FRAMEBUFFER_COMPLETE = 0x8CD5;
+	constexpr GLenum COLOR_ATTACHMENT0 = 0x8CE0;
+	constexpr GLenum RGBA32F = 0x8814;
+	constexpr GLenum RG32F = 0x8230;
+	constexpr GLenum RG = 0x8227;
+	constexpr GLenum R32F = 0x822E;
+	constexpr GLenum COMPUTE_SHADER = 0x91B9;
+	constexpr GLenum SHADER_STORAGE_BUFFER = 0x90D2;
+	constexpr GLenum PIXEL_UNPACK_BUFFER = 0x88EC;
+	constexpr GLenum DYNAMIC_COPY = 0x88EA;
+	constexpr GLenum DYNAMIC_READ = 0x88E9;
+	constexpr GLenum R32UI = 0x8236;
+	constexpr GLenum RED_INTEGER = 0x8D94;
+	constexpr GLbitfield PIXEL_BUFFER_BARRIER_BIT = 0x00000080;
+	constexpr GLbitfield BUFFER_UPDATE_BARRIER_BIT = 0x00000200;
+	constexpr GLbitfield SHADER_STORAGE_BARRIER_BIT = 0x00002000;
+	constexpr GLenum MAJOR_VERSION = 0x821B;
+	constexpr GLenum MINOR_VERSION = 0x821C;
+	constexpr GLenum TIME_ELAPSED = 0x88BF;
+	constexpr GLenum QUERY_RESULT = 0x8866;
+	constexpr GLenum QUERY_RESULT_AVAILABLE = 0x8867;
+	constexpr GLenum READ_FRAMEBUFFER = 0x8CA8;
+	constexpr GLenum DRAW_FRAMEBUFFER = 0x8CA9;
+}
+
+struct GlFunctions {
+	void(APIENTRY* genBuffers)(GLsizei count, GLuint* buffers);
+	void(APIENTRY* deleteBuffers)(GLsizei count, const GLuint* buffers);
+	void(APIENTRY* bindBuffer)(GLenum target, GLuint buffer);
+	void(APIENTRY* bindBufferBase)(GLenum target, GLuint index, GLuint buffer);
+	void(APIENTRY* bufferData)(GLenum target, std::ptrdiff_t size, const void* data, GLenum usage);
+	void(APIENTRY* bufferSubData)(GLenum target, std::ptrdiff_t offset, std::ptrdiff_t size, const void* data);
+	void(APIENTRY* getBufferSubData)(GLenum target, std::ptrdiff_t offset, std::ptrdiff_t size, void* data);
+	GLuint(APIENTRY* getUniformBlockIndex)(GLuint program, const char* name);
+	void(APIENTRY* uniformBlockBinding)(GLuint program, GLuint blockIndex, GLuint binding);
+	void(APIENTRY* activeTexture)(GLenum unit);
+
+	GLuint(APIENTRY* createShader)(GLenum type);
+	void(APIENTRY* shaderSource)(GLuint shader, GLsizei count, const char* const* strings, const GLint* lengths);
+	void(APIENTRY* compileShader)(GLuint shader);
+	void(APIENTRY* getShaderiv)(GLuint shader, GLenum name, GLint* value);
+	void(APIENTRY* getShaderInfoLog)(GLuint shader, GLsizei size, GLsizei* length, char* log);
+	void(APIENTRY* deleteShader)(GLuint shader);
+	GLuint(APIENTRY* createProgram)();
+	void(APIENTRY* attachShader)(GLuint program, GLuint shader);
+	void(APIENTRY* detachShader)(GLuint program, GLuint shader);
+	void(APIENTRY* linkProgram)(GLuint program);
+	void(APIENTRY* getProgramiv)(GLuint program, GLenum name, GLint* value);
+	void(APIENTRY* getProgramInfoLog)(GLuint program, GLsizei size, GLsizei* length, char* log);
+	void(APIENTRY* deleteProgram)(GLuint program);
+	void(APIENTRY* useProgram)(GLuint program);
+	GLint(APIENTRY* getUniformLocation)(GLuint program, const char* name);
+	void(APIENTRY* uniform1i)(GLint location, GLint value);
+
+	void(APIENTRY* genFramebuffers)(GLsizei count, GLuint* framebuffers);
+	void(APIENTRY* deleteFramebuffers)(GLsizei count, const GLuint* framebuffers);
+	void(APIENTRY* bindFramebuffer)(GLenum target, GLuint framebuffer);
+	void(APIENTRY* framebufferTexture2D)(GLenum target, GLenum attachment, GLenum textureTarget, GLuint texture, GLint level);
+	GLenum(APIENTRY* checkFramebufferStatus)(GLenum target);
+	void(APIENTRY* drawBuffers)(GLsizei count, const GLenum* buffers);
+	void(APIENTRY* blitFramebuffer)(GLint srcX0, GLint srcY0, GLint srcX1, GLint srcY1, GLint dstX0, GLint dstY0, GLint dstX1, GLint dstY1,
+		GLbitfield mask, GLenum filter);
+
+	void(APIENTRY* genQueries)(GLsizei count, GLuint* queries);
+	void(APIENTRY* deleteQueries)(GLsizei count, const GLuint* queries);
+	void(APIENTRY* beginQuery)(GLenum target, GLuint query);
+	void(APIENTRY* endQuery)(GLenum target);
+	void(APIENTRY* getQueryObjectui64v)(GLuint query, GLenum name, std::uint64_t* value);
+
+	// GL 4.1 / ARB_get_program_binary. Optional: null when the driver lacks them.
+	void(APIENTRY* getProgramBinary)(GLuint program, GLsizei size, GLsizei* length, GLenum* format, void* binary);
+	void(APIENTRY* programBinary)(GLuint program, GLenum format, const void* binary, GLsizei length);
+	void(APIENTRY* programParameteri)(GLuint program, GLenum name, GLint value);
+
+	// GL 4.3 compute shaders. Optional as well.
+	void(APIENTRY* dispatchCompute)(GLuint groupsX, GLuint groupsY, GLuint groupsZ);
+	void(APIENTRY* memoryBarrier)(GLbitfield barriers);
+	void(APIENTRY* clearBufferData)(GLenum target, GLenum internalFormat, GLenum format, GLenum type, const void* data);
+
+	// Needs a current context. Returns false if any required entry point is missing.
+	bool load();
+
+	bool hasProgramBinary() const {
+		return getProgramBinary && programBinary && programParameteri;
+	}
+
+	bool hasCompute() const {
+		return dispatchCompute && memoryBarrier && clearBufferData;
+	}
+};
+
+extern GlFunctions gl;
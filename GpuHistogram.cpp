@@ -0,0 +1,34 @@
+#include "GpuHistogram.h"
+#include <algorithm>
+
+void GpuHistogram::reset(int maxIterations) {
+	bins = std::max(maxIterations, 1) + 2;
+	const std::ptrdiff_t size = static_cast<std::ptrdiff_t>(bins) * sizeof(std::uint32_t);
+	if (!buffer) {
+		gl.genBuffers(1, &buffer);
+	}
+	gl.bindBuffer(GlEnum::SHADER_STORAGE_BUFFER, buffer);
+	// Grows only, so changing the iteration limit back and forth allocates nothing
+	if (size > capacity) {
+		gl.bufferData(GlEnum::SHADER_STORAGE_BUFFER, size, nullptr, GlEnum::DYNAMIC_READ);
+		capacity = size;
+	}
+	gl.clearBufferData(GlEnum::SHADER_STORAGE_BUFFER, GlEnum::R32UI, GlEnum::RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+	gl.bindBuffer(GlEnum::SHADER_STORAGE_BUFFER, 0);
+	gl.bindBufferBase(GlEnum::SHADER_STORAGE_BUFFER, BINDING, buffer);
+}
+
+void GpuHistogram::countField(GLuint program, int width, int height) {
+	// Must match the workgroup size of histogram.comp
+	constexpr int GROUP_SIZE = 16;
+	gl.useProgram(program);
+	gl.dispatchCompute(static_cast<GLuint>((width + GROUP_SIZE - 1) / GROUP_SIZE), static_cast<GLuint>((height + GROUP_SIZE - 1) / GROUP_SIZE), 1);
+	gl.useProgram(0);
+}
+
+void GpuHistogram::read(std::uint32_t* counts) const {
+	gl.memoryBarrier(GlEnum::BUFFER_UPDATE_BARRIER_BIT);
+	gl.bindBuffer(GlEnum::SHADER_STORAGE_BUFFER, buffer);
+	gl.getBufferSubData(GlEnum::SHADER_STORAGE_BUFFER, 0, static_cast<std::ptrdiff_t>(bins) * sizeof(std::uint32_t), counts);
+	gl.bindBuffer(GlEnum::SHADER_STORAGE_BUFFER, 0);
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "GlFunctions.h"
+#include <cstdint>
+
+// IterationHistogram's bins for a field on the GPU, counted there by histogram.glsl, so
+// histogram colouring reads back maxIterations + 2 counts instead of the whole field.
+// mandelbrot.comp counts while it iterates; other fields are counted afterwards by
+// histogram.comp. Needs the GL 4.3 functions, like ComputeEngine.
+class GpuHistogram {
+private:
+	GLuint buffer = 0;
+	std::ptrdiff_t capacity = 0;	// bytes allocated for buffer
+	int bins = 0;
+
+public:
+	// Must match histogram.glsl
+	static constexpr GLuint BINDING = 3;
+
+	// Zeroes the bins for maxIterations and binds them to BINDING for the next pass that counts.
+	void reset(int maxIterations);
+
+	// Counts a width x height field with program, a compiled histogram.comp whose field
+	// texture is bound already. The FrameParams buffer has to be bound as well.
+	void countField(GLuint program, int width, int height);
+
+	int getBinCount() const { return bins; }
+
+	// Copies the getBinCount() counts to counts.
+	void read(std::uint32_t* counts) const;
+};
@@ -0,0 +1,37 @@
+#include "GpuTimer.h"
+#include <cstdint>
+
+void GpuTimer::begin(double tag) {
+	if (!queries[0]) {
+		gl.genQueries(RING, queries);
+	}
+	if (pending == RING) {
+		--pending;
+	}
+	tags[next] = tag;
+	gl.beginQuery(GlEnum::TIME_ELAPSED, queries[next]);
+}
+
+void GpuTimer::end() {
+	gl.endQuery(GlEnum::TIME_ELAPSED);
+	next = (next + 1) % RING;
+	++pending;
+}
+
+bool GpuTimer::poll(double& seconds, double& tag) {
+	if (pending == 0) {
+		return false;
+	}
+	const int oldest = (next - pending + RING) % RING;
+	std::uint64_t available = 0;
+	gl.getQueryObjectui64v(queries[oldest], GlEnum::QUERY_RESULT_AVAILABLE, &available);
+	if (!available) {
+		return false;
+	}
+	std::uint64_t nanoseconds = 0;
+	gl.getQueryObjectui64v(queries[oldest], GlEnum::QUERY_RESULT, &nanoseconds);
+	seconds = nanoseconds * 1e-9;
+	tag = tags[oldest];
+	--pending;
+	return true;
+}
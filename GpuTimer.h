@@ -0,0 +1,27 @@
+#pragma once
+
+#include "GlFunctions.h"
+
+// A ring of TIME_ELAPSED queries whose results are read frames later, once the GPU has them,
+// so timing a pass never stalls the CPU until the pass is done. Every query carries a tag from
+// the frame it timed, such as that frame's resolution scale, which comes back with its time.
+// Query objects belong to the context they were made in, so one context has to be active
+// around every call.
+class GpuTimer {
+private:
+	static constexpr int RING = 4;
+
+	GLuint queries[RING] = {};
+	double tags[RING] = {};
+	int next = 0;	// the query the next begin uses
+	int pending = 0;	// ended and not read yet, the oldest at next - pending
+
+public:
+	// Starts timing the passes up to end. With every query still in flight the oldest result
+	// is given up.
+	void begin(double tag);
+	void end();
+
+	// Takes the oldest result, in seconds, and its tag. False while it is still on its way.
+	bool poll(double& seconds, double& tag);
+};
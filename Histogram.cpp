@@ -0,0 +1,74 @@
+#include "Histogram.h"
+#include "ThreadPool.h"
+#include <algorithm>
+
+namespace {
+	// Values build() counts per pool index
+	constexpr int BUILD_CHUNK = 16384;
+}
+
+void IterationHistogram::reset(int maxIterations, int threads) {
+	bins = std::max(maxIterations, 1) + 2;
+	threadCounts.resize(threads > 0 ? threads : ThreadPool::shared().getWorkerCount());
+	for (std::vector<std::uint32_t>& local : threadCounts) {
+		local.assign(bins, 0);
+	}
+}
+
+void IterationHistogram::finish() {
+	const int binCount = bins;
+	const int threads = static_cast<int>(threadCounts.size());
+	counts.resize(binCount);
+	cdf.resize(static_cast<size_t>(binCount) + 1);
+
+	// Blocked prefix sum: every block merges and sums its own bins, the block totals are
+	// scanned serially, then every block writes its part of the CDF with its offset.
+	ThreadPool& pool = ThreadPool::shared();
+	const int blocks = std::min(pool.getWorkerCount(), binCount);
+	std::vector<std::uint64_t> blockOffsets(static_cast<size_t>(blocks) + 1, 0);
+	const auto blockBegin = [&](int block) { return static_cast<int>(static_cast<long long>(binCount) * block / blocks); };
+
+	pool.parallelFor(blocks, [&](int block, int) {
+		std::uint64_t blockSum = 0;
+		for (int b = blockBegin(block), end = blockBegin(block + 1); b < end; ++b) {
+			std::uint64_t sum = 0;
+			for (int t = 0; t < threads; ++t) {
+				sum += threadCounts[t][b];
+			}
+			counts[b] = sum;
+			blockSum += sum;
+		}
+		blockOffsets[block + 1] = blockSum;
+	});
+
+	for (int block = 0; block < blocks; ++block) {
+		blockOffsets[block + 1] += blockOffsets[block];
+	}
+
+	const std::uint64_t total = blockOffsets[blocks];
+	const double scale = total > 0 ? 1.0 / static_cast<double>(total) : 0.0;
+	pool.parallelFor(blocks, [&](int block, int) {
+		std::uint64_t running = blockOffsets[block];
+		for (int b = blockBegin(block), end = blockBegin(block + 1); b < end; ++b) {
+			cdf[b] = static_cast<float>(static_cast<double>(running) * scale);
+			running += counts[b];
+		}
+	});
+	cdf[binCount] = 1.0f;
+}
+
+void IterationHistogram::build(const float* values, int count, int maxIterations) {
+	reset(maxIterations);
+	ThreadPool::shared().parallelFor((count + BUILD_CHUNK - 1) / BUILD_CHUNK, [&](int chunk, int worker) {
+		for (int i = chunk * BUILD_CHUNK, end = std::min(i + BUILD_CHUNK, count); i < end; ++i) {
+			add(worker, values[i]);
+		}
+	});
+	finish();
+}
+
+void IterationHistogram::setCounts(const std::uint32_t* binCounts, int maxIterations) {
+	reset(maxIterations, 1);
+	std::copy(binCounts, binCounts + bins, threadCounts[0].begin());
+	finish();
+}
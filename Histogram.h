@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Histogram of escape values over a frame, turned into a cumulative distribution used for
+// histogram-equalized colouring. Each thread counts into its own bins, so accumulating
+// costs one increment per pixel and needs no atomics; finish() merges the bins and runs a
+// parallel prefix sum to produce the CDF.
+class IterationHistogram {
+private:
+	int bins = 0;
+	std::vector<std::vector<std::uint32_t>> threadCounts;
+	std::vector<std::uint64_t> counts;
+	std::vector<float> cdf;
+
+public:
+	// Clears the counts for values in [0, maxIterations + 1]. threads is how many thread
+	// indices add() will see; 0 means one per worker of the shared ThreadPool.
+	void reset(int maxIterations, int threads = 0);
+
+	// Counts one escape value; negative (interior) values are ignored.
+	void add(int thread, float value) {
+		if (value >= 0.0f) {
+			int bin = static_cast<int>(value);
+			++threadCounts[thread][bin < bins ? bin : bins - 1];
+		}
+	}
+
+	// Merges the per-thread counts and rebuilds the CDF.
+	void finish();
+
+	// reset, add and finish in one go, for a field that was computed elsewhere.
+	void build(const float* values, int count, int maxIterations);
+
+	// reset and finish around bins counted elsewhere, maxIterations + 2 of them.
+	void setCounts(const std::uint32_t* binCounts, int maxIterations);
+
+	// cdf[n] is the fraction of escaped pixels with a value below n; there are
+	// getBinCount() + 1 entries.
+	const std::vector<float>& getCdf() const { return cdf; }
+	int getBinCount() const { return bins; }
+};
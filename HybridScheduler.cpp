@@ -0,0 +1,42 @@
+#include "HybridScheduler.h"
+#include <algorithm>
+#include <cmath>
+
+void HybridScheduler::measure(double& rate, int tiles, double seconds) {
+	if (tiles <= 0 || seconds <= 0.0) {
+		return;
+	}
+	const double measured = tiles / seconds;
+	rate = rate > 0.0 ? rate + SMOOTHING * (measured - rate) : measured;
+}
+
+void HybridScheduler::schedule(double centerX, double centerY, double xRange, double yRange, int maxIterations, Precision gpuLimit,
+	int width, int height, int tileSize) {
+	plan.plan(centerX, centerY, xRange, yRange, maxIterations, width, height, tileSize);
+	const int tiles = plan.getTilesX() * plan.getTilesY();
+	cpuTiles.assign(tiles, 1);
+	forcedCount = 0;
+	for (int tile = 0; tile < tiles; ++tile) {
+		forcedCount += plan.getTile(tile) > gpuLimit ? 1 : 0;
+	}
+
+	// Until both sides have been measured they split evenly
+	const double share = gpuRate > 0.0 && cpuRate > 0.0 ? gpuRate / (gpuRate + cpuRate) : 0.5;
+	const int eligible = tiles - forcedCount;
+	const int target = static_cast<int>(std::lround(std::clamp(share, MIN_SHARE, 1.0 - MIN_SHARE) * tiles));
+	gpuCount = std::min(target, eligible);
+
+	// Every eligible tile adds gpuCount and takes eligible off when it goes to the GPU,
+	// which spaces the GPU tiles evenly
+	int accumulated = 0;
+	for (int tile = 0; tile < tiles && gpuCount > 0; ++tile) {
+		if (plan.getTile(tile) > gpuLimit) {
+			continue;
+		}
+		accumulated += gpuCount;
+		if (accumulated >= eligible) {
+			accumulated -= eligible;
+			cpuTiles[tile] = 0;
+		}
+	}
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "PrecisionPlanner.h"
+#include <cstdint>
+#include <vector>
+
+// Splits the tiles of a frame between the GPU fragment pass and the CPU engine so that both
+// finish at about the same time. Each side's share follows the tiles per second it managed
+// on the frames before, smoothed so a single odd frame does not swing the split. Tiles that
+// need more precision than the GPU variant has always go to the CPU, and count towards its
+// share.
+//
+// The GPU tiles are spread evenly over the frame rather than taken as one block, so both
+// sides see the same mix of cheap and expensive tiles and their rates stay comparable.
+// Each side keeps at least MIN_SHARE of the frame, the GPU as far as it has tiles it can
+// take, so neither rate goes stale.
+class HybridScheduler {
+private:
+	PrecisionPlanner plan;
+	std::vector<std::uint8_t> cpuTiles;	// 1 where the CPU renders the tile
+	double gpuRate = 0.0;	// tiles per second; 0 until measured
+	double cpuRate = 0.0;
+	int gpuCount = 0;
+	int forcedCount = 0;
+
+	static void measure(double& rate, int tiles, double seconds);
+
+public:
+	// Weight of the newest measurement in the running rates
+	static constexpr double SMOOTHING = 0.25;
+	static constexpr double MIN_SHARE = 0.05;
+
+	// Assigns every tile of a width x height frame over the view of xRange x yRange around
+	// (centerX, centerY), row 0 at the top. gpuLimit is the most precision the GPU pass has.
+	void schedule(double centerX, double centerY, double xRange, double yRange, int maxIterations, Precision gpuLimit,
+		int width, int height, int tileSize);
+
+	// How long the last frame's tiles took on each side
+	void measureGpu(int tiles, double seconds) { measure(gpuRate, tiles, seconds); }
+	void measureCpu(int tiles, double seconds) { measure(cpuRate, tiles, seconds); }
+
+	// One flag per tile in row-major order, for CpuRenderer::setTileMask
+	const std::vector<std::uint8_t>& getCpuTiles() const { return cpuTiles; }
+	bool isGpuTile(int tile) const { return !cpuTiles[tile]; }
+	int getTilesX() const { return plan.getTilesX(); }
+	int getTilesY() const { return plan.getTilesY(); }
+	int getTileSize() const { return plan.getTileSize(); }
+	int getGpuTileCount() const { return gpuCount; }
+	int getCpuTileCount() const { return static_cast<int>(cpuTiles.size()) - gpuCount; }
+	// CPU tiles the GPU could not have resolved
+	int getForcedTileCount() const { return forcedCount; }
+	double getGpuRate() const { return gpuRate; }
+	double getCpuRate() const { return cpuRate; }
+};
@@ -0,0 +1,66 @@
+#include "IterationEstimator.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+	// Width of the view the renderer starts at
+	constexpr double HOME_WIDTH = 2.47;
+
+	// The probe's limit is this many times the depth estimate, within these bounds
+	constexpr int PROBE_FACTOR = 2;
+	constexpr int PROBE_MIN_ITERATIONS = 1000;
+	constexpr int PROBE_MAX_ITERATIONS = 20000;
+}
+
+void IterationEstimator::resize(int viewWidth, int viewHeight) {
+	const int probeHeight = std::max(1, PROBE_WIDTH * viewHeight / std::max(viewWidth, 1));
+	probe.resize(PROBE_WIDTH, probeHeight);
+}
+
+int IterationEstimator::estimate(double centerX, double centerY, double xRange, double yRange, Formula formula, const KernelParams& params,
+	const FormulaProgram* customFormula) {
+	// Grows with the number of decades zoomed in, a little faster than linearly
+	const double decades = std::max(0.0, std::log10(HOME_WIDTH / xRange));
+	depthEstimate = static_cast<int>(200.0 * std::pow(1.0 + decades, 1.5));
+
+	runProbe(centerX, centerY, xRange, yRange, formula, params, customFormula);
+	return std::clamp(std::max(depthEstimate, probeEstimate), MIN_ITERATIONS, MAX_ITERATIONS);
+}
+
+// Aims 50% past the 99th percentile of the escape values, so the slow fringe the probe is
+// too coarse to see still resolves. When escapes are still piling up near the probe's own
+// limit the distribution is cut off, and the limit itself is the best guess there is.
+void IterationEstimator::runProbe(double centerX, double centerY, double xRange, double yRange, Formula formula, const KernelParams& params,
+	const FormulaProgram* customFormula) {
+	if (probe.getWidth() == 0) {
+		resize(PROBE_WIDTH, PROBE_WIDTH);
+	}
+	KernelParams probeParams = params;
+	probeIterations = std::clamp(depthEstimate * PROBE_FACTOR, PROBE_MIN_ITERATIONS, PROBE_MAX_ITERATIONS);
+	probeParams.maxIterations = probeIterations;
+	probe.render(centerX, centerY, xRange, yRange, formula, probeParams, customFormula);
+
+	escaped.clear();
+	for (float value : probe.getIterations()) {
+		if (value >= 0.0f) {
+			escaped.push_back(value);
+		}
+	}
+	if (escaped.empty()) {
+		probeEstimate = 0;
+		lateFraction = 0.0f;
+		return;
+	}
+
+	const float lateStart = probeIterations * 0.75f;
+	const size_t late = std::count_if(escaped.begin(), escaped.end(), [lateStart](float value) { return value > lateStart; });
+	lateFraction = static_cast<float>(late) / escaped.size();
+	if (lateFraction >= 0.005f) {
+		probeEstimate = probeIterations;
+		return;
+	}
+
+	const size_t percentile = (escaped.size() - 1) * 99 / 100;
+	std::nth_element(escaped.begin(), escaped.begin() + percentile, escaped.end());
+	probeEstimate = static_cast<int>(escaped[percentile] * 1.5f);
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "CpuRenderer.h"
+#include "FormulaCompiler.h"
+#include "Kernels.h"
+#include <vector>
+
+// Picks maxIterations for a view. Two guesses are combined: one from the zoom depth alone,
+// since detail deeper in needs more iterations to resolve, and one from a small CPU probe
+// render of the view, which shows how far out the escape values actually reach. The probe
+// is cheap because it is tiny; at PROBE_WIDTH pixels across it costs about as much as a
+// few rows of the real frame.
+class IterationEstimator {
+private:
+	CpuRenderer probe;
+	std::vector<float> escaped;
+	int depthEstimate = 0;
+	int probeEstimate = 0;
+	int probeIterations = 0;
+	float lateFraction = 0.0f;	// escaped probe pixels in the last quarter of the probe's limit
+
+	void runProbe(double centerX, double centerY, double xRange, double yRange, Formula formula, const KernelParams& params,
+		const FormulaProgram* customFormula);
+
+public:
+	static constexpr int PROBE_WIDTH = 96;
+	static constexpr int MIN_ITERATIONS = 100;
+	static constexpr int MAX_ITERATIONS = 100000;
+
+	// The probe keeps the view's aspect ratio.
+	void resize(int viewWidth, int viewHeight);
+
+	// For the view of xRange x yRange around (centerX, centerY). params.maxIterations is
+	// ignored. customFormula is used when formula is Formula::Custom.
+	int estimate(double centerX, double centerY, double xRange, double yRange, Formula formula, const KernelParams& params,
+		const FormulaProgram* customFormula = nullptr);
+
+	int getDepthEstimate() const { return depthEstimate; }
+	int getProbeEstimate() const { return probeEstimate; }
+	float getLateFraction() const { return lateFraction; }
+};
@@ -0,0 +1,113 @@
+#include "IterationState.h"
+#include <iostream>
+
+namespace {
+	GLuint createTexture(GLint internalFormat, GLenum format, int width, int height) {
+		GLuint texture = 0;
+		glGenTextures(1, &texture);
+		glBindTexture(GL_TEXTURE_2D, texture);
+		glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, GL_FLOAT, nullptr);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		return texture;
+	}
+}
+
+// Textures are bound on STATE_UNIT throughout: SFML caches what is bound on unit 0.
+bool IterationState::create(int newWidth, int newHeight) {
+	width = newWidth;
+	height = newHeight;
+	current = 0;
+
+	bool complete = true;
+	gl.activeTexture(GlEnum::TEXTURE0 + STATE_UNIT);
+	for (Buffer& buffer : buffers) {
+		if (buffer.framebuffer) {
+			gl.deleteFramebuffers(1, &buffer.framebuffer);
+			glDeleteTextures(1, &buffer.state);
+			glDeleteTextures(1, &buffer.stateLow);
+		}
+		buffer.state = createTexture(GlEnum::RGBA32F, GL_RGBA, width, height);
+		buffer.stateLow = createTexture(GlEnum::RG32F, GlEnum::RG, width, height);
+
+		gl.genFramebuffers(1, &buffer.framebuffer);
+		gl.bindFramebuffer(GlEnum::FRAMEBUFFER, buffer.framebuffer);
+		gl.framebufferTexture2D(GlEnum::FRAMEBUFFER, GlEnum::COLOR_ATTACHMENT0, GL_TEXTURE_2D, buffer.state, 0);
+		gl.framebufferTexture2D(GlEnum::FRAMEBUFFER, GlEnum::COLOR_ATTACHMENT0 + 1, GL_TEXTURE_2D, buffer.stateLow, 0);
+		const GLenum attachments[] = { GlEnum::COLOR_ATTACHMENT0, GlEnum::COLOR_ATTACHMENT0 + 1 };
+		gl.drawBuffers(2, attachments);
+		complete &= gl.checkFramebufferStatus(GlEnum::FRAMEBUFFER) == GlEnum::FRAMEBUFFER_COMPLETE;
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+	gl.activeTexture(GlEnum::TEXTURE0);
+	gl.bindFramebuffer(GlEnum::FRAMEBUFFER, 0);
+
+	if (!complete) {
+		std::cerr << "Float render targets are not supported" << std::endl;
+	}
+	return complete;
+}
+
+void IterationState::reset() {
+	// Alpha is the orbit trap minimum, which starts far outside the bailout radius
+	gl.bindFramebuffer(GlEnum::FRAMEBUFFER, buffers[current].framebuffer);
+	glClearColor(0.0f, 0.0f, 0.0f, 1000.0f);
+	glClear(GL_COLOR_BUFFER_BIT);
+	gl.bindFramebuffer(GlEnum::FRAMEBUFFER, 0);
+}
+
+void IterationState::bindInputs(const Buffer& buffer) const {
+	gl.activeTexture(GlEnum::TEXTURE0 + STATE_LOW_UNIT);
+	glBindTexture(GL_TEXTURE_2D, buffer.stateLow);
+	gl.activeTexture(GlEnum::TEXTURE0 + STATE_UNIT);
+	glBindTexture(GL_TEXTURE_2D, buffer.state);
+	gl.activeTexture(GlEnum::TEXTURE0);
+}
+
+// A fullscreen rectangle through the fixed-function vertex stage, as SFML draws, but with
+// identity matrices. Everything changed here is put back, so SFML's state cache stays right.
+void IterationState::step(GLuint program) {
+	const Buffer& source = buffers[current];
+	const Buffer& target = buffers[1 - current];
+
+	GLint viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	gl.bindFramebuffer(GlEnum::FRAMEBUFFER, target.framebuffer);
+	glViewport(0, 0, width, height);
+	glDisable(GL_BLEND);
+	bindInputs(source);
+
+	glMatrixMode(GL_PROJECTION);
+	glPushMatrix();
+	glLoadIdentity();
+	glMatrixMode(GL_MODELVIEW);
+	glPushMatrix();
+	glLoadIdentity();
+
+	gl.useProgram(program);
+	glRectf(-1.0f, -1.0f, 1.0f, 1.0f);
+	gl.useProgram(0);
+
+	glPopMatrix();
+	glMatrixMode(GL_PROJECTION);
+	glPopMatrix();
+	glMatrixMode(GL_MODELVIEW);
+
+	glEnable(GL_BLEND);
+	gl.bindFramebuffer(GlEnum::FRAMEBUFFER, 0);
+	glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+	current = 1 - current;
+}
+
+void IterationState::bindForColoring() const {
+	gl.activeTexture(GlEnum::TEXTURE0 + STATE_UNIT);
+	glBindTexture(GL_TEXTURE_2D, buffers[current].state);
+	gl.activeTexture(GlEnum::TEXTURE0);
+}
+
+void IterationState::readValues(float* values) const {
+	gl.activeTexture(GlEnum::TEXTURE0 + STATE_UNIT);
+	glBindTexture(GL_TEXTURE_2D, buffers[current].state);
+	glGetTexImage(GL_TEXTURE_2D, 0, GL_RED, GL_FLOAT, values);
+	gl.activeTexture(GlEnum::TEXTURE0);
+}
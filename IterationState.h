@@ -0,0 +1,53 @@
+#pragma once
+
+#include "GlFunctions.h"
+
+// Per-pixel iteration state for time-sliced GPU rendering. Each slice draws the iteration
+// program over the whole target; it reads the previous state and writes the next into the
+// other buffer of a ping-pong pair, advancing every unfinished pixel by at most
+// FrameParams::iterationBudget iterations. Finished pixels are only copied.
+//
+// The state texture is RGBA32F: z.x, z.y, iterations done, and the orbit trap minimum
+// while a pixel runs. Once it finishes, alpha is -1 and red holds the escape value in the
+// same convention as the packed field (-1 for the interior). Double-precision variants
+// write the rounding error of z to a second RG32F texture.
+//
+// The buffers are raw GL objects because SFML has no float render textures, so slices
+// bypass SFML entirely and leave its cached state as they found it.
+class IterationState {
+private:
+	struct Buffer {
+		GLuint framebuffer = 0;
+		GLuint state = 0;
+		GLuint stateLow = 0;
+	};
+
+	Buffer buffers[2];
+	int current = 0;	// index of the buffer holding the latest state
+	int width = 0;
+	int height = 0;
+
+	void bindInputs(const Buffer& buffer) const;
+
+public:
+	// Units the slice program reads the previous state from; the colour pass reads the
+	// current state from STATE_UNIT as well.
+	static constexpr GLint STATE_UNIT = 3;
+	static constexpr GLint STATE_LOW_UNIT = 4;
+
+	bool create(int width, int height);
+
+	// Starts every pixel again from iteration 0.
+	void reset();
+
+	// Runs one slice with program, which must be a TIME_SLICED variant of mandelbrot.frag.
+	// The FrameParams buffer has to be bound already.
+	void step(GLuint program);
+
+	// Binds the latest state to STATE_UNIT for the colour pass.
+	void bindForColoring() const;
+
+	// Copies the red channel, the escape value of every finished pixel, into values
+	// (width * height floats). Unfinished pixels come back as their z.x.
+	void readValues(float* values) const;
+};
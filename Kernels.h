@@ -0,0 +1,422 @@
+#pragma once
+
+#include "DoubleDouble.h"
+#include "Fixed128.h"
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+
+// Escape-time formulas. Every entry maps to its own fully specialized kernel instance, so
+// the choice is made once per render and never inside the iteration loop.
+enum class Formula {
+	Mandelbrot,
+	Multibrot3,
+	Multibrot4,
+	Multibrot5,
+	BurningShip,
+	Tricorn,
+	Julia,
+	Custom,		// user formula, see FormulaCompiler.h
+	Count
+};
+
+inline const char* formulaName(Formula formula) {
+	switch (formula) {
+	case Formula::Mandelbrot: return "Mandelbrot";
+	case Formula::Multibrot3: return "Multibrot z^3";
+	case Formula::Multibrot4: return "Multibrot z^4";
+	case Formula::Multibrot5: return "Multibrot z^5";
+	case Formula::BurningShip: return "Burning Ship";
+	case Formula::Tricorn: return "Tricorn";
+	case Formula::Julia: return "Julia";
+	case Formula::Custom: return "Custom";
+	default: return "Unknown";
+	}
+}
+
+// How z is folded before it is raised to the power.
+enum class Variant {
+	Standard,		// z
+	BurningShip,	// |Re z| + i|Im z|
+	Tricorn			// conj(z)
+};
+
+// z^Power by repeated complex multiplication, expanded at compile time. No pow() call
+// and no loop left in the generated code.
+template<int Power, class T>
+inline void complexPower(T& x, T& y) {
+	static_assert(Power >= 2, "complexPower needs an exponent of at least 2");
+	if constexpr (Power == 2) {
+		// xy + xy rounds exactly like 2xy, and spares Fixed128 a multiplication
+		T xx = x * x;
+		T yy = y * y;
+		T xy = x * y;
+		y = xy + xy;
+		x = xx - yy;
+	}
+	else if constexpr (Power % 2 == 0) {
+		complexPower<2>(x, y);
+		complexPower<Power / 2>(x, y);
+	}
+	else {
+		T bx = x;
+		T by = y;
+		complexPower<Power - 1>(x, y);
+		T rx = x * bx - y * by;
+		y = x * by + y * bx;
+		x = rx;
+	}
+}
+
+template<int Power, Variant V, bool IsJulia>
+struct FormulaKernel {
+	static constexpr int power = Power;
+	static constexpr Variant variant = V;
+	static constexpr bool julia = IsJulia;
+
+	// One iteration z -> f(z) + c.
+	template<class T>
+	static inline void step(T& x, T& y, T cx, T cy) {
+		if constexpr (V == Variant::BurningShip) {
+			using std::abs;
+			x = abs(x);
+			y = abs(y);
+		}
+		else if constexpr (V == Variant::Tricorn) {
+			y = -y;
+		}
+		complexPower<Power>(x, y);
+		x += cx;
+		y += cy;
+	}
+};
+
+using MandelbrotKernel = FormulaKernel<2, Variant::Standard, false>;
+using Multibrot3Kernel = FormulaKernel<3, Variant::Standard, false>;
+using Multibrot4Kernel = FormulaKernel<4, Variant::Standard, false>;
+using Multibrot5Kernel = FormulaKernel<5, Variant::Standard, false>;
+using BurningShipKernel = FormulaKernel<2, Variant::BurningShip, false>;
+using TricornKernel = FormulaKernel<2, Variant::Tricorn, false>;
+using JuliaKernel = FormulaKernel<2, Variant::Standard, true>;
+
+struct KernelParams {
+	int maxIterations = 500;
+	double juliaX = -0.8;
+	double juliaY = 0.156;
+	bool checkpointed = true;	// test the bailout once per CHECKPOINT_ITERATIONS, see checkpointBatch
+};
+
+// Iterations a checkpointed batch runs between bailout tests.
+constexpr int CHECKPOINT_ITERATIONS = 8;
+
+// Number of pixels iterated in lock-step by iterateBatch. Eight doubles fill an AVX-512
+// register or two AVX2 registers.
+constexpr int KERNEL_LANES = 8;
+
+// Lanes of a batch in T: as many as fit the registers KERNEL_LANES doubles take, so float
+// batches iterate twice the pixels per instruction. Fixed128 and DoubleDouble get half as
+// many; their lanes only serve to keep independent multiplies in flight.
+template<class T>
+constexpr int kernelLanes = static_cast<int>(KERNEL_LANES * sizeof(double) / sizeof(T));
+
+// Smooth iteration count for a point that escaped after `steps` iterations with |z|^2 =
+// magnitude. Matches the continuous colouring the shader uses.
+template<int Power>
+inline float smoothIterations(int steps, double magnitude) {
+	return static_cast<float>(steps + 1 - std::log(std::log(std::sqrt(magnitude))) / std::log(static_cast<double>(Power)));
+}
+
+// Iterates Lanes pixels side by side, from iteration firstStep up to params.maxIterations.
+// All lanes execute the same instructions every iteration and escaped lanes are frozen
+// with selects rather than branches, so the inner loop vectorizes; the batch only exits
+// once every lane has escaped. px and py are the pixels' points in the plane. zx and zy
+// hold z on entry, and on exit where the orbits that never escaped stopped, so a higher
+// limit can carry on from there. Writes the smooth iteration count, or -1 for pixels that
+// never escaped, and the iterations each pixel took to escape (-1 likewise).
+template<class Kernel, class T, int Lanes = kernelLanes<T>>
+inline void continueBatch(const T* px, const T* py, T* zx, T* zy, int firstStep, float* out, int* steps, const KernelParams& params);
+
+// continueBatch without the per-iteration bookkeeping: every lane runs CHECKPOINT_ITERATIONS
+// steps unconditionally, counting failed bailout tests in a T so the block vectorizes, and
+// the batch looks at the result once at the end. A lane that went out somewhere in the
+// block starts again from the z saved before it and steps one at a time to find the exact
+// iteration, then parks at z = c = 0 for the rest of the batch. Only the final,
+// shorter-than-a-block stretch is iterated step by step.
+//
+// Past the bailout z keeps growing and may overflow to infinity or NaN inside a block, which
+// the test counts as out. Fixed128 would wrap around instead, so it always takes the plain
+// loop, and so does DoubleDouble: its lanes do not vectorize, and the blocks only cost it.
+template<class Kernel, class T, int Lanes = kernelLanes<T>>
+inline void checkpointBatch(const T* px, const T* py, T* zx, T* zy, int firstStep, float* out, int* steps, const KernelParams& params) {
+	T cx[Lanes], cy[Lanes], x[Lanes], y[Lanes], magnitude[Lanes];
+	int escapedAt[Lanes];
+
+	for (int l = 0; l < Lanes; ++l) {
+		if constexpr (Kernel::julia) {
+			cx[l] = static_cast<T>(params.juliaX);
+			cy[l] = static_cast<T>(params.juliaY);
+		}
+		else {
+			cx[l] = px[l];
+			cy[l] = py[l];
+		}
+		x[l] = zx[l];
+		y[l] = zy[l];
+		magnitude[l] = T(0);
+		escapedAt[l] = -1;
+	}
+
+	int i = firstStep;
+	int running = Lanes;
+	for (; running > 0 && i + CHECKPOINT_ITERATIONS <= params.maxIterations; i += CHECKPOINT_ITERATIONS) {
+		T savedX[Lanes], savedY[Lanes], outside[Lanes];
+		for (int l = 0; l < Lanes; ++l) {
+			savedX[l] = x[l];
+			savedY[l] = y[l];
+			outside[l] = T(0);
+		}
+		for (int k = 0; k < CHECKPOINT_ITERATIONS; ++k) {
+			for (int l = 0; l < Lanes; ++l) {
+				Kernel::step(x[l], y[l], cx[l], cy[l]);
+				outside[l] += x[l] * x[l] + y[l] * y[l] <= T(4) ? T(0) : T(1);
+			}
+		}
+
+		for (int l = 0; l < Lanes; ++l) {
+			if (outside[l] == T(0) || escapedAt[l] >= 0) {
+				continue;
+			}
+			T rx = savedX[l];
+			T ry = savedY[l];
+			for (int k = 0; k < CHECKPOINT_ITERATIONS; ++k) {
+				Kernel::step(rx, ry, cx[l], cy[l]);
+				T m = rx * rx + ry * ry;
+				if (m > T(4)) {
+					magnitude[l] = m;
+					escapedAt[l] = i + k;
+					break;
+				}
+			}
+			if (escapedAt[l] < 0) {
+				// The block's last test rounded differently from the step-by-step one
+				x[l] = rx;
+				y[l] = ry;
+				continue;
+			}
+			--running;
+			x[l] = y[l] = cx[l] = cy[l] = T(0);
+		}
+	}
+
+	for (int l = 0; l < Lanes; ++l) {
+		for (int j = i; escapedAt[l] < 0 && j < params.maxIterations; ++j) {
+			Kernel::step(x[l], y[l], cx[l], cy[l]);
+			T m = x[l] * x[l] + y[l] * y[l];
+			if (m > T(4)) {
+				magnitude[l] = m;
+				escapedAt[l] = j;
+			}
+		}
+		if (escapedAt[l] < 0) {
+			zx[l] = x[l];
+			zy[l] = y[l];
+		}
+		out[l] = escapedAt[l] < 0 ? -1.0f : smoothIterations<Kernel::power>(escapedAt[l] + 1, static_cast<double>(magnitude[l]));
+		steps[l] = escapedAt[l] < 0 ? -1 : escapedAt[l] + 1;
+	}
+}
+
+template<class Kernel, class T, int Lanes>
+inline void continueBatch(const T* px, const T* py, T* zx, T* zy, int firstStep, float* out, int* steps, const KernelParams& params) {
+	if constexpr (std::is_floating_point_v<T>) {
+		if (params.checkpointed) {
+			checkpointBatch<Kernel, T, Lanes>(px, py, zx, zy, firstStep, out, steps, params);
+			return;
+		}
+	}
+	T cx[Lanes], cy[Lanes], magnitude[Lanes];
+	int escapedAt[Lanes];
+
+	for (int l = 0; l < Lanes; ++l) {
+		if constexpr (Kernel::julia) {
+			cx[l] = static_cast<T>(params.juliaX);
+			cy[l] = static_cast<T>(params.juliaY);
+		}
+		else {
+			cx[l] = px[l];
+			cy[l] = py[l];
+		}
+		magnitude[l] = T(0);
+		escapedAt[l] = -1;
+	}
+
+	for (int i = firstStep; i < params.maxIterations; ++i) {
+		int running = 0;
+		for (int l = 0; l < Lanes; ++l) {
+			T x = zx[l];
+			T y = zy[l];
+			Kernel::step(x, y, cx[l], cy[l]);
+			T m = x * x + y * y;
+
+			bool active = escapedAt[l] < 0;
+			bool escapes = active && m > T(4);
+			zx[l] = active ? x : zx[l];
+			zy[l] = active ? y : zy[l];
+			magnitude[l] = escapes ? m : magnitude[l];
+			escapedAt[l] = escapes ? i : escapedAt[l];
+			running += (active && !escapes) ? 1 : 0;
+		}
+		if (running == 0) {
+			break;
+		}
+	}
+
+	for (int l = 0; l < Lanes; ++l) {
+		out[l] = escapedAt[l] < 0 ? -1.0f : smoothIterations<Kernel::power>(escapedAt[l] + 1, static_cast<double>(magnitude[l]));
+		steps[l] = escapedAt[l] < 0 ? -1 : escapedAt[l] + 1;
+	}
+}
+
+// continueBatch from the start of the orbit.
+template<class Kernel, class T, int Lanes = kernelLanes<T>>
+inline void iterateBatch(const T* px, const T* py, T* zx, T* zy, float* out, int* steps, const KernelParams& params) {
+	for (int l = 0; l < Lanes; ++l) {
+		zx[l] = Kernel::julia ? px[l] : T(0);
+		zy[l] = Kernel::julia ? py[l] : T(0);
+	}
+	continueBatch<Kernel, T, Lanes>(px, py, zx, zy, 0, out, steps, params);
+}
+
+// Per-pixel results of a span. steps and the final z are what a later, higher iteration
+// limit needs to resume a pixel instead of starting over; z is only meaningful where
+// steps is -1.
+struct SpanOutput {
+	float* values;
+	int* steps;
+	double* zx;
+	double* zy;
+};
+
+// Renders `count` pixels of one row, from x0 in steps of dx, at height y. The points are
+// placed in double and only then rounded to T.
+template<class Kernel, class T>
+void renderSpan(double x0, double dx, double y, int count, const SpanOutput& out, const KernelParams& params) {
+	constexpr int Lanes = kernelLanes<T>;
+	T px[Lanes], py[Lanes], zx[Lanes], zy[Lanes];
+	float values[Lanes];
+	int steps[Lanes];
+
+	for (int start = 0; start < count; start += Lanes) {
+		int lanes = count - start < Lanes ? count - start : Lanes;
+		for (int l = 0; l < Lanes; ++l) {
+			// Tail lanes repeat the last pixel, so they never keep the batch running longer.
+			int index = start + (l < lanes ? l : lanes - 1);
+			px[l] = static_cast<T>(x0 + dx * static_cast<double>(index));
+			py[l] = static_cast<T>(y);
+		}
+		iterateBatch<Kernel, T>(px, py, zx, zy, values, steps, params);
+		for (int l = 0; l < lanes; ++l) {
+			out.values[start + l] = values[l];
+			out.steps[start + l] = steps[l];
+			out.zx[start + l] = static_cast<double>(zx[l]);
+			out.zy[start + l] = static_cast<double>(zy[l]);
+		}
+	}
+}
+
+// renderSpan in a type wider than double, Fixed128 or DoubleDouble, with the points placed
+// in T too: once dx is below the spacing of doubles at x0, x0 + dx * index in double would
+// put whole runs of pixels on the same point. No z is handed back, since a double could not
+// hold it.
+template<class Kernel, class T>
+void renderWideSpan(const T& x0, const T& dx, const T& y, int count, float* values, int* steps, const KernelParams& params) {
+	constexpr int Lanes = kernelLanes<T>;
+	T px[Lanes], py[Lanes], zx[Lanes], zy[Lanes];
+	float laneValues[Lanes];
+	int laneSteps[Lanes];
+
+	for (int start = 0; start < count; start += Lanes) {
+		int lanes = count - start < Lanes ? count - start : Lanes;
+		for (int l = 0; l < Lanes; ++l) {
+			int index = start + (l < lanes ? l : lanes - 1);
+			px[l] = x0 + dx * T(index);
+			py[l] = y;
+		}
+		iterateBatch<Kernel, T>(px, py, zx, zy, laneValues, laneSteps, params);
+		for (int l = 0; l < lanes; ++l) {
+			values[start + l] = laneValues[l];
+			steps[start + l] = laneSteps[l];
+		}
+	}
+}
+
+using SpanKernel = void (*)(double x0, double dx, double y, int count, const SpanOutput& out, const KernelParams& params);
+// Batch kernels take kernelLanes<T> pixels.
+template<class T>
+using BatchKernelOf = void (*)(const T* px, const T* py, T* zx, T* zy, int firstStep, float* out, int* steps, const KernelParams& params);
+using BatchKernel = BatchKernelOf<double>;
+
+// Picks the specialized span kernel for a formula, iterating in T. This is the only place
+// the formula is looked at; the returned function has it baked in.
+template<class T = double>
+inline SpanKernel spanKernelFor(Formula formula) {
+	switch (formula) {
+	case Formula::Multibrot3: return &renderSpan<Multibrot3Kernel, T>;
+	case Formula::Multibrot4: return &renderSpan<Multibrot4Kernel, T>;
+	case Formula::Multibrot5: return &renderSpan<Multibrot5Kernel, T>;
+	case Formula::BurningShip: return &renderSpan<BurningShipKernel, T>;
+	case Formula::Tricorn: return &renderSpan<TricornKernel, T>;
+	case Formula::Julia: return &renderSpan<JuliaKernel, T>;
+	case Formula::Mandelbrot:
+	default: return &renderSpan<MandelbrotKernel, T>;
+	}
+}
+
+// The continueBatch specialization behind spanKernelFor<T>(formula), for resuming orbits.
+template<class T = double>
+inline BatchKernelOf<T> batchKernelFor(Formula formula) {
+	switch (formula) {
+	case Formula::Multibrot3: return &continueBatch<Multibrot3Kernel, T>;
+	case Formula::Multibrot4: return &continueBatch<Multibrot4Kernel, T>;
+	case Formula::Multibrot5: return &continueBatch<Multibrot5Kernel, T>;
+	case Formula::BurningShip: return &continueBatch<BurningShipKernel, T>;
+	case Formula::Tricorn: return &continueBatch<TricornKernel, T>;
+	case Formula::Julia: return &continueBatch<JuliaKernel, T>;
+	case Formula::Mandelbrot:
+	default: return &continueBatch<MandelbrotKernel, T>;
+	}
+}
+
+template<class T>
+using WideSpanKernelOf = void (*)(const T& x0, const T& dx, const T& y, int count, float* values, int* steps, const KernelParams& params);
+
+// spanKernelFor for the types past double
+template<class T>
+inline WideSpanKernelOf<T> wideSpanKernelFor(Formula formula) {
+	switch (formula) {
+	case Formula::Multibrot3: return &renderWideSpan<Multibrot3Kernel, T>;
+	case Formula::Multibrot4: return &renderWideSpan<Multibrot4Kernel, T>;
+	case Formula::Multibrot5: return &renderWideSpan<Multibrot5Kernel, T>;
+	case Formula::BurningShip: return &renderWideSpan<BurningShipKernel, T>;
+	case Formula::Tricorn: return &renderWideSpan<TricornKernel, T>;
+	case Formula::Julia: return &renderWideSpan<JuliaKernel, T>;
+	case Formula::Mandelbrot:
+	default: return &renderWideSpan<MandelbrotKernel, T>;
+	}
+}
+
+// Preprocessor lines that select the matching specialization in mandelbrot.frag.
+inline std::string formulaDefines(Formula formula) {
+	switch (formula) {
+	case Formula::Multibrot3: return "#define FORMULA_POWER 3\n";
+	case Formula::Multibrot4: return "#define FORMULA_POWER 4\n";
+	case Formula::Multibrot5: return "#define FORMULA_POWER 5\n";
+	case Formula::BurningShip: return "#define FORMULA_BURNING_SHIP\n";
+	case Formula::Tricorn: return "#define FORMULA_TRICORN\n";
+	case Formula::Julia: return "#define FORMULA_JULIA\n";
+	case Formula::Custom: return "#define FORMULA_CUSTOM\n";
+	case Formula::Mandelbrot:
+	default: return "";
+	}
+}
@@ -0,0 +1,52 @@
+#include "MirrorPlan.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+bool MirrorPlan::wholeSum(double offset, double spacing, int& sum) {
+	const double exact = 2.0 * offset / spacing;
+	if (!(std::abs(exact) < std::numeric_limits<int>::max() / 2)) {
+		return false;
+	}
+	const double rounded = std::round(exact);
+	sum = static_cast<int>(rounded);
+	return std::abs(exact - rounded) <= TOLERANCE;
+}
+
+// Pixel centres are at yMax - (r + 0.5) * dy, and -y lands on row r' = 2 * yMax / dy - 1 - r;
+// columns likewise from xMin. Copied are the rows past the axis whose image is in the frame,
+// so for an axis below the middle that is the short band beneath it.
+void MirrorPlan::plan(Formula formula, double centerX, double centerY, double xRange, double yRange, int width, int height) {
+	clear();
+	halfTurn = formula == Formula::Julia;
+	if (formula == Formula::BurningShip || formula == Formula::Custom || width <= 0 || height <= 0) {
+		return;
+	}
+
+	const double dx = xRange / width;
+	const double dy = yRange / height;
+	int twiceTop;
+	if (!wholeSum(centerY + 0.5 * yRange, dy, twiceTop)) {
+		return;
+	}
+	rowSum = twiceTop - 1;
+	// Rows r > rowSum / 2 with 0 <= rowSum - r < height
+	row0 = std::max(rowSum / 2 + 1, std::max(rowSum - height + 1, 0));
+	row1 = std::min(height, rowSum + 1);
+	column0 = 0;
+	column1 = width;
+
+	if (halfTurn) {
+		int twiceLeft;
+		if (!wholeSum(-(centerX - 0.5 * xRange), dx, twiceLeft)) {
+			clear();
+			return;
+		}
+		columnSum = twiceLeft - 1;
+		column0 = std::max(columnSum - width + 1, 0);
+		column1 = std::min(width, columnSum + 1);
+	}
+	if (!isActive()) {
+		clear();
+	}
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "Kernels.h"
+
+// The pixels of a frame that come out the same as other pixels of it. Formulas with real
+// coefficients commute with conjugation, so the orbit of conj(c) is the conjugate of the
+// orbit of c and a view straddling the real axis only needs the rows on one side of it. A
+// quadratic Julia set is symmetric under z -> -z instead, a half turn about the origin,
+// after which both orbits are the same from the first iteration on.
+//
+// Pixels sit at the centres of an even grid around the view's centre, so a mirrored pixel
+// lands on another one only when the axis runs through a pixel centre or halfway between
+// two. That holds for the default view and survives zooming about the centre and panning by
+// whole pixels; other views get an empty plan rather than values shifted by a fraction of
+// a pixel.
+//
+// The plan is one rectangle of pixels, rows counted from the top, whose values are copied
+// from their mirror images instead of being iterated. The images are all outside it.
+class MirrorPlan {
+private:
+	int rowSum = 0;	// row r mirrors onto rowSum - r
+	int columnSum = 0;	// column c onto columnSum - c, with a half turn
+	bool halfTurn = false;
+	int row0 = 0, row1 = 0;
+	int column0 = 0, column1 = 0;
+
+	// 2 * offset / spacing as a whole number, if it is one within TOLERANCE
+	static bool wholeSum(double offset, double spacing, int& sum);
+
+public:
+	// How far off a pixel centre, in pixels, a mirrored point may land and still count
+	static constexpr double TOLERANCE = 1e-3;
+
+	// Plans a width x height frame of the view. Burning Ship and custom formulas are not
+	// symmetric and get an empty plan.
+	void plan(Formula formula, double centerX, double centerY, double xRange, double yRange, int width, int height);
+	void clear() { row0 = row1 = column0 = column1 = 0; }
+
+	bool isActive() const { return row0 < row1 && column0 < column1; }
+	// A half turn maps columns too, and keeps orbits as they are; conjugation conjugates them
+	bool isHalfTurn() const { return halfTurn; }
+
+	int getRow0() const { return row0; }
+	int getRow1() const { return row1; }
+	int getColumn0() const { return column0; }
+	int getColumn1() const { return column1; }
+	int getCopiedCount() const { return isActive() ? (row1 - row0) * (column1 - column0) : 0; }
+
+	bool isCopied(int column, int row) const { return row >= row0 && row < row1 && column >= column0 && column < column1; }
+	// Whether a whole span of a row, columns [x0, x1), is copied
+	bool coversSpan(int row, int x0, int x1) const { return row >= row0 && row < row1 && x0 >= column0 && x1 <= column1; }
+
+	// The pixel a copied pixel takes its value from, and the other way round
+	int mirrorRow(int row) const { return rowSum - row; }
+	int mirrorColumn(int column) const { return halfTurn ? columnSum - column : column; }
+};
@@ -0,0 +1,134 @@
+#include "Nucleus.h"
+#include <algorithm>
+#include <cmath>
+
+int findNucleusPeriod(double cx, double cy, double radius, int maxPeriod) {
+	double zx = 0.0;
+	double zy = 0.0;
+	double dx = 0.0;	// dz/dc
+	double dy = 0.0;
+
+	for (int n = 1; n <= maxPeriod; ++n) {
+		// dz/dc' = 2 * z * dz/dc + 1, from the old z
+		double nx = 2.0 * (zx * dx - zy * dy) + 1.0;
+		double ny = 2.0 * (zx * dy + zy * dx);
+		dx = nx;
+		dy = ny;
+
+		double xx = zx * zx;
+		double yy = zy * zy;
+		zy = 2.0 * zx * zy + cy;
+		zx = xx - yy + cx;
+
+		double magnitude = zx * zx + zy * zy;
+		if (magnitude > 4.0) {
+			return 0;
+		}
+		double reach = radius * radius * (dx * dx + dy * dy);
+		if (magnitude < reach) {
+			return n;
+		}
+	}
+	return 0;
+}
+
+bool refineNucleus(double& cx, double& cy, int period, int maxSteps) {
+	for (int step = 0; step < maxSteps; ++step) {
+		double zx = 0.0;
+		double zy = 0.0;
+		double dx = 0.0;
+		double dy = 0.0;
+		for (int i = 0; i < period; ++i) {
+			double nx = 2.0 * (zx * dx - zy * dy) + 1.0;
+			double ny = 2.0 * (zx * dy + zy * dx);
+			dx = nx;
+			dy = ny;
+
+			double xx = zx * zx;
+			double yy = zy * zy;
+			zy = 2.0 * zx * zy + cy;
+			zx = xx - yy + cx;
+		}
+
+		// c -= z / (dz/dc)
+		double denominator = dx * dx + dy * dy;
+		if (!(denominator > 0.0) || !std::isfinite(denominator)) {
+			return false;
+		}
+		double stepX = (zx * dx + zy * dy) / denominator;
+		double stepY = (zy * dx - zx * dy) / denominator;
+		cx -= stepX;
+		cy -= stepY;
+		if (!std::isfinite(cx) || !std::isfinite(cy)) {
+			return false;
+		}
+
+		// Settled once the step no longer moves c by more than its last few bits
+		double scale = std::max(std::abs(cx), std::abs(cy));
+		if (std::abs(stepX) + std::abs(stepY) <= scale * 1e-15) {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool refineNucleus(BigFixed& cx, BigFixed& cy, int period, int maxSteps, const std::atomic<bool>* cancel) {
+	const int fractionLimbs = cx.getFractionLimbs();
+	BigFixed zx(fractionLimbs);
+	BigFixed zy(fractionLimbs);
+	BigFixed xx(fractionLimbs);
+	BigFixed yy(fractionLimbs);
+	BigFixed xy(fractionLimbs);
+	const BigFixed zero(fractionLimbs);
+	const FloatExp one(1.0);
+
+	for (int step = 0; step < maxSteps; ++step) {
+		if (cancel && cancel->load(std::memory_order_relaxed)) {
+			return false;
+		}
+		zx = zero;
+		zy = zero;
+		FloatExp dx;
+		FloatExp dy;
+		for (int i = 0; i < period; ++i) {
+			const FloatExp fx = zx.toFloatExp();
+			const FloatExp fy = zy.toFloatExp();
+			if ((fx * fx + fy * fy).toDouble() > 4.0) {
+				return false;
+			}
+			const FloatExp nx = (fx * dx - fy * dy) * 2.0 + one;
+			const FloatExp ny = (fx * dy + fy * dx) * 2.0;
+			dx = nx;
+			dy = ny;
+
+			BigFixed::multiply(zx, zx, xx);
+			BigFixed::multiply(zy, zy, yy);
+			BigFixed::multiply(zx, zy, xy);
+			zy = xy;
+			zy += xy;
+			zy += cy;
+			zx = xx;
+			zx -= yy;
+			zx += cx;
+		}
+
+		// c -= z / (dz/dc)
+		const FloatExp fx = zx.toFloatExp();
+		const FloatExp fy = zy.toFloatExp();
+		const FloatExp denominator = dx * dx + dy * dy;
+		if (!(denominator.getMantissa() > 0.0) || !std::isfinite(denominator.getMantissa())) {
+			return false;
+		}
+		const FloatExp stepX = (fx * dx + fy * dy) / denominator;
+		const FloatExp stepY = (fy * dx - fx * dy) / denominator;
+		cx -= BigFixed(fractionLimbs, stepX);
+		cy -= BigFixed(fractionLimbs, stepY);
+
+		// Settled once the step is down to the last few fraction bits
+		const std::int64_t lastBit = -32 * static_cast<std::int64_t>(fractionLimbs) + 4;
+		if (stepX.getExponent() < lastBit && stepY.getExponent() < lastBit) {
+			return true;
+		}
+	}
+	return false;
+}
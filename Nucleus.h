@@ -0,0 +1,26 @@
+#pragma once
+
+#include "BigFixed.h"
+#include <atomic>
+
+// Locating the nucleus of a minibrot: the point c whose orbit returns exactly to 0 after
+// `period` iterations. A zoom that ends on a minibrot can use the nucleus as its reference
+// point, and then the reference orbit is only one period long (see
+// ReferenceOrbit::computePeriodic).
+
+// Period of the lowest-period nucleus in the disc of the given radius around (cx, cy), or
+// 0 if there is none up to maxPeriod. The disc is iterated along with the orbit of its
+// centre, to first order through the derivative dz/dc, and the period is the first
+// iteration whose image of the disc covers 0.
+int findNucleusPeriod(double cx, double cy, double radius, int maxPeriod);
+
+// Newton's method on z_period(c) = 0, starting at (cx, cy), which receive the nucleus.
+// Returns false if the iteration diverged or did not settle within maxSteps.
+bool refineNucleus(double& cx, double& cy, int period, int maxSteps = 64);
+
+// refineNucleus at the precision of cx and cy, for nuclei a double cannot place within a
+// pixel of a deep zoom. Seeded with the double nucleus, each step about doubles the
+// correct bits. dz/dc outgrows the integer limb and Newton only needs it roughly, so it is
+// kept in FloatExp. Also returns false if the orbit leaves |z| <= 2 within the period, or
+// once *cancel is set, which is looked at every step.
+bool refineNucleus(BigFixed& cx, BigFixed& cy, int period, int maxSteps = 64, const std::atomic<bool>* cancel = nullptr);
@@ -0,0 +1,166 @@
+#include "Palette.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define PALETTE_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+// MSVC accepts AVX2 intrinsics without /arch:AVX2, so the fast path is always compiled
+// and picked at run time.
+#define PALETTE_AVX2_TARGET
+#else
+#define PALETTE_AVX2_TARGET __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace {
+	std::uint32_t packColor(const sf::Vector3f& c) {
+		auto toByte = [](float v) {
+			return static_cast<std::uint32_t>(std::min(std::max(v, 0.0f), 1.0f) * 255.0f + 0.5f);
+		};
+		return toByte(c.x) | (toByte(c.y) << 8) | (toByte(c.z) << 16) | 0xFF000000u;
+	}
+
+	inline int lutIndex(float norm) {
+		norm -= std::floor(norm);
+		int index = static_cast<int>(norm * PaletteLut::SIZE);
+		// NaN and infinity land here as garbage; keep them inside the table.
+		return std::min(std::max(index, 0), PaletteLut::SIZE - 1);
+	}
+
+	// Position of a value in the cumulative distribution, interpolated inside its bin.
+	inline float equalized(float value, const float* cdf, int cdfBins) {
+		int bin = std::min(std::max(static_cast<int>(value), 0), cdfBins - 1);
+		float t = std::min(std::max(value - static_cast<float>(bin), 0.0f), 1.0f);
+		return cdf[bin] + (cdf[bin + 1] - cdf[bin]) * t;
+	}
+
+	const std::uint32_t INTERIOR_COLOR = 0xFF000000u;	// opaque black
+
+	void colorizeScalar(const std::uint32_t* lut, const float* values, int count, float scale, float offset,
+		const float* cdf, int cdfBins, std::uint32_t* out) {
+		for (int i = 0; i < count; ++i) {
+			float norm = cdf ? equalized(values[i], cdf, cdfBins) : values[i] * scale;
+			out[i] = values[i] < 0.0f ? INTERIOR_COLOR : lut[lutIndex(norm + offset)];
+		}
+	}
+
+#ifdef PALETTE_X86
+	bool cpuHasAvx2() {
+#if defined(_MSC_VER)
+		int regs[4];
+		__cpuid(regs, 0);
+		if (regs[0] < 7) {
+			return false;
+		}
+		__cpuid(regs, 1);
+		const int osxsave = 1 << 27;
+		const int avx = 1 << 28;
+		if ((regs[2] & osxsave) == 0 || (regs[2] & avx) == 0 || (_xgetbv(0) & 6) != 6) {
+			return false;
+		}
+		__cpuidex(regs, 7, 0);
+		return (regs[1] & (1 << 5)) != 0;
+#else
+		return __builtin_cpu_supports("avx2");
+#endif
+	}
+
+	// Eight pixels per step: the table index is computed in vector registers and the
+	// colours come from a single gather, with a blend for interior pixels.
+	PALETTE_AVX2_TARGET void colorizeAvx2(const std::uint32_t* lut, const float* values, int count, float scale,
+		float offset, const float* cdf, int cdfBins, std::uint32_t* out) {
+		const __m256 scaleV = _mm256_set1_ps(scale);
+		const __m256 offsetV = _mm256_set1_ps(offset);
+		const __m256 sizeV = _mm256_set1_ps(static_cast<float>(PaletteLut::SIZE));
+		const __m256 zero = _mm256_setzero_ps();
+		const __m256i maxIndex = _mm256_set1_epi32(PaletteLut::SIZE - 1);
+		const __m256i interiorColor = _mm256_set1_epi32(static_cast<int>(INTERIOR_COLOR));
+		const __m256i lastBin = _mm256_set1_epi32(cdfBins - 1);
+		const __m256i one = _mm256_set1_epi32(1);
+		const __m256 unit = _mm256_set1_ps(1.0f);
+
+		int i = 0;
+		for (; i + 8 <= count; i += 8) {
+			__m256 value = _mm256_loadu_ps(values + i);
+			__m256 norm;
+			if (cdf) {
+				__m256i bin = _mm256_cvttps_epi32(value);
+				bin = _mm256_max_epi32(_mm256_min_epi32(bin, lastBin), _mm256_setzero_si256());
+				__m256 t = _mm256_sub_ps(value, _mm256_cvtepi32_ps(bin));
+				t = _mm256_min_ps(_mm256_max_ps(t, zero), unit);
+				__m256 low = _mm256_i32gather_ps(cdf, bin, 4);
+				__m256 high = _mm256_i32gather_ps(cdf, _mm256_add_epi32(bin, one), 4);
+				norm = _mm256_add_ps(low, _mm256_mul_ps(_mm256_sub_ps(high, low), t));
+			}
+			else {
+				norm = _mm256_mul_ps(value, scaleV);
+			}
+			norm = _mm256_add_ps(norm, offsetV);
+			norm = _mm256_sub_ps(norm, _mm256_floor_ps(norm));
+
+			__m256i index = _mm256_cvttps_epi32(_mm256_mul_ps(norm, sizeV));
+			index = _mm256_max_epi32(_mm256_min_epi32(index, maxIndex), _mm256_setzero_si256());
+
+			__m256i color = _mm256_i32gather_epi32(reinterpret_cast<const int*>(lut), index, 4);
+			__m256 interior = _mm256_cmp_ps(value, zero, _CMP_LT_OQ);
+			color = _mm256_blendv_epi8(color, interiorColor, _mm256_castps_si256(interior));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), color);
+		}
+		colorizeScalar(lut, values + i, count - i, scale, offset, cdf, cdfBins, out + i);
+	}
+
+	const bool HAS_AVX2 = cpuHasAvx2();
+#endif
+}
+
+PaletteLut::PaletteLut() {
+	build(defaultGradientStops(), sf::Vector3f(1.0f, 1.0f, 1.0f));
+}
+
+void PaletteLut::build(const std::vector<GradientStop>& stops, const sf::Vector3f& colorScale) {
+	entries.assign(SIZE, INTERIOR_COLOR);
+	if (stops.empty()) {
+		return;
+	}
+
+	size_t segment = 0;
+	for (int i = 0; i < SIZE; ++i) {
+		// Entry i covers the centre of texel i, so GPU filtering and CPU lookup agree.
+		float t = (i + 0.5f) / SIZE;
+		while (segment + 1 < stops.size() && stops[segment + 1].position <= t) {
+			++segment;
+		}
+
+		const GradientStop& a = stops[segment];
+		const GradientStop& b = stops[std::min(segment + 1, stops.size() - 1)];
+		float span = b.position - a.position;
+		float blend = span > 0.0f ? std::min(std::max((t - a.position) / span, 0.0f), 1.0f) : 0.0f;
+
+		sf::Vector3f c = a.color + (b.color - a.color) * blend;
+		entries[i] = packColor(sf::Vector3f(c.x * colorScale.x, c.y * colorScale.y, c.z * colorScale.z));
+	}
+}
+
+sf::Color PaletteLut::color(float smoothIterations, int maxIterations, float offset) const {
+	if (smoothIterations < 0.0f) {
+		return sf::Color::Black;
+	}
+	std::uint32_t c = entries[lutIndex(smoothIterations / static_cast<float>(maxIterations) + offset)];
+	return sf::Color(c & 0xFF, (c >> 8) & 0xFF, (c >> 16) & 0xFF);
+}
+
+void PaletteLut::colorize(const float* values, int count, int maxIterations, float offset, std::uint8_t* rgba,
+	const float* cdf, int cdfBins) const {
+	const float scale = 1.0f / static_cast<float>(maxIterations);
+	std::uint32_t* out = reinterpret_cast<std::uint32_t*>(rgba);
+#ifdef PALETTE_X86
+	if (HAS_AVX2) {
+		colorizeAvx2(entries.data(), values, count, scale, offset, cdf, cdfBins, out);
+		return;
+	}
+#endif
+	colorizeScalar(entries.data(), values, count, scale, offset, cdf, cdfBins, out);
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <SFML/Graphics/Color.hpp>
+#include <SFML/System/Vector3.hpp>
+#include <cstdint>
+#include <vector>
+
+struct GradientStop {
+	float position;		// 0..1 along the palette
+	sf::Vector3f color;
+};
+
+// The gradient getGradientColor in mandelbrot.frag used to hard-code. It starts and ends
+// on the same colour, so it cycles without a seam.
+inline std::vector<GradientStop> defaultGradientStops() {
+	return {
+		{ 0.00f, { 0.5f, 0.0f, 0.1f } },
+		{ 0.25f, { 1.0f, 0.8f, 0.0f } },
+		{ 0.50f, { 1.0f, 0.5f, 0.0f } },
+		{ 0.75f, { 1.0f, 0.4f, 0.4f } },
+		{ 1.00f, { 0.5f, 0.0f, 0.1f } },
+	};
+}
+
+// Gradient baked into a fixed-size RGBA table. The same bytes back the palette texture
+// on the GPU and the CPU colouring, so both paths colour a pixel with one lookup instead
+// of searching the stops. Lookups wrap around, which is what makes the palette offset
+// cyclic.
+class PaletteLut {
+private:
+	std::vector<std::uint32_t> entries;	// RGBA8, red in the lowest byte
+
+public:
+	static constexpr int SIZE = 1024;
+
+	PaletteLut();
+
+	// Rebuilds the table from stops sorted by position. colorScale multiplies every entry,
+	// as the old uniform did in the shader.
+	void build(const std::vector<GradientStop>& stops, const sf::Vector3f& colorScale);
+
+	// Colours a smooth iteration value; negative values mark pixels that never escaped.
+	sf::Color color(float smoothIterations, int maxIterations, float offset = 0.0f) const;
+
+	// Colours `count` values into RGBA8 pixels. Uses AVX2 gathers when the CPU has them.
+	// With a cdf (see IterationHistogram) the palette position is the value's rank in the
+	// frame rather than value / maxIterations, which spreads the colours evenly.
+	void colorize(const float* values, int count, int maxIterations, float offset, std::uint8_t* rgba,
+		const float* cdf = nullptr, int cdfBins = 0) const;
+
+	const std::uint8_t* getPixels() const { return reinterpret_cast<const std::uint8_t*>(entries.data()); }
+};
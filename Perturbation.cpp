@@ -0,0 +1,73 @@
+#include "Perturbation.h"
+#include <algorithm>
+#include <omp.h>
+
+namespace {
+	// Below this many limbs a product is over before the threads could meet at a barrier
+	constexpr int PARALLEL_LIMBS = 64;
+}
+
+void ReferenceOrbit::compute(const BigFixed& cx, const BigFixed& cy, int maxIterations, const std::atomic<bool>* cancel) {
+	centerX = cx.toDouble();
+	centerY = cy.toDouble();
+	x.assign(1, 0.0);
+	y.assign(1, 0.0);
+	x.reserve(static_cast<size_t>(maxIterations) + 1);
+	y.reserve(static_cast<size_t>(maxIterations) + 1);
+	appendBig(cx, cy, maxIterations, true, cancel);
+}
+
+void ReferenceOrbit::computePeriodic(const BigFixed& cx, const BigFixed& cy, int period, const std::atomic<bool>* cancel) {
+	centerX = cx.toDouble();
+	centerY = cy.toDouble();
+	x.assign(1, 0.0);
+	y.assign(1, 0.0);
+	x.reserve(static_cast<size_t>(period) + 1);
+	y.reserve(static_cast<size_t>(period) + 1);
+	appendBig(cx, cy, period - 1, false, cancel);
+	x.push_back(0.0);
+	y.push_back(0.0);
+}
+
+void ReferenceOrbit::appendBig(const BigFixed& cx, const BigFixed& cy, int steps, bool escapes, const std::atomic<bool>* cancel) {
+	const int fractionLimbs = cx.getFractionLimbs();
+	BigFixed zx(fractionLimbs);
+	BigFixed zy(fractionLimbs);
+	BigFixed xx(fractionLimbs);
+	BigFixed yy(fractionLimbs);
+	BigFixed xy(fractionLimbs);
+	const size_t end = x.size() + static_cast<size_t>(std::max(steps, 0));
+	bool done = x.size() >= end;
+
+#pragma omp parallel num_threads(3) if (fractionLimbs >= PARALLEL_LIMBS && omp_get_num_procs() > 1)
+	{
+		// A smaller team than asked for shares the products out
+		const int thread = omp_get_thread_num();
+		const int threads = omp_get_num_threads();
+		while (!done) {
+			for (int product = thread; product < 3; product += threads) {
+				switch (product) {
+				case 0: BigFixed::multiply(zx, zx, xx); break;
+				case 1: BigFixed::multiply(zy, zy, yy); break;
+				default: BigFixed::multiply(zx, zy, xy); break;
+				}
+			}
+#pragma omp barrier
+#pragma omp single
+			{
+				zy = xy;
+				zy += xy;
+				zy += cy;
+				zx = xx;
+				zx -= yy;
+				zx += cx;
+				double px = zx.toDouble();
+				double py = zy.toDouble();
+				x.push_back(px);
+				y.push_back(py);
+				done = x.size() >= end || (escapes && px * px + py * py > 4.0) || (cancel && cancel->load(std::memory_order_relaxed));
+			}
+			// The barrier closing the single makes `done` the same for every thread
+		}
+	}
+}
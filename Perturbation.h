@@ -0,0 +1,218 @@
+#pragma once
+
+#include "BigFixed.h"
+#include "FloatExp.h"
+#include <atomic>
+#include <cmath>
+#include <vector>
+
+// Orbit of a single reference point c0, iterated once at full precision. Every other
+// pixel is then iterated as a small delta from this orbit, so the reference can be
+// shared by a whole frame (or a whole zoom video around the same centre).
+class ReferenceOrbit {
+private:
+	std::vector<double> x;
+	std::vector<double> y;
+	double centerX = 0.0;
+	double centerY = 0.0;
+
+	// Appends z_1 to z_steps of the orbit of (cx, cy) at their precision, stopping early
+	// at escape if escapes is set, or once *cancel is set
+	void appendBig(const BigFixed& cx, const BigFixed& cy, int steps, bool escapes, const std::atomic<bool>* cancel);
+
+public:
+	void compute(double cx, double cy, int maxIterations) {
+		centerX = cx;
+		centerY = cy;
+		x.clear();
+		y.clear();
+		x.reserve(static_cast<size_t>(maxIterations) + 1);
+		y.reserve(static_cast<size_t>(maxIterations) + 1);
+
+		double zx = 0.0;
+		double zy = 0.0;
+		x.push_back(zx);
+		y.push_back(zy);
+		for (int i = 0; i < maxIterations; ++i) {
+			double xx = zx * zx;
+			double yy = zy * zy;
+			zy = 2.0 * zx * zy + cy;
+			zx = xx - yy + cx;
+			x.push_back(zx);
+			y.push_back(zy);
+			if (zx * zx + zy * zy > 4.0) {
+				break;
+			}
+		}
+	}
+
+	// compute at the precision of cx and cy, for centres that need more bits than a double
+	// has. Only the orbit is kept in doubles, which is all the deltas need. Each step's
+	// three products are independent, so long numbers compute them on three threads. While
+	// *cancel is set it stops where it is, leaving the orbit short.
+	void compute(const BigFixed& cx, const BigFixed& cy, int maxIterations, const std::atomic<bool>* cancel = nullptr);
+
+	// The orbit of a nucleus of this period (see Nucleus.h) repeats after one period, so
+	// only one is stored. z_period is set to exactly 0; the perturbation loops rebase when
+	// they reach it, and since it is 0 the rebase changes nothing, so the delta just carries
+	// on from the start of the period.
+	void computePeriodic(double cx, double cy, int period) {
+		centerX = cx;
+		centerY = cy;
+		x.assign(1, 0.0);
+		y.assign(1, 0.0);
+		x.reserve(static_cast<size_t>(period) + 1);
+		y.reserve(static_cast<size_t>(period) + 1);
+
+		double zx = 0.0;
+		double zy = 0.0;
+		for (int i = 1; i < period; ++i) {
+			double xx = zx * zx;
+			double yy = zy * zy;
+			zy = 2.0 * zx * zy + cy;
+			zx = xx - yy + cx;
+			x.push_back(zx);
+			y.push_back(zy);
+		}
+		x.push_back(0.0);
+		y.push_back(0.0);
+	}
+
+	// computePeriodic at the precision of cx and cy, for a nucleus refined past the reach
+	// of a double (see refineNucleus). Stops early like compute on *cancel.
+	void computePeriodic(const BigFixed& cx, const BigFixed& cy, int period, const std::atomic<bool>* cancel = nullptr);
+
+	int length() const { return static_cast<int>(x.size()); }
+	double getX(int n) const { return x[n]; }
+	double getY(int n) const { return y[n]; }
+	double getCenterX() const { return centerX; }
+	double getCenterY() const { return centerY; }
+};
+
+// Smooth iteration count of a pixel whose |z|^2 passed 4 at `iteration`
+inline float perturbedEscapeValue(int iteration, double magnitude) {
+	return static_cast<float>(iteration + 2 - std::log(std::log(std::sqrt(magnitude))) / std::log(2.0));
+}
+
+// perturbedIterations from `iteration` on, with the delta dz taken against point m of the
+// reference orbit. When steps is given it receives the iterations to escape, or -1, as the
+// span kernels count them.
+inline float continuePerturbed(const ReferenceOrbit& orbit, double dcx, double dcy, double dzx, double dzy, int m, int iteration,
+	int maxIterations, int* steps = nullptr) {
+	const int last = orbit.length() - 1;
+
+	for (; iteration < maxIterations; ++iteration) {
+		double refX = orbit.getX(m);
+		double refY = orbit.getY(m);
+
+		// dz' = 2 * Z * dz + dz^2 + dc
+		double nx = 2.0 * (refX * dzx - refY * dzy) + (dzx * dzx - dzy * dzy) + dcx;
+		double ny = 2.0 * (refX * dzy + refY * dzx) + 2.0 * dzx * dzy + dcy;
+		dzx = nx;
+		dzy = ny;
+		++m;
+
+		double zx = orbit.getX(m) + dzx;
+		double zy = orbit.getY(m) + dzy;
+		double magnitude = zx * zx + zy * zy;
+		if (magnitude > 4.0) {
+			if (steps) {
+				*steps = iteration + 1;
+			}
+			return perturbedEscapeValue(iteration, magnitude);
+		}
+
+		if (magnitude < dzx * dzx + dzy * dzy || m == last) {
+			dzx = zx;
+			dzy = zy;
+			m = 0;
+		}
+	}
+	if (steps) {
+		*steps = -1;
+	}
+	return -1.0f;
+}
+
+// Iterates the point c0 + (dcx, dcy) as a delta against the reference orbit and returns
+// the smooth iteration count, or -1 if the point did not escape. When the delta grows
+// larger than the full value, or the reference runs out, the delta is rebased onto the
+// start of the orbit, so a single reference stays valid for every pixel.
+inline float perturbedIterations(const ReferenceOrbit& orbit, double dcx, double dcy, int maxIterations, int* steps = nullptr) {
+	return continuePerturbed(orbit, dcx, dcy, 0.0, 0.0, 0, 0, maxIterations, steps);
+}
+
+// perturbedIterations for Lanes points whose deltas may lie far below the range of a
+// double. While the deltas are that small the lanes iterate in lock-step in FloatExp,
+// against the same reference point, since none of them can rebase yet; each lane goes on
+// in plain doubles as soon as its delta has grown back into range. Lanes already in range
+// skip the FloatExp part entirely. steps, when given, is filled as by continuePerturbed.
+template<int Lanes>
+inline void perturbedLanes(const ReferenceOrbit& orbit, const FloatExp* dcx, const FloatExp* dcy, int maxIterations, float* out,
+	int* steps = nullptr) {
+	int laneSteps[Lanes];
+	FloatExp dzx[Lanes], dzy[Lanes];
+	bool finished[Lanes];
+	int running = 0;
+	for (int l = 0; l < Lanes; ++l) {
+		finished[l] = dcx[l].inDoubleRange() || dcy[l].inDoubleRange();
+		if (finished[l]) {
+			out[l] = perturbedIterations(orbit, dcx[l].toDouble(), dcy[l].toDouble(), maxIterations, &laneSteps[l]);
+		}
+		running += finished[l] ? 0 : 1;
+	}
+
+	const int last = orbit.length() - 1;
+	int m = 0;
+	for (int iteration = 0; iteration < maxIterations && running > 0; ++iteration) {
+		const FloatExp refX(orbit.getX(m));
+		const FloatExp refY(orbit.getY(m));
+
+		// dz' = 2 * Z * dz + dz^2 + dc
+		for (int l = 0; l < Lanes; ++l) {
+			const FloatExp nx = (refX * dzx[l] - refY * dzy[l]) * 2.0 + (dzx[l] * dzx[l] - dzy[l] * dzy[l]) + dcx[l];
+			const FloatExp ny = (refX * dzy[l] + refY * dzx[l]) * 2.0 + dzx[l] * dzy[l] * 2.0 + dcy[l];
+			dzx[l] = nx;
+			dzy[l] = ny;
+		}
+		++m;
+		// At the end of the reference every lane rebases at once, still in FloatExp. For a
+		// periodic reference z_m is 0 there and the deltas stay as they are.
+		const bool rebase = m == last;
+
+		// z is the reference point to double precision until dz is back in range
+		for (int l = 0; l < Lanes; ++l) {
+			if (finished[l]) {
+				continue;
+			}
+			const double zx = orbit.getX(m) + dzx[l].toDouble();
+			const double zy = orbit.getY(m) + dzy[l].toDouble();
+			const double magnitude = zx * zx + zy * zy;
+			if (magnitude > 4.0) {
+				out[l] = perturbedEscapeValue(iteration, magnitude);
+				laneSteps[l] = iteration + 1;
+				finished[l] = true;
+				--running;
+				continue;
+			}
+			if (rebase) {
+				dzx[l] = FloatExp(orbit.getX(m)) + dzx[l];
+				dzy[l] = FloatExp(orbit.getY(m)) + dzy[l];
+			}
+			if (dzx[l].inDoubleRange() || dzy[l].inDoubleRange()) {
+				out[l] = continuePerturbed(orbit, dcx[l].toDouble(), dcy[l].toDouble(), dzx[l].toDouble(), dzy[l].toDouble(),
+					rebase ? 0 : m, iteration + 1, maxIterations, &laneSteps[l]);
+				finished[l] = true;
+				--running;
+			}
+		}
+		m = rebase ? 0 : m;
+	}
+
+	for (int l = 0; l < Lanes; ++l) {
+		out[l] = finished[l] ? out[l] : -1.0f;
+		if (steps) {
+			steps[l] = finished[l] ? laneSteps[l] : -1;
+		}
+	}
+}
@@ -0,0 +1,90 @@
+#include "PrecisionPlanner.h"
+#include "Fixed128.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+	// Floating-point precisions with their mantissa bits, including the implicit bit
+	struct FloatingPrecision {
+		Precision precision;
+		int bits;
+	};
+	constexpr FloatingPrecision FLOATING[] = { { Precision::Float, 24 }, { Precision::Double, 53 }, { Precision::DoubleDouble, 106 } };
+}
+
+int PrecisionPlanner::requiredBits(double pixel, double magnitude, int maxIterations) {
+	const int guard = GUARD_BITS + static_cast<int>(std::ceil(std::log2(std::max(maxIterations, 1))));
+	if (pixel <= 0.0 || magnitude <= pixel) {
+		return guard;
+	}
+	return static_cast<int>(std::ceil(std::log2(magnitude / pixel))) + guard;
+}
+
+Precision PrecisionPlanner::precisionFor(int bits) {
+	for (const FloatingPrecision& floating : FLOATING) {
+		if (bits <= floating.bits) {
+			return floating.precision;
+		}
+	}
+	return Precision::BigFloat;
+}
+
+Precision PrecisionPlanner::precisionFor(double pixel, double magnitude, int maxIterations, bool fixed, bool doubleDoubleFirst) {
+	const Precision floating = precisionFor(requiredBits(pixel, magnitude, maxIterations));
+	if (floating <= Precision::Double || (floating == Precision::DoubleDouble && doubleDoubleFirst)) {
+		return floating;
+	}
+	if (fixed && magnitude <= Fixed128::SAFE_MAGNITUDE && requiredBits(pixel, 1.0, maxIterations) <= Fixed128::FRACTION_BITS) {
+		return Precision::Fixed128;
+	}
+	return floating;
+}
+
+void PrecisionPlanner::resize(int width, int height, int newTileSize) {
+	tileSize = newTileSize;
+	tilesX = (width + tileSize - 1) / tileSize;
+	tilesY = (height + tileSize - 1) / tileSize;
+	tiles.resize(static_cast<size_t>(tilesX) * tilesY);
+	std::fill(std::begin(counts), std::end(counts), 0);
+	unserved = 0;
+}
+
+void PrecisionPlanner::plan(double centerX, double centerY, double xRange, double yRange, int maxIterations, int width, int height, int newTileSize,
+	bool fixed, bool doubleDoubleFirst) {
+	resize(width, height, newTileSize);
+	const double dx = xRange / width;
+	const double dy = yRange / height;
+	const double pixel = std::min(dx, dy);
+	const double xMin = centerX - 0.5 * xRange;
+	const double yMax = centerY + 0.5 * yRange;
+
+	for (int ty = 0; ty < tilesY; ++ty) {
+		const double top = yMax - ty * tileSize * dy;
+		const double bottom = yMax - std::min((ty + 1) * tileSize, height) * dy;
+		for (int tx = 0; tx < tilesX; ++tx) {
+			const double left = xMin + tx * tileSize * dx;
+			const double right = xMin + std::min((tx + 1) * tileSize, width) * dx;
+			const double magnitude = std::max(std::max(std::abs(left), std::abs(right)), std::max(std::abs(top), std::abs(bottom)));
+			const Precision precision = precisionFor(pixel, magnitude, maxIterations, fixed, doubleDoubleFirst);
+			tiles[static_cast<size_t>(ty) * tilesX + tx] = precision;
+			++counts[static_cast<int>(precision)];
+		}
+	}
+}
+
+void PrecisionPlanner::planUniform(Precision precision, int width, int height, int newTileSize) {
+	resize(width, height, newTileSize);
+	std::fill(tiles.begin(), tiles.end(), precision);
+	counts[static_cast<int>(precision)] = static_cast<int>(tiles.size());
+}
+
+void PrecisionPlanner::cap(Precision highest) {
+	for (Precision& tile : tiles) {
+		if (tile > highest) {
+			--counts[static_cast<int>(tile)];
+			++counts[static_cast<int>(highest)];
+			++unserved;
+			tile = highest;
+		}
+	}
+}
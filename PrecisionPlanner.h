@@ -0,0 +1,83 @@
+#pragma once
+
+#include <vector>
+
+// Arithmetic a tile is iterated in, cheapest first
+enum class Precision {
+	Float,
+	Double,
+	Fixed128,
+	DoubleDouble,
+	BigFloat,
+	Count
+};
+
+inline const char* precisionName(Precision precision) {
+	switch (precision) {
+	case Precision::Float: return "float";
+	case Precision::Double: return "double";
+	case Precision::Fixed128: return "fixed128";
+	case Precision::DoubleDouble: return "double-double";
+	case Precision::BigFloat: return "bigfloat";
+	default: return "";
+	}
+}
+
+// Chooses the precision of each tile of a frame. Neighbouring pixels stay apart only while
+// the pixel spacing is above the spacing of representable numbers at the tile's
+// coordinates, so a tile needs log2(magnitude / pixel) mantissa bits. The rounding of every
+// iteration adds up along the orbit, so on top of that come log2(maxIterations) guard bits
+// and a few more. Tiles close to the origin get by with fewer bits than tiles of the same
+// frame further out.
+//
+// Past double, Fixed128 takes every tile whose pixels are above its fixed spacing, whatever
+// their magnitude: it needs log2(1 / pixel) fraction bits plus the same guard bits. Where
+// double-double's 106 bits are enough as well, the caller says which of the two is faster
+// on this machine. Tiles further out than Fixed128::SAFE_MAGNITUDE would overflow it and go
+// to double-double, or to BigFloat past that. The renderer may have nothing that serves a tile's precision, in
+// which case it caps the plan and the capped tiles are counted as unserved.
+class PrecisionPlanner {
+private:
+	std::vector<Precision> tiles;
+	int tilesX = 0;
+	int tilesY = 0;
+	int tileSize = 1;
+	int counts[static_cast<int>(Precision::Count)] = {};
+	int unserved = 0;
+
+	void resize(int width, int height, int newTileSize);
+
+public:
+	static constexpr int GUARD_BITS = 4;
+
+	// Mantissa bits needed for pixels `pixel` apart at coordinates up to magnitude
+	static int requiredBits(double pixel, double magnitude, int maxIterations);
+	// The cheapest floating-point precision with at least `bits` mantissa bits
+	static Precision precisionFor(int bits);
+	// precisionFor, with Fixed128 in place of anything above double that it resolves, unless
+	// the tile is out of Fixed128's range or `fixed` is false, or double-double resolves it
+	// too and doubleDoubleFirst is set
+	static Precision precisionFor(double pixel, double magnitude, int maxIterations, bool fixed = true, bool doubleDoubleFirst = false);
+
+	// Plans the tiles of a width x height frame over the view of xRange x yRange around
+	// (centerX, centerY), row 0 at the top. `fixed` is false where Fixed128 cannot hold any
+	// orbit of the frame, such as for a Julia constant out of its range. doubleDoubleFirst
+	// prefers double-double to Fixed128 where both resolve a tile.
+	void plan(double centerX, double centerY, double xRange, double yRange, int maxIterations, int width, int height, int newTileSize,
+		bool fixed = true, bool doubleDoubleFirst = false);
+	// Every tile at the same precision
+	void planUniform(Precision precision, int width, int height, int newTileSize);
+	// Plans the tiles above highest at highest instead, and counts them as unserved
+	void cap(Precision highest);
+
+	Precision getTile(int tile) const { return tiles[tile]; }
+	Precision getPixel(int x, int y) const { return tiles[(y / tileSize) * tilesX + x / tileSize]; }
+	int getTilesX() const { return tilesX; }
+	int getTilesY() const { return tilesY; }
+	int getTileSize() const { return tileSize; }
+	int getCount(Precision precision) const { return counts[static_cast<int>(precision)]; }
+	// Tiles that cap took precision from; they render in less than they need
+	int getUnservedCount() const { return unserved; }
+
+	bool operator==(const PrecisionPlanner& other) const { return tileSize == other.tileSize && tiles == other.tiles; }
+};
@@ -0,0 +1,21 @@
+#include "ResolutionGovernor.h"
+#include <algorithm>
+#include <cmath>
+
+void ResolutionGovernor::record(float milliseconds, float renderScale) {
+	if (milliseconds <= 0.0f || renderScale <= 0.0f) {
+		return;
+	}
+	const float ratio = scale / renderScale;
+	const float predicted = milliseconds * ratio * ratio;
+	if (predicted >= LOWER_TOLERANCE * budgetMilliseconds && predicted <= UPPER_TOLERANCE * budgetMilliseconds) {
+		return;
+	}
+	// Rounded down, so the new scale meets the budget rather than just missing it
+	const float ideal = renderScale * std::sqrt(budgetMilliseconds / milliseconds);
+	scale = std::clamp(std::floor(ideal / SCALE_STEP) * SCALE_STEP, MIN_SCALE, 1.0f);
+}
+
+int ResolutionGovernor::scaled(int size) const {
+	return std::max(1, static_cast<int>(std::lround(size * scale)));
+}
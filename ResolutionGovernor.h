@@ -0,0 +1,29 @@
+#pragma once
+
+// Picks the render scale for interactive frames so that iterating a frame stays within a
+// time budget. Iteration cost grows with the pixel count, so a frame that took t at scale s
+// would take about t * (s' / s)^2 at scale s'. Each measurement moves the scale to where the
+// budget would just be met, in steps of SCALE_STEP and only once the prediction leaves the
+// tolerance band, so the resolution does not flicker between two neighbouring steps.
+class ResolutionGovernor {
+private:
+	float budgetMilliseconds = 16.0f;
+	float scale = 1.0f;
+
+public:
+	static constexpr float MIN_SCALE = 0.25f;
+	static constexpr float SCALE_STEP = 1.0f / 16.0f;
+	// Predicted frame times within these fractions of the budget keep the scale
+	static constexpr float LOWER_TOLERANCE = 0.6f;
+	static constexpr float UPPER_TOLERANCE = 1.15f;
+
+	void setBudget(float milliseconds) { budgetMilliseconds = milliseconds; }
+	float getBudget() const { return budgetMilliseconds; }
+
+	// Feeds how long iterating a frame at renderScale took, whatever scale it was.
+	void record(float milliseconds, float renderScale);
+
+	float getScale() const { return scale; }
+	// size at the current scale, at least one pixel
+	int scaled(int size) const;
+};
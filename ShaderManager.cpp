@@ -0,0 +1,340 @@
+#include "ShaderManager.h"
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+
+namespace {
+	// FNV-1a; only has to tell variants apart, not resist anyone
+	std::uint64_t hashText(const std::string& text, std::uint64_t hash = 0xCBF29CE484222325ull) {
+		for (unsigned char c : text) {
+			hash = (hash ^ c) * 0x100000001B3ull;
+		}
+		return hash;
+	}
+
+	std::string glString(GLenum name) {
+		const GLubyte* value = glGetString(name);
+		return value ? reinterpret_cast<const char*>(value) : "";
+	}
+
+	// The #version line has to stay first, so the defines go right after it. The #line
+	// directive keeps compiler messages pointing at lines of the file itself.
+	std::string withDefines(const std::string& text, const std::string& defines, int sourceNumber) {
+		size_t versionEnd = text.find('\n');
+		if (versionEnd == std::string::npos) {
+			return text + '\n' + defines;
+		}
+		std::string source = text;
+		source.insert(versionEnd + 1, defines + "#line 2 " + std::to_string(sourceNumber) + "\n");
+		return source;
+	}
+
+	// The quoted file name if line is an #include directive
+	bool includeName(const std::string& line, std::string& name) {
+		size_t start = line.find_first_not_of(" \t");
+		if (start == std::string::npos || line.compare(start, 8, "#include") != 0) {
+			return false;
+		}
+		size_t open = line.find('"', start + 8);
+		size_t close = open == std::string::npos ? open : line.find('"', open + 1);
+		if (close == std::string::npos) {
+			return false;
+		}
+		name = line.substr(open + 1, close - open - 1);
+		return true;
+	}
+
+	const int MAX_INCLUDE_DEPTH = 8;
+}
+
+void ShaderManager::init(const std::filesystem::path& directory) {
+	cacheDirectory = directory;
+	driver = glString(GL_VENDOR) + '\n' + glString(GL_RENDERER) + '\n' + glString(GL_VERSION);
+
+	// Mesa reports zero formats when its own shader cache is disabled
+	GLint formats = 0;
+	if (gl.hasProgramBinary()) {
+		glGetIntegerv(GlEnum::NUM_PROGRAM_BINARY_FORMATS, &formats);
+	}
+	useBinaryCache = formats > 0 && !cacheDirectory.empty();
+	if (useBinaryCache) {
+		std::error_code error;
+		std::filesystem::create_directories(cacheDirectory, error);
+		useBinaryCache = !error;
+	}
+}
+
+bool ShaderManager::readSource(Source& source) {
+	std::ifstream file(source.path, std::ios::binary);
+	if (!file) {
+		return false;
+	}
+	std::stringstream buffer;
+	buffer << file.rdbuf();
+	source.text = buffer.str();
+	std::error_code error;
+	source.modified = std::filesystem::last_write_time(source.path, error);
+	return true;
+}
+
+ShaderManager::SourceId ShaderManager::addSource(const std::filesystem::path& path) {
+	Source source;
+	source.path = path;
+	source.stage = path.extension() == ".comp" ? GlEnum::COMPUTE_SHADER : GlEnum::FRAGMENT_SHADER;
+	if (!readSource(source)) {
+		std::cerr << "Cannot read shader " << path.string() << std::endl;
+		return -1;
+	}
+	sources.push_back(std::move(source));
+	return static_cast<SourceId>(sources.size() - 1);
+}
+
+ShaderManager::SourceId ShaderManager::findSource(const std::filesystem::path& path) {
+	for (size_t i = 0; i < sources.size(); ++i) {
+		if (sources[i].path == path) {
+			return static_cast<SourceId>(i);
+		}
+	}
+	return addSource(path);
+}
+
+// Appends the source's text to `text` with its #include lines replaced, and collects the
+// ids of everything included.
+bool ShaderManager::expand(SourceId id, std::string& text, std::vector<SourceId>& includes, int depth) {
+	if (depth > MAX_INCLUDE_DEPTH) {
+		std::cerr << "Includes nested too deeply in " << sources[id].path.string() << std::endl;
+		return false;
+	}
+	// Copied: findSource may grow `sources`
+	const std::string source = sources[id].text;
+	const std::filesystem::path directory = sources[id].path.parent_path();
+
+	int lineNumber = 1;
+	size_t start = 0;
+	while (start < source.size()) {
+		size_t end = source.find('\n', start);
+		end = end == std::string::npos ? source.size() : end + 1;
+		std::string line = source.substr(start, end - start);
+		std::string name;
+		if (includeName(line, name)) {
+			SourceId included = findSource(directory / name);
+			if (included < 0) {
+				return false;
+			}
+			includes.push_back(included);
+			text += "#line 1 " + std::to_string(included) + "\n";
+			if (!expand(included, text, includes, depth + 1)) {
+				return false;
+			}
+			text += "\n#line " + std::to_string(lineNumber + 1) + " " + std::to_string(id) + "\n";
+		}
+		else {
+			text += line;
+		}
+		start = end;
+		++lineNumber;
+	}
+	return true;
+}
+
+void ShaderManager::bindSampler(const std::string& name, GLint unit) {
+	samplerUnits.emplace_back(name, unit);
+}
+
+void ShaderManager::bindBlock(const std::string& name, GLuint binding) {
+	blockBindings.emplace_back(name, binding);
+}
+
+GLuint ShaderManager::get(SourceId source, const std::string& defines) {
+	if (source < 0) {
+		return 0;
+	}
+	std::string key = std::to_string(source) + '\n' + defines;
+	auto it = programs.find(key);
+	if (it != programs.end() && !it->second.stale) {
+		return it->second.id;
+	}
+
+	GLuint program = build(source, defines);
+	if (it == programs.end()) {
+		programs.emplace(key, Program{ source, program, false });
+		return program;
+	}
+	// A rebuild after a source change: keep the old program if the edit is broken
+	if (program) {
+		if (it->second.id) {
+			gl.deleteProgram(it->second.id);
+		}
+		it->second.id = program;
+	}
+	it->second.stale = false;
+	return it->second.id;
+}
+
+bool ShaderManager::reloadChanged() {
+	std::vector<bool> changed(sources.size(), false);
+	bool any = false;
+	for (size_t i = 0; i < sources.size(); ++i) {
+		Source& source = sources[i];
+		std::error_code error;
+		auto modified = std::filesystem::last_write_time(source.path, error);
+		if (error || modified == source.modified || !readSource(source)) {
+			continue;
+		}
+		std::cerr << "Reloaded " << source.path.string() << std::endl;
+		changed[i] = true;
+		any = true;
+	}
+	if (!any) {
+		return false;
+	}
+
+	for (auto& entry : programs) {
+		const Source& root = sources[entry.second.source];
+		bool stale = changed[entry.second.source];
+		for (SourceId included : root.includes) {
+			stale = stale || changed[included];
+		}
+		entry.second.stale = entry.second.stale || stale;
+	}
+	return true;
+}
+
+GLuint ShaderManager::build(SourceId id, const std::string& defines) {
+	std::string expanded;
+	std::vector<SourceId> includes;
+	if (!expand(id, expanded, includes, 0)) {
+		return 0;
+	}
+	sources[id].includes = includes;
+	const Source& source = sources[id];
+	std::string text = withDefines(expanded, defines, id);
+
+	std::filesystem::path cacheFile;
+	if (useBinaryCache) {
+		char name[32];
+		std::snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(hashText(text, hashText(driver))));
+		cacheFile = cacheDirectory / name;
+		if (GLuint program = loadBinary(cacheFile)) {
+			++cacheHitCount;
+			configure(program);
+			return program;
+		}
+	}
+
+	GLuint program = compile(text, source);
+	if (!program) {
+		return 0;
+	}
+	++compileCount;
+	if (useBinaryCache) {
+		saveBinary(program, cacheFile);
+	}
+	configure(program);
+	return program;
+}
+
+GLuint ShaderManager::compile(const std::string& text, const Source& source) {
+	GLuint shader = gl.createShader(source.stage);
+	const char* code = text.c_str();
+	gl.shaderSource(shader, 1, &code, nullptr);
+	gl.compileShader(shader);
+
+	GLint status = GL_FALSE;
+	gl.getShaderiv(shader, GlEnum::COMPILE_STATUS, &status);
+	if (status != GL_TRUE) {
+		GLint length = 0;
+		gl.getShaderiv(shader, GlEnum::INFO_LOG_LENGTH, &length);
+		std::string log(static_cast<size_t>(length > 0 ? length : 1), '\0');
+		gl.getShaderInfoLog(shader, static_cast<GLsizei>(log.size()), nullptr, &log[0]);
+		std::cerr << "Failed to compile " << source.path.string() << ":\n" << log.c_str();
+		for (SourceId included : source.includes) {
+			std::cerr << "(source " << included << " is " << sources[included].path.string() << ")\n";
+		}
+		std::cerr << std::endl;
+		gl.deleteShader(shader);
+		return 0;
+	}
+
+	GLuint program = gl.createProgram();
+	if (useBinaryCache) {
+		gl.programParameteri(program, GlEnum::PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
+	gl.attachShader(program, shader);
+	gl.linkProgram(program);
+	gl.detachShader(program, shader);
+	gl.deleteShader(shader);
+
+	gl.getProgramiv(program, GlEnum::LINK_STATUS, &status);
+	if (status != GL_TRUE) {
+		GLint length = 0;
+		gl.getProgramiv(program, GlEnum::INFO_LOG_LENGTH, &length);
+		std::string log(static_cast<size_t>(length > 0 ? length : 1), '\0');
+		gl.getProgramInfoLog(program, static_cast<GLsizei>(log.size()), nullptr, &log[0]);
+		std::cerr << "Failed to link " << source.path.string() << ":\n" << log.c_str() << std::endl;
+		gl.deleteProgram(program);
+		return 0;
+	}
+	return program;
+}
+
+// Cache files are the binary format followed by the binary itself. Drivers may reject
+// binaries from another version, so a failed load just means compiling again.
+GLuint ShaderManager::loadBinary(const std::filesystem::path& file) {
+	std::ifstream in(file, std::ios::binary);
+	GLenum format = 0;
+	if (!in.read(reinterpret_cast<char*>(&format), sizeof(format))) {
+		return 0;
+	}
+	std::vector<char> binary((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+	if (binary.empty()) {
+		return 0;
+	}
+
+	GLuint program = gl.createProgram();
+	gl.programBinary(program, format, binary.data(), static_cast<GLsizei>(binary.size()));
+	GLint status = GL_FALSE;
+	gl.getProgramiv(program, GlEnum::LINK_STATUS, &status);
+	if (status != GL_TRUE) {
+		gl.deleteProgram(program);
+		return 0;
+	}
+	return program;
+}
+
+void ShaderManager::saveBinary(GLuint program, const std::filesystem::path& file) {
+	GLint length = 0;
+	gl.getProgramiv(program, GlEnum::PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0) {
+		return;
+	}
+	std::vector<char> binary(static_cast<size_t>(length));
+	GLenum format = 0;
+	gl.getProgramBinary(program, length, nullptr, &format, binary.data());
+
+	std::ofstream out(file, std::ios::binary);
+	out.write(reinterpret_cast<const char*>(&format), sizeof(format));
+	out.write(binary.data(), static_cast<std::streamsize>(binary.size()));
+}
+
+// Sampler units and block bindings are program state that a binary load resets, so they
+// are set on every program however it was made.
+void ShaderManager::configure(GLuint program) {
+	gl.useProgram(program);
+	for (const auto& sampler : samplerUnits) {
+		GLint location = gl.getUniformLocation(program, sampler.first.c_str());
+		if (location != -1) {
+			gl.uniform1i(location, sampler.second);
+		}
+	}
+	gl.useProgram(0);
+	for (const auto& block : blockBindings) {
+		GLuint index = gl.getUniformBlockIndex(program, block.first.c_str());
+		if (index != GlEnum::INVALID_INDEX) {
+			gl.uniformBlockBinding(program, index, block.second);
+		}
+	}
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "GlFunctions.h"
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Owns the programs built from the shader files. A variant is a source file plus a block
+// of #defines inserted after its #version line, so every formula, precision and colouring
+// mode gets its own specialized program instead of branching on uniforms. Files ending in
+// .comp build compute programs, everything else fragment programs. A line
+// `#include "file"` is replaced by that file, looked up next to the including one; compiler
+// messages then number lines per file, using the SourceId as the GLSL source string
+// number.
+//
+// Variants are compiled the first time they are asked for. When the driver supports
+// program binaries, each linked program is also written to the cache directory, keyed by
+// a hash of the driver and the final source text, and later runs load it from there
+// instead of compiling. A source file that changes on disk, or one it includes, is re-read
+// and its variants are rebuilt on their next use; if the edit does not compile, the old
+// program stays.
+//
+// Programs are plain GL objects rather than sf::Shader, because SFML has no way to create
+// a shader from a binary. Bind one with gl.useProgram around a draw that has no
+// sf::Shader set; SFML leaves the current program alone in that case. Like the other GL
+// objects here, the programs live as long as the context.
+class ShaderManager {
+public:
+	typedef int SourceId;
+
+private:
+	struct Source {
+		std::filesystem::path path;
+		std::filesystem::file_time_type modified;
+		std::string text;
+		GLenum stage;
+		std::vector<SourceId> includes;	// everything the last build pulled in, recursively
+	};
+
+	struct Program {
+		SourceId source;
+		GLuint id;
+		bool stale;		// the source changed since id was linked
+	};
+
+	std::vector<Source> sources;
+	std::unordered_map<std::string, Program> programs;	// keyed by source and defines
+	std::vector<std::pair<std::string, GLint>> samplerUnits;
+	std::vector<std::pair<std::string, GLuint>> blockBindings;
+	std::filesystem::path cacheDirectory;
+	std::string driver;		// vendor, renderer and version; part of every cache key
+	bool useBinaryCache = false;
+	int compileCount = 0;
+	int cacheHitCount = 0;
+
+	static bool readSource(Source& source);
+	SourceId findSource(const std::filesystem::path& path);
+	bool expand(SourceId id, std::string& text, std::vector<SourceId>& includes, int depth);
+	GLuint build(SourceId id, const std::string& defines);
+	GLuint compile(const std::string& text, const Source& source);
+	GLuint loadBinary(const std::filesystem::path& file);
+	void saveBinary(GLuint program, const std::filesystem::path& file);
+	void configure(GLuint program);
+
+public:
+	ShaderManager() = default;
+	ShaderManager(const ShaderManager&) = delete;
+	ShaderManager& operator=(const ShaderManager&) = delete;
+
+	// Needs a current context and loaded GlFunctions. An empty cacheDirectory disables
+	// the binary cache.
+	void init(const std::filesystem::path& cacheDirectory);
+
+	// Returns -1 if the file cannot be read.
+	SourceId addSource(const std::filesystem::path& path);
+
+	// Applied to every program after it is linked or loaded.
+	void bindSampler(const std::string& name, GLint unit);
+	void bindBlock(const std::string& name, GLuint binding);
+
+	// Returns the program for the variant, building it if needed; 0 if it failed to
+	// compile. A failed variant is not retried until its source changes.
+	GLuint get(SourceId source, const std::string& defines);
+
+	// Re-reads sources whose modification time changed. Returns true if any did, in which
+	// case callers should get() their programs again.
+	bool reloadChanged();
+
+	bool hasBinaryCache() const {
+		return useBinaryCache;
+	}
+
+	int getCompileCount() const {
+		return compileCount;
+	}
+
+	int getCacheHitCount() const {
+		return cacheHitCount;
+	}
+};
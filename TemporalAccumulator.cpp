@@ -0,0 +1,80 @@
+#include "TemporalAccumulator.h"
+#include <cmath>
+#include <iostream>
+
+bool TemporalAccumulator::create(int newWidth, int newHeight) {
+	width = newWidth;
+	height = newHeight;
+	samples = 0;
+	if (framebuffer) {
+		gl.deleteFramebuffers(1, &framebuffer);
+		glDeleteTextures(1, &texture);
+	}
+
+	// Made on unit 0 and unbound again straight away, so SFML's cached binding stays right
+	GLint bound = 0;
+	glGetIntegerv(GL_TEXTURE_BINDING_2D, &bound);
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GlEnum::RGBA32F, width, height, 0, GL_RGBA, GL_FLOAT, nullptr);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glBindTexture(GL_TEXTURE_2D, static_cast<GLuint>(bound));
+
+	gl.genFramebuffers(1, &framebuffer);
+	gl.bindFramebuffer(GlEnum::FRAMEBUFFER, framebuffer);
+	gl.framebufferTexture2D(GlEnum::FRAMEBUFFER, GlEnum::COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+	const bool complete = gl.checkFramebufferStatus(GlEnum::FRAMEBUFFER) == GlEnum::FRAMEBUFFER_COMPLETE;
+	gl.bindFramebuffer(GlEnum::FRAMEBUFFER, 0);
+
+	if (!complete) {
+		std::cerr << "Float render targets are not supported" << std::endl;
+	}
+	return complete;
+}
+
+// R2: the fractional parts of n / g and n / g^2 for the plastic number g, started at 0.5
+void TemporalAccumulator::nextOffset(float& x, float& y) const {
+	const double G = 1.32471795724474602596;
+	const double a1 = 1.0 / G;
+	const double a2 = 1.0 / (G * G);
+	x = static_cast<float>(std::fmod(0.5 + a1 * samples, 1.0) - 0.5);
+	y = static_cast<float>(std::fmod(0.5 + a2 * samples, 1.0) - 0.5);
+}
+
+// A fullscreen rectangle with identity matrices, as in IterationState::step
+void TemporalAccumulator::accumulate(GLuint program) {
+	GLint viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	gl.bindFramebuffer(GlEnum::FRAMEBUFFER, framebuffer);
+	glViewport(0, 0, width, height);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+	glMatrixMode(GL_PROJECTION);
+	glPushMatrix();
+	glLoadIdentity();
+	glMatrixMode(GL_MODELVIEW);
+	glPushMatrix();
+	glLoadIdentity();
+
+	gl.useProgram(program);
+	glRectf(-1.0f, -1.0f, 1.0f, 1.0f);
+	gl.useProgram(0);
+
+	glPopMatrix();
+	glMatrixMode(GL_PROJECTION);
+	glPopMatrix();
+	glMatrixMode(GL_MODELVIEW);
+
+	gl.bindFramebuffer(GlEnum::FRAMEBUFFER, 0);
+	glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+	++samples;
+}
+
+void TemporalAccumulator::present() const {
+	gl.bindFramebuffer(GlEnum::READ_FRAMEBUFFER, framebuffer);
+	gl.bindFramebuffer(GlEnum::DRAW_FRAMEBUFFER, 0);
+	gl.blitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+	gl.bindFramebuffer(GlEnum::FRAMEBUFFER, 0);
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "GlFunctions.h"
+
+// Temporal anti-aliasing for a still view. Every frame iterates the field once more with
+// the pixel centres moved by a sub-pixel offset, and the colour pass blends it into a
+// running mean: sample n goes in with weight 1 / (n + 1), which the colour pass writes as
+// its alpha. After MAX_SAMPLES frames the mean is a MAX_SAMPLES-sample supersampled image,
+// and the view sits idle again.
+//
+// The offsets follow the R2 sequence, whose points stay evenly spread over the pixel for
+// every prefix, so the image improves steadily instead of in passes. The first sample is
+// the pixel centre, the same as a frame without anti-aliasing.
+//
+// The mean is RGBA32F, since 8 bits cannot hold the small steps of a long mean. Like
+// IterationState it is a raw GL object; callers reset SFML's GL state after using it.
+class TemporalAccumulator {
+private:
+	GLuint framebuffer = 0;
+	GLuint texture = 0;
+	int width = 0;
+	int height = 0;
+	int samples = 0;
+
+public:
+	static constexpr int MAX_SAMPLES = 64;
+
+	bool create(int width, int height);
+
+	// Forgets every sample; the next one starts the mean over.
+	void reset() { samples = 0; }
+
+	int getSampleCount() const { return samples; }
+	bool isConverged() const { return samples >= MAX_SAMPLES; }
+
+	// Where the next sample lies relative to the pixel centre, in [-0.5, 0.5) pixels
+	void nextOffset(float& x, float& y) const;
+	// The alpha the colour pass has to write for the next sample
+	float nextWeight() const { return 1.0f / (samples + 1); }
+
+	// Draws the colour pass, program with its inputs bound and FrameParams up to date, over
+	// the whole target and blends it into the mean.
+	void accumulate(GLuint program);
+
+	// Copies the mean to the default framebuffer of the current context.
+	void present() const;
+};
@@ -0,0 +1,255 @@
+#include "ThreadPool.h"
+#include <algorithm>
+#include <iostream>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#elif defined(__linux__)
+#include <filesystem>
+#include <fstream>
+#include <pthread.h>
+#include <sched.h>
+#include <string>
+#endif
+
+namespace {
+	// A logical processor: its NUMA node, and where the OS numbers it (group is Windows only)
+	struct Processor {
+		int node;
+		int group;
+		int index;
+	};
+
+#if defined(_WIN32)
+	std::vector<Processor> detectProcessors() {
+		std::vector<Processor> processors;
+		DWORD length = 0;
+		GetLogicalProcessorInformationEx(RelationNumaNode, nullptr, &length);
+		std::vector<char> buffer(length);
+		if (length == 0 || !GetLogicalProcessorInformationEx(RelationNumaNode,
+				reinterpret_cast<SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX*>(buffer.data()), &length)) {
+			return processors;
+		}
+		for (DWORD offset = 0; offset < length;) {
+			const auto* info = reinterpret_cast<const SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX*>(buffer.data() + offset);
+			const GROUP_AFFINITY& affinity = info->NumaNode.GroupMask;
+			for (int bit = 0; bit < static_cast<int>(sizeof(KAFFINITY) * 8); ++bit) {
+				if (affinity.Mask & (static_cast<KAFFINITY>(1) << bit)) {
+					processors.push_back({ static_cast<int>(info->NumaNode.NodeNumber), affinity.Group, bit });
+				}
+			}
+			offset += info->Size;
+		}
+		return processors;
+	}
+
+	bool pin(const Processor& processor) {
+		GROUP_AFFINITY affinity = {};
+		affinity.Group = static_cast<WORD>(processor.group);
+		affinity.Mask = static_cast<KAFFINITY>(1) << processor.index;
+		return SetThreadGroupAffinity(GetCurrentThread(), &affinity, nullptr) != 0;
+	}
+#elif defined(__linux__)
+	// A sysfs cpulist such as "0-15,32-47"
+	std::vector<int> parseCpuList(const std::string& list) {
+		std::vector<int> cpus;
+		size_t position = 0;
+		while (position < list.size()) {
+			size_t end = list.find(',', position);
+			if (end == std::string::npos) {
+				end = list.size();
+			}
+			const std::string range = list.substr(position, end - position);
+			const size_t dash = range.find('-');
+			try {
+				const int first = std::stoi(range.substr(0, dash));
+				const int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+				for (int cpu = first; cpu <= last; ++cpu) {
+					cpus.push_back(cpu);
+				}
+			}
+			catch (const std::exception&) {
+			}
+			position = end + 1;
+		}
+		return cpus;
+	}
+
+	// Processors outside the process's affinity mask (taskset, cgroups) are left out
+	std::vector<Processor> detectProcessors() {
+		std::vector<Processor> processors;
+		cpu_set_t allowed;
+		CPU_ZERO(&allowed);
+		const bool haveMask = sched_getaffinity(0, sizeof(allowed), &allowed) == 0;
+
+		std::error_code error;
+		for (const auto& entry : std::filesystem::directory_iterator("/sys/devices/system/node", error)) {
+			const std::string name = entry.path().filename().string();
+			if (name.rfind("node", 0) != 0 || name.size() == 4 || name.find_first_not_of("0123456789", 4) != std::string::npos) {
+				continue;
+			}
+			std::ifstream file(entry.path() / "cpulist");
+			std::string list;
+			std::getline(file, list);
+			const int node = std::stoi(name.substr(4));
+			for (int cpu : parseCpuList(list)) {
+				if (!haveMask || (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed))) {
+					processors.push_back({ node, 0, cpu });
+				}
+			}
+		}
+		return processors;
+	}
+
+	bool pin(const Processor& processor) {
+		if (processor.index >= CPU_SETSIZE) {
+			return false;
+		}
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		CPU_SET(processor.index, &set);
+		return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+	}
+#else
+	std::vector<Processor> detectProcessors() { return {}; }
+	bool pin(const Processor&) { return false; }
+#endif
+}
+
+ThreadPool::ThreadPool(int workerLimit) {
+	std::vector<Processor> processors = detectProcessors();
+	const bool pinned = !processors.empty();
+	if (!pinned) {
+		const int count = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+		for (int i = 0; i < count; ++i) {
+			processors.push_back({ 0, 0, i });
+		}
+	}
+	// Workers numbered node by node, so a run of indices maps onto one node
+	std::stable_sort(processors.begin(), processors.end(), [](const Processor& a, const Processor& b) { return a.node < b.node; });
+	if (workerLimit > 0 && workerLimit < static_cast<int>(processors.size())) {
+		// Spread over the nodes rather than filling the first ones
+		std::vector<Processor> chosen;
+		for (int i = 0; i < workerLimit; ++i) {
+			chosen.push_back(processors[static_cast<size_t>(i) * processors.size() / workerLimit]);
+		}
+		processors = chosen;
+	}
+
+	// Nodes renumbered densely; the OS numbering may have gaps
+	const int workers = static_cast<int>(processors.size());
+	workerNodes.resize(workers);
+	nodeCount = 0;
+	for (int w = 0; w < workers; ++w) {
+		if (w > 0 && processors[w].node != processors[w - 1].node) {
+			++nodeCount;
+		}
+		workerNodes[w] = nodeCount;
+	}
+	++nodeCount;
+
+	// Each worker steals first from the next workers on its node, wrapping around, then from
+	// the following nodes in turn
+	stealOrder.resize(workers);
+	for (int w = 0; w < workers; ++w) {
+		for (int n = 0; n < nodeCount; ++n) {
+			const int node = (workerNodes[w] + n) % nodeCount;
+			const int first = static_cast<int>(std::find(workerNodes.begin(), workerNodes.end(), node) - workerNodes.begin());
+			const int last = static_cast<int>(std::upper_bound(workerNodes.begin(), workerNodes.end(), node) - workerNodes.begin());
+			const int start = node == workerNodes[w] ? w : first;
+			for (int i = 0; i < last - first; ++i) {
+				stealOrder[w].push_back(first + (start - first + i) % (last - first));
+			}
+		}
+	}
+
+	blocks = std::make_unique<Block[]>(workers);
+	threads.reserve(workers);
+	for (int w = 0; w < workers; ++w) {
+		const Processor processor = processors[w];
+		threads.emplace_back([this, w, processor, pinned] {
+			// Pinned before the worker touches any memory, so even its stack is node-local
+			if (pinned && !pin(processor)) {
+				std::cerr << "Could not pin render worker " << w << " to processor " << processor.index << std::endl;
+			}
+			workerLoop(w);
+		});
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_all();
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+}
+
+ThreadPool& ThreadPool::shared() {
+	static ThreadPool pool;
+	return pool;
+}
+
+void ThreadPool::parallelFor(int count, const std::function<void(int, int)>& task) {
+	if (count <= 0) {
+		return;
+	}
+	std::unique_lock<std::mutex> caller(callerMutex, std::try_to_lock);
+	if (!caller.owns_lock()) {
+		for (int index = 0; index < count; ++index) {
+			task(index, 0);
+		}
+		return;
+	}
+	const int workers = getWorkerCount();
+	std::unique_lock<std::mutex> lock(mutex);
+	for (int w = 0; w < workers; ++w) {
+		blocks[w].next.store(static_cast<int>(static_cast<long long>(count) * w / workers), std::memory_order_relaxed);
+		blocks[w].end = static_cast<int>(static_cast<long long>(count) * (w + 1) / workers);
+	}
+	job = &task;
+	busy = workers;
+	++generation;
+	wake.notify_all();
+	finished.wait(lock, [this] { return busy == 0; });
+	job = nullptr;
+}
+
+void ThreadPool::drain(int worker, const std::function<void(int, int)>& task) {
+	for (int victim : stealOrder[worker]) {
+		Block& block = blocks[victim];
+		for (int index = block.next.fetch_add(1, std::memory_order_relaxed); index < block.end; index = block.next.fetch_add(1, std::memory_order_relaxed)) {
+			task(index, worker);
+		}
+	}
+}
+
+void ThreadPool::workerLoop(int worker) {
+	int seen = 0;
+	for (;;) {
+		const std::function<void(int, int)>* task;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [&] { return stopping || generation != seen; });
+			if (stopping) {
+				return;
+			}
+			seen = generation;
+			task = job;
+		}
+		drain(worker, *task);
+		std::lock_guard<std::mutex> lock(mutex);
+		if (--busy == 0) {
+			finished.notify_one();
+		}
+	}
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
+
+// Allocates without value-initializing, so the pages of a fresh buffer stay untouched until
+// the thread that first writes them maps them, on its own NUMA node.
+template<class T>
+struct FirstTouchAllocator : std::allocator<T> {
+	template<class U>
+	struct rebind {
+		using other = FirstTouchAllocator<U>;
+	};
+
+	FirstTouchAllocator() = default;
+	template<class U>
+	FirstTouchAllocator(const FirstTouchAllocator<U>&) {}
+
+	template<class U>
+	void construct(U* p) {
+		::new (static_cast<void*>(p)) U;
+	}
+	template<class U, class... Args>
+	void construct(U* p, Args&&... args) {
+		::new (static_cast<void*>(p)) U(std::forward<Args>(args)...);
+	}
+};
+
+template<class T>
+using FirstTouchVector = std::vector<T, FirstTouchAllocator<T>>;
+
+// Worker threads for the CPU engine, one per logical processor and pinned to it, numbered
+// node by node. parallelFor hands every worker one contiguous block of the indices, so the
+// same index always starts on the same worker and a buffer first touched through one
+// parallelFor stays local to the workers that use it through the next. A worker that runs
+// out takes indices from the other blocks, trying the workers of its own node before
+// reaching across to another one.
+//
+// The caller only waits. One caller at a time has the workers; a loop started while they
+// are busy with another caller's runs on its own caller's thread instead, as worker 0, so
+// the UI can colour a preview while a full-resolution render holds the pool. Where the
+// topology cannot be read the pool still works, as one node of unpinned workers.
+class ThreadPool {
+private:
+	// The next unclaimed index of a worker's block; owner and thieves claim alike
+	struct alignas(64) Block {
+		std::atomic<int> next{ 0 };
+		int end = 0;
+	};
+
+	std::vector<std::thread> threads;
+	std::vector<int> workerNodes;
+	std::vector<std::vector<int>> stealOrder;	// per worker: itself, its node, then the rest
+	std::unique_ptr<Block[]> blocks;
+	int nodeCount = 1;
+
+	std::mutex callerMutex;	// held by the caller the workers are running a loop for
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable finished;
+	const std::function<void(int, int)>* job = nullptr;
+	int generation = 0;
+	int busy = 0;
+	bool stopping = false;
+
+	void workerLoop(int worker);
+	void drain(int worker, const std::function<void(int, int)>& task);
+
+public:
+	// workerLimit 0 takes every processor the process may run on
+	explicit ThreadPool(int workerLimit = 0);
+	~ThreadPool();
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	// The pool the renderers share
+	static ThreadPool& shared();
+
+	// Runs task(index, worker) for every index in [0, count) and returns once all are done.
+	// worker is in [0, getWorkerCount()).
+	void parallelFor(int count, const std::function<void(int index, int worker)>& task);
+
+	int getWorkerCount() const { return static_cast<int>(threads.size()); }
+	int getNodeCount() const { return nodeCount; }
+	int getWorkerNode(int worker) const { return workerNodes[worker]; }
+};
@@ -0,0 +1,97 @@
+#version 330 core
+
+// Second pass: colours the iteration field written by mandelbrot.frag. It is cheap enough
+// to run every frame, so palette edits and offset animation never re-iterate.
+// EQUALIZE selects histogram colouring: by rank in the frame instead of value / maxIterations.
+// FIELD_STATE reads the float state of a time-sliced render instead of the packed field,
+// FIELD_VALUES the plain float field written by mandelbrot.comp.
+// A field iterated at reduced resolution fills the bottom-left corner of its texture and is
+// stretched over the screen here.
+uniform sampler2D field;    // escape values packed by mandelbrot.frag
+uniform sampler2D iterationState;   // IterationState, for FIELD_STATE
+uniform sampler2D fieldValues;      // ComputeEngine, for FIELD_VALUES
+uniform sampler2D palette;  // gradient table, linear filtering and repeat wrapping
+uniform sampler2D cdf;      // histogram CDF, packed like the field, CDF_WIDTH entries per row
+
+// Per-frame parameters, shared with formula.glsl and mirrored by FrameParams in
+// FrameUniforms.h. Keep all three in the same order.
+layout(std140) uniform FrameParams {
+    vec4 viewport;          // xMin, xMax, yMin, yMax
+    vec4 viewportLow;
+    vec2 juliaC;
+    vec2 resolution;        // width, height in pixels of the iterated field
+    int maxIterations;
+    float paletteOffset;
+    int cdfBins;
+    int iterationBudget;
+    vec2 fieldScale;        // field pixels per screen pixel
+    vec2 sampleOffset;
+    float sampleWeight;     // of this frame in TemporalAccumulator's running mean
+};
+
+const int CDF_WIDTH = 1024;
+
+out vec4 color;
+
+float unpackFloat(vec4 texel) {
+    uvec4 bytes = uvec4(round(texel * 255.0));
+    return uintBitsToFloat((bytes.r << 24u) | (bytes.g << 16u) | (bytes.b << 8u) | bytes.a);
+}
+
+float cdfAt(int index) {
+    return unpackFloat(texelFetch(cdf, ivec2(index % CDF_WIDTH, index / CDF_WIDTH), 0));
+}
+
+// Position of a value in the cumulative distribution, interpolated inside its bin.
+float equalized(float value) {
+    int bin = clamp(int(value), 0, cdfBins - 1);
+    float t = clamp(value - float(bin), 0.0, 1.0);
+    return mix(cdfAt(bin), cdfAt(bin + 1), t);
+}
+
+float fieldValue(ivec2 texel) {
+#ifdef FIELD_STATE
+    // Unfinished pixels stay black until their slice finishes them
+    vec4 state = texelFetch(iterationState, texel, 0);
+    return state.a < 0.0 ? state.r : -1.0;
+#elif defined(FIELD_VALUES)
+    return texelFetch(fieldValues, texel, 0).r;
+#else
+    return unpackFloat(texelFetch(field, texel, 0));
+#endif
+}
+
+// The escape values are interpolated between the four nearest field pixels, which keeps
+// the bands smooth; next to the interior there is nothing to interpolate with, so those
+// pixels take the nearest value.
+float upscaledValue() {
+    vec2 position = gl_FragCoord.xy * fieldScale - 0.5;
+    ivec2 last = ivec2(resolution) - 1;
+    ivec2 base = clamp(ivec2(floor(position)), ivec2(0), max(last - 1, ivec2(0)));
+    vec2 t = clamp(position - vec2(base), 0.0, 1.0);
+    float a = fieldValue(base);
+    float b = fieldValue(min(base + ivec2(1, 0), last));
+    float c = fieldValue(min(base + ivec2(0, 1), last));
+    float d = fieldValue(min(base + ivec2(1, 1), last));
+    if (min(min(a, b), min(c, d)) < 0.0) {
+        return fieldValue(clamp(ivec2(position + 0.5), ivec2(0), last));
+    }
+    return mix(mix(a, b, t.x), mix(c, d, t.x), t.y);
+}
+
+void main() {
+    // Both passes address the field by gl_FragCoord, so no texture coordinates are needed.
+    float value = fieldScale.x < 1.0 || fieldScale.y < 1.0 ? upscaledValue() : fieldValue(ivec2(gl_FragCoord.xy));
+    if (value < 0.0) {
+        color = vec4(0.0, 0.0, 0.0, sampleWeight);
+        return;
+    }
+
+#ifdef EQUALIZE
+    float norm = equalized(value);
+#else
+    float norm = value / float(maxIterations);
+#endif
+    norm = fract(norm + paletteOffset);
+    color = vec4(texture(palette, vec2(norm, 0.5)).rgb, sampleWeight);
+}
@@ -0,0 +1,211 @@
+// Formulas and the escape loop shared by the iteration shaders, mandelbrot.frag and
+// mandelbrot.comp, which pull it in with #include (expanded by ShaderManager).
+//
+// Each variant is specialized at compile time. ShaderManager inserts these after the
+// #version line:
+//   FORMULA_POWER n        z^n + c (Multibrot), default 2
+//   FORMULA_BURNING_SHIP   (|Re z| + i|Im z|)^2 + c
+//   FORMULA_TRICORN        conj(z)^2 + c
+//   FORMULA_JULIA          z^2 + juliaC, starting from z = pixel
+//   FORMULA_CUSTOM         user formula, CUSTOM_FORMULA_BODY is the body of customStep
+//   PRECISION_DOUBLE       iterate in double precision (not with FORMULA_CUSTOM)
+//   ITERATION_BUCKET n     power of two at or above maxIterations, the loop's fixed bound
+//   CHECKPOINT_ITERATIONS n  test the bailout once per n unrolled steps, see iterate()
+#ifndef FORMULA_POWER
+#define FORMULA_POWER 2
+#endif
+#ifndef ITERATION_BUCKET
+#define ITERATION_BUCKET 131072
+#endif
+
+#ifdef PRECISION_DOUBLE
+#extension GL_ARB_gpu_shader_fp64 : require
+#define real double
+#define complex dvec2
+#else
+#define real float
+#define complex vec2
+#endif
+
+// Per-frame parameters, shared with colorize.frag and mirrored by FrameParams in
+// FrameUniforms.h. Keep all three in the same order.
+layout(std140) uniform FrameParams {
+    vec4 viewport;          // xMin, xMax, yMin, yMax
+    vec4 viewportLow;       // rounding error of viewport, added back in double variants
+    vec2 juliaC;
+    vec2 resolution;        // width, height in pixels of the iterated field
+    int maxIterations;
+    float paletteOffset;
+    int cdfBins;
+    int iterationBudget;    // iterations per pixel and slice, TIME_SLICED only
+    vec2 fieldScale;        // field pixels per screen pixel, below 1 in reduced-resolution frames
+    vec2 sampleOffset;      // of the iterated points from the pixel centres, for anti-aliasing
+    float sampleWeight;     // alpha of the colour pass
+};
+
+// Function to map the current pixel to a point in the Mandelbrot set
+complex mapToMandelbrot(float x, float y) {
+#ifdef PRECISION_DOUBLE
+    dvec4 bounds = dvec4(viewport) + dvec4(viewportLow);
+#else
+    vec4 bounds = viewport;
+#endif
+    real xMapped = mix(bounds.x, bounds.y, real(x / resolution.x));
+    real yMapped = mix(bounds.z, bounds.w, real(y / resolution.y));
+    return complex(xMapped, yMapped);
+}
+
+complex complexPower(complex z) {
+    complex result = z;
+    // Constant trip count, so the compiler unrolls it completely
+    for (int i = 1; i < FORMULA_POWER; ++i) {
+        result = complex(result.x * z.x - result.y * z.y, result.x * z.y + result.y * z.x);
+    }
+    return result;
+}
+
+#ifdef FORMULA_CUSTOM
+// Complex helpers used by the generated formula code
+vec2 cmul(vec2 a, vec2 b) {
+    return vec2(a.x * b.x - a.y * b.y, a.x * b.y + a.y * b.x);
+}
+
+vec2 cdiv(vec2 a, vec2 b) {
+    return vec2(a.x * b.x + a.y * b.y, a.y * b.x - a.x * b.y) / dot(b, b);
+}
+
+vec2 cpowi(vec2 z, int n) {
+    vec2 result = vec2(1.0, 0.0);
+    for (int i = 0; i < n; ++i) {
+        result = cmul(result, z);
+    }
+    return result;
+}
+
+vec2 cexp(vec2 z) {
+    return exp(z.x) * vec2(cos(z.y), sin(z.y));
+}
+
+vec2 clog(vec2 z) {
+    return vec2(0.5 * log(dot(z, z)), atan(z.y, z.x));
+}
+
+vec2 cpow(vec2 a, vec2 b) {
+    return dot(a, a) == 0.0 ? vec2(0.0) : cexp(cmul(b, clog(a)));
+}
+
+vec2 csqrt(vec2 z) {
+    float r = length(z);
+    return vec2(sqrt(0.5 * (r + z.x)), (z.y < 0.0 ? -1.0 : 1.0) * sqrt(0.5 * (r - z.x)));
+}
+
+vec2 csin(vec2 z) {
+    return vec2(sin(z.x) * cosh(z.y), cos(z.x) * sinh(z.y));
+}
+
+vec2 ccos(vec2 z) {
+    return vec2(cos(z.x) * cosh(z.y), -sin(z.x) * sinh(z.y));
+}
+
+vec2 csinh(vec2 z) {
+    return vec2(sinh(z.x) * cos(z.y), cosh(z.x) * sin(z.y));
+}
+
+vec2 ccosh(vec2 z) {
+    return vec2(cosh(z.x) * cos(z.y), sinh(z.x) * sin(z.y));
+}
+
+#ifndef CUSTOM_FORMULA_BODY
+#define CUSTOM_FORMULA_BODY return cmul(z, z) + c;
+#endif
+
+vec2 customStep(vec2 z, vec2 c) {
+    CUSTOM_FORMULA_BODY
+}
+#endif
+
+complex formulaStep(complex z, complex c) {
+#if defined(FORMULA_CUSTOM)
+    return customStep(z, c);
+#else
+#if defined(FORMULA_BURNING_SHIP)
+    z = abs(z);
+#elif defined(FORMULA_TRICORN)
+    z.y = -z.y;
+#endif
+#if FORMULA_POWER == 2
+    return complex(z.x * z.x - z.y * z.y, 2.0 * z.x * z.y) + c;
+#else
+    return complexPower(z) + c;
+#endif
+#endif
+}
+
+// The starting z and c for a pixel centre, in gl_FragCoord convention
+void startOrbit(vec2 position, out complex z, out complex c) {
+    complex pixel = mapToMandelbrot(position.x, position.y);
+#ifdef FORMULA_JULIA
+    z = pixel;
+    c = complex(juliaC);
+#else
+    z = complex(0.0, 0.0);
+    c = pixel;
+#endif
+}
+
+// Escape-time iteration loop, from `iterations` up to `stop`. The constant bound gives
+// the compiler a known trip count; the real limit is the argument. Returns true if z
+// escaped, leaving `iterations` at the last step that stayed inside.
+//
+// With CHECKPOINT_ITERATIONS the orbit first advances in unrolled blocks with no branch
+// inside, keeping only an or of the bailout test and the smallest |z|, both taken in float
+// exactly as the step-by-step loop takes them. A block that went out is undone back to the
+// z saved before it, and the step-by-step loop below, which also takes the last partial
+// block, finds the exact iteration.
+bool iterate(inout complex z, complex c, inout int iterations, inout float minDistance, int stop) {
+#ifdef CHECKPOINT_ITERATIONS
+    for (int block = 0; block < ITERATION_BUCKET / CHECKPOINT_ITERATIONS; ++block) {
+        if (iterations + CHECKPOINT_ITERATIONS > stop) {
+            break;
+        }
+        complex saved = z;
+        float nearest = minDistance;
+        bool outside = false;
+        for (int k = 0; k < CHECKPOINT_ITERATIONS; ++k) {
+            z = formulaStep(z, c);
+            float dist = float(length(z));
+            // Overflow past the bailout gives infinity or NaN, which must count as out too
+            outside = outside || !(dist <= 2.0);
+            nearest = min(nearest, dist);
+        }
+        if (outside) {
+            z = saved;
+            break;
+        }
+        minDistance = nearest;
+        iterations += CHECKPOINT_ITERATIONS;
+    }
+#endif
+    for (int i = 0; i < ITERATION_BUCKET; ++i) {
+        if (iterations == stop) {
+            break;
+        }
+        z = formulaStep(z, c);
+
+        float dist = float(length(z));
+        if (dist > 2.0) {
+            return true;
+        }
+
+        // Update the minimum distance for orbit trapping
+        minDistance = min(minDistance, dist);
+
+        iterations++;
+    }
+    return false;
+}
+
+// Clamped because negative values mark the interior
+float escapeValue(int iterations, float minDistance) {
+    return max(float(iterations) + 1.0 - log(log(minDistance + 2.0)), 0.0);
+}
@@ -0,0 +1,41 @@
+// Escape-value histogram counted on the GPU, pulled into the compute shaders with #include
+// after formula.glsl and the workgroup size. The bins are IterationHistogram's: a value
+// v >= 0 counts in bin min(int(v), maxIterations + 1), the interior is not counted. Most
+// values of a frame fall in the low bins, which each workgroup counts in shared memory and
+// adds to the buffer once at the end; higher values go to the buffer directly.
+//
+// The caller clears the shared bins with clearSharedBins() and a barrier before counting,
+// and calls mergeSharedBins() after a barrier once the group has counted everything.
+#define SHARED_BINS 1024
+
+layout(std430, binding = 3) buffer HistogramBins {
+    uint bins[];
+};
+
+shared uint sharedBins[SHARED_BINS];
+
+void clearSharedBins() {
+    for (uint i = gl_LocalInvocationIndex; i < uint(SHARED_BINS); i += gl_WorkGroupSize.x * gl_WorkGroupSize.y) {
+        sharedBins[i] = 0u;
+    }
+}
+
+void countValue(float value) {
+    if (value >= 0.0) {
+        int bin = min(int(value), maxIterations + 1);
+        if (bin < SHARED_BINS) {
+            atomicAdd(sharedBins[bin], 1u);
+        } else {
+            atomicAdd(bins[bin], 1u);
+        }
+    }
+}
+
+void mergeSharedBins() {
+    uint used = uint(min(SHARED_BINS, maxIterations + 2));
+    for (uint i = gl_LocalInvocationIndex; i < used; i += gl_WorkGroupSize.x * gl_WorkGroupSize.y) {
+        if (sharedBins[i] != 0u) {
+            atomicAdd(bins[i], sharedBins[i]);
+        }
+    }
+}
@@ -10,6 +10,7 @@
 #include <SFML/Graphics/Texture.hpp>
 #include <SFML/OpenGL.hpp>
 #include <SFML/Window/Clipboard.hpp>
+#include <SFML/Window/Context.hpp>
 #include <SFML/Window/Cursor.hpp>
 #include <SFML/Window/Event.hpp>
 #include <SFML/Window/Touch.hpp>
@@ -19,6 +20,7 @@
 #include <cmath> // abs
 #include <cstddef> // offsetof, nullptr, size_t
 #include <cstdint> // uint8_t
+#include <cstdlib> // atoi
 #include <cstring> // memcpy
 
 #include <algorithm>
@@ -125,7 +127,8 @@ ImVec2 getDownRightAbsolute(const sf::FloatRect& rect);
 ImTextureID convertGLTextureHandleToImTextureID(GLuint glTextureHandle);
 GLuint convertImTextureIDToGLTextureHandle(ImTextureID textureID);
 
-void RenderDrawLists(ImDrawData* draw_data); // rendering callback function prototype
+void RenderDrawLists(ImDrawData* draw_data, bool upload = true); // rendering callback function prototype
+void RenderDrawListsLegacy(ImDrawData* draw_data, int fb_width, int fb_height);
 
 // Default mapping is XInput gamepad mapping
 void initDefaultJoystickMapping();
@@ -168,6 +171,85 @@ struct TriggerInfo {
     float threshold{0};
 };
 
+// GL 3 core-profile renderer. The headers SFML pulls in only cover OpenGL 1.x on some
+// platforms, so the few enums and entry points it needs are declared here and loaded
+// through sf::Context::getFunction.
+#ifndef APIENTRY
+#define APIENTRY
+#endif
+
+constexpr GLenum GL3_ARRAY_BUFFER = 0x8892;
+constexpr GLenum GL3_ELEMENT_ARRAY_BUFFER = 0x8893;
+constexpr GLenum GL3_STREAM_DRAW = 0x88E0;
+constexpr GLenum GL3_FRAGMENT_SHADER = 0x8B30;
+constexpr GLenum GL3_VERTEX_SHADER = 0x8B31;
+constexpr GLenum GL3_COMPILE_STATUS = 0x8B81;
+constexpr GLenum GL3_LINK_STATUS = 0x8B82;
+constexpr GLenum GL3_FUNC_ADD = 0x8006;
+constexpr GLenum GL3_TEXTURE0 = 0x84C0;
+
+struct Gl3Functions {
+    GLuint(APIENTRY* createShader)(GLenum type);
+    void(APIENTRY* shaderSource)(GLuint shader, GLsizei count, const char* const* source,
+                                 const GLint* length);
+    void(APIENTRY* compileShader)(GLuint shader);
+    void(APIENTRY* getShaderiv)(GLuint shader, GLenum name, GLint* value);
+    void(APIENTRY* deleteShader)(GLuint shader);
+    GLuint(APIENTRY* createProgram)();
+    void(APIENTRY* attachShader)(GLuint program, GLuint shader);
+    void(APIENTRY* bindAttribLocation)(GLuint program, GLuint index, const char* name);
+    void(APIENTRY* linkProgram)(GLuint program);
+    void(APIENTRY* getProgramiv)(GLuint program, GLenum name, GLint* value);
+    void(APIENTRY* deleteProgram)(GLuint program);
+    void(APIENTRY* useProgram)(GLuint program);
+    GLint(APIENTRY* getUniformLocation)(GLuint program, const char* name);
+    void(APIENTRY* uniform1i)(GLint location, GLint value);
+    void(APIENTRY* uniformMatrix4fv)(GLint location, GLsizei count, GLboolean transpose,
+                                     const GLfloat* value);
+    void(APIENTRY* genVertexArrays)(GLsizei count, GLuint* arrays);
+    void(APIENTRY* bindVertexArray)(GLuint array);
+    void(APIENTRY* deleteVertexArrays)(GLsizei count, const GLuint* arrays);
+    void(APIENTRY* genBuffers)(GLsizei count, GLuint* buffers);
+    void(APIENTRY* bindBuffer)(GLenum target, GLuint buffer);
+    void(APIENTRY* bufferData)(GLenum target, std::ptrdiff_t size, const void* data, GLenum usage);
+    void(APIENTRY* bufferSubData)(GLenum target, std::ptrdiff_t offset, std::ptrdiff_t size,
+                                  const void* data);
+    void(APIENTRY* deleteBuffers)(GLsizei count, const GLuint* buffers);
+    void(APIENTRY* enableVertexAttribArray)(GLuint index);
+    void(APIENTRY* vertexAttribPointer)(GLuint index, GLint size, GLenum type,
+                                        GLboolean normalized, GLsizei stride, const void* pointer);
+    void(APIENTRY* activeTexture)(GLenum texture);
+    void(APIENTRY* blendEquation)(GLenum mode);
+    void(APIENTRY* blendFuncSeparate)(GLenum srcRgb, GLenum dstRgb, GLenum srcAlpha,
+                                      GLenum dstAlpha);
+};
+Gl3Functions s_gl3;
+bool s_gl3Loaded = false;
+
+// Per-window renderer objects. Vertex array objects are not shared between contexts, so
+// each window gets its own.
+struct CoreRenderer {
+    bool initialized{false}; // initialization was attempted
+    bool available{false}; // initialization succeeded, otherwise the legacy path is used
+    GLuint program{0};
+    GLuint vertexArray{0};
+    GLuint vertexBuffer{0};
+    GLuint indexBuffer{0};
+    GLint projectionLocation{-1};
+    std::size_t vertexCapacity{0}; // bytes
+    std::size_t indexCapacity{0};
+    bool hasGeometry{false}; // the buffers hold the last rendered frame
+};
+
+// Frames rendered after the last input before the UI is considered still. Some ImGui state
+// (hover highlights, window focus, layout after a resize) takes a couple of frames to settle.
+constexpr int SETTLE_FRAMES = 3;
+
+bool initCoreRenderer(CoreRenderer& renderer);
+void destroyCoreRenderer(CoreRenderer& renderer, const sf::Window& window);
+void RenderDrawListsCore(CoreRenderer& renderer, ImDrawData* draw_data, int fb_width,
+                         int fb_height, bool upload);
+
 struct WindowContext {
     const sf::Window* window;
     ImGuiContext* imContext{ImGui::CreateContext()};
@@ -194,6 +276,12 @@ struct WindowContext {
     sf::Cursor mouseCursors[ImGuiMouseCursor_COUNT];
     bool mouseCursorLoaded[ImGuiMouseCursor_COUNT] = {ImGuiKey_None};
 
+    CoreRenderer coreRenderer;
+
+    bool inputPending{true}; // an event arrived since the last Update
+    int settleFrames{0};
+    bool frameBegun{false}; // Update ran since the last Render
+
 #ifdef ANDROID
 #ifdef USE_JNI
     bool wantTextInput{false};
@@ -201,7 +289,10 @@ struct WindowContext {
 #endif
 
     WindowContext(const sf::Window* w) : window(w), windowHasFocus(window->hasFocus()) {}
-    ~WindowContext() { ImGui::DestroyContext(imContext); }
+    ~WindowContext() {
+        destroyCoreRenderer(coreRenderer, *window);
+        ImGui::DestroyContext(imContext);
+    }
 
     WindowContext(const WindowContext&) = delete; // non construction-copyable
     WindowContext& operator=(const WindowContext&) = delete; // non copyable
@@ -292,6 +383,7 @@ void ProcessEvent(const sf::Window& window, const sf::Event& event) {
 void ProcessEvent(const sf::Event& event) {
     assert(s_currWindowCtx && "No current window is set - forgot to call ImGui::SFML::Init?");
     ImGuiIO& io = ImGui::GetIO();
+    s_currWindowCtx->inputPending = true;
 
     if (s_currWindowCtx->windowHasFocus) {
         switch (event.type) {
@@ -464,9 +556,25 @@ void Update(const sf::Vector2i& mousePos, const sf::Vector2f& displaySize, sf::T
         updateJoystickAxisState(io);
     }
 
+    if (s_currWindowCtx->inputPending) {
+        s_currWindowCtx->settleFrames = SETTLE_FRAMES;
+    } else if (s_currWindowCtx->settleFrames > 0) {
+        --s_currWindowCtx->settleFrames;
+    }
+    s_currWindowCtx->inputPending = false;
+    s_currWindowCtx->frameBegun = true;
+
     ImGui::NewFrame();
 }
 
+bool WantsFrame() {
+    assert(s_currWindowCtx && "No current window is set - forgot to call ImGui::SFML::Init?");
+    if (s_currWindowCtx->inputPending || s_currWindowCtx->settleFrames > 0) return true;
+
+    // A blinking text cursor or a widget held with the mouse keeps changing without events
+    return ImGui::GetIO().WantTextInput || ImGui::IsAnyItemActive();
+}
+
 void Render(sf::RenderWindow& window) {
     SetCurrentWindow(window);
     Render(static_cast<sf::RenderTarget&>(window));
@@ -474,15 +582,36 @@ void Render(sf::RenderWindow& window) {
 
 void Render(sf::RenderTarget& target) {
     target.resetGLStates();
-    target.pushGLStates();
-    ImGui::Render();
-    RenderDrawLists(ImGui::GetDrawData());
-    target.popGLStates();
+
+    // The core renderer sets every piece of state it uses and leaves nothing bound, so it
+    // only has to tell SFML afterwards; the legacy path needs the full attribute stack.
+    CoreRenderer& renderer = s_currWindowCtx->coreRenderer;
+    if (!renderer.initialized) initCoreRenderer(renderer);
+
+    // Without a new frame the previous draw data is still valid and, on the core path, still
+    // in the GPU buffers, so it is drawn again as is.
+    const bool newFrame = s_currWindowCtx->frameBegun;
+    s_currWindowCtx->frameBegun = false;
+
+    if (!renderer.available) target.pushGLStates();
+    if (newFrame) ImGui::Render();
+    if (ImDrawData* draw_data = ImGui::GetDrawData()) RenderDrawLists(draw_data, newFrame);
+    if (renderer.available) {
+        target.resetGLStates();
+    } else {
+        target.popGLStates();
+    }
 }
 
 void Render() {
-    ImGui::Render();
-    RenderDrawLists(ImGui::GetDrawData());
+    CoreRenderer& renderer = s_currWindowCtx->coreRenderer;
+    if (!renderer.initialized) initCoreRenderer(renderer);
+
+    const bool newFrame = s_currWindowCtx->frameBegun;
+    s_currWindowCtx->frameBegun = false;
+
+    if (newFrame) ImGui::Render();
+    if (ImDrawData* draw_data = ImGui::GetDrawData()) RenderDrawLists(draw_data, newFrame);
 }
 
 void Shutdown(const sf::Window& window) {
@@ -883,7 +1012,7 @@ void SetupRenderState(ImDrawData* draw_data, int fb_width, int fb_height) {
 }
 
 // Rendering callback
-void RenderDrawLists(ImDrawData* draw_data) {
+void RenderDrawLists(ImDrawData* draw_data, bool upload) {
     ImGui::GetDrawData();
     if (draw_data->CmdListsCount == 0) {
         return;
@@ -897,9 +1026,19 @@ void RenderDrawLists(ImDrawData* draw_data) {
     const int fb_width = (int)(draw_data->DisplaySize.x * draw_data->FramebufferScale.x);
     const int fb_height = (int)(draw_data->DisplaySize.y * draw_data->FramebufferScale.y);
     if (fb_width == 0 || fb_height == 0) return;
-    draw_data->ScaleClipRects(io.DisplayFramebufferScale);
+    // Clip rectangles are scaled in place, so a replayed frame must not scale them again
+    if (upload) draw_data->ScaleClipRects(io.DisplayFramebufferScale);
 
-    // Backup GL state
+    if (s_currWindowCtx && s_currWindowCtx->coreRenderer.available) {
+        RenderDrawListsCore(s_currWindowCtx->coreRenderer, draw_data, fb_width, fb_height,
+                            upload);
+    } else {
+        RenderDrawListsLegacy(draw_data, fb_width, fb_height);
+    }
+}
+
+// Fixed-function fallback for contexts older than GL 3.0
+void RenderDrawListsLegacy(ImDrawData* draw_data, int fb_width, int fb_height) {
     // Backup GL state
     GLint last_texture = 0;
     glGetIntegerv(GL_TEXTURE_BINDING_2D, &last_texture);
@@ -1006,6 +1145,297 @@ void RenderDrawLists(ImDrawData* draw_data) {
 #endif
 }
 
+template<typename F>
+bool loadGl3Function(F& function, const char* name) {
+    function = reinterpret_cast<F>(sf::Context::getFunction(name));
+    return function != nullptr;
+}
+
+bool loadGl3Functions() {
+    bool ok = true;
+    ok &= loadGl3Function(s_gl3.createShader, "glCreateShader");
+    ok &= loadGl3Function(s_gl3.shaderSource, "glShaderSource");
+    ok &= loadGl3Function(s_gl3.compileShader, "glCompileShader");
+    ok &= loadGl3Function(s_gl3.getShaderiv, "glGetShaderiv");
+    ok &= loadGl3Function(s_gl3.deleteShader, "glDeleteShader");
+    ok &= loadGl3Function(s_gl3.createProgram, "glCreateProgram");
+    ok &= loadGl3Function(s_gl3.attachShader, "glAttachShader");
+    ok &= loadGl3Function(s_gl3.bindAttribLocation, "glBindAttribLocation");
+    ok &= loadGl3Function(s_gl3.linkProgram, "glLinkProgram");
+    ok &= loadGl3Function(s_gl3.getProgramiv, "glGetProgramiv");
+    ok &= loadGl3Function(s_gl3.deleteProgram, "glDeleteProgram");
+    ok &= loadGl3Function(s_gl3.useProgram, "glUseProgram");
+    ok &= loadGl3Function(s_gl3.getUniformLocation, "glGetUniformLocation");
+    ok &= loadGl3Function(s_gl3.uniform1i, "glUniform1i");
+    ok &= loadGl3Function(s_gl3.uniformMatrix4fv, "glUniformMatrix4fv");
+    ok &= loadGl3Function(s_gl3.genVertexArrays, "glGenVertexArrays");
+    ok &= loadGl3Function(s_gl3.bindVertexArray, "glBindVertexArray");
+    ok &= loadGl3Function(s_gl3.deleteVertexArrays, "glDeleteVertexArrays");
+    ok &= loadGl3Function(s_gl3.genBuffers, "glGenBuffers");
+    ok &= loadGl3Function(s_gl3.bindBuffer, "glBindBuffer");
+    ok &= loadGl3Function(s_gl3.bufferData, "glBufferData");
+    ok &= loadGl3Function(s_gl3.bufferSubData, "glBufferSubData");
+    ok &= loadGl3Function(s_gl3.deleteBuffers, "glDeleteBuffers");
+    ok &= loadGl3Function(s_gl3.enableVertexAttribArray, "glEnableVertexAttribArray");
+    ok &= loadGl3Function(s_gl3.vertexAttribPointer, "glVertexAttribPointer");
+    ok &= loadGl3Function(s_gl3.activeTexture, "glActiveTexture");
+    ok &= loadGl3Function(s_gl3.blendEquation, "glBlendEquation");
+    ok &= loadGl3Function(s_gl3.blendFuncSeparate, "glBlendFuncSeparate");
+    return ok;
+}
+
+GLuint compileGl3Shader(GLenum type, const char* source) {
+    const GLuint shader = s_gl3.createShader(type);
+    s_gl3.shaderSource(shader, 1, &source, nullptr);
+    s_gl3.compileShader(shader);
+    GLint status = 0;
+    s_gl3.getShaderiv(shader, GL3_COMPILE_STATUS, &status);
+    if (!status) {
+        s_gl3.deleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+// Attribute slots, bound before linking so no location has to be queried
+constexpr GLuint ATTRIB_POSITION = 0;
+constexpr GLuint ATTRIB_UV = 1;
+constexpr GLuint ATTRIB_COLOR = 2;
+
+bool initCoreRenderer(CoreRenderer& renderer) {
+    renderer.initialized = true;
+
+    // A one-off query; "OpenGL ES ..." and 1.x/2.x contexts stay on the legacy path.
+    const char* version = reinterpret_cast<const char*>(glGetString(GL_VERSION));
+    if (!version || std::atoi(version) < 3) return false;
+    if (!s_gl3Loaded) {
+        if (!loadGl3Functions()) return false;
+        s_gl3Loaded = true;
+    }
+
+    // GLSL 1.30 is accepted by GL 3.0 compatibility contexts, which is what SFML creates
+    const char* vertexSource = "#version 130\n"
+                               "uniform mat4 projection;\n"
+                               "in vec2 position;\n"
+                               "in vec2 uv;\n"
+                               "in vec4 color;\n"
+                               "out vec2 fragUv;\n"
+                               "out vec4 fragColor;\n"
+                               "void main() {\n"
+                               "    fragUv = uv;\n"
+                               "    fragColor = color;\n"
+                               "    gl_Position = projection * vec4(position, 0.0, 1.0);\n"
+                               "}\n";
+    const char* fragmentSource = "#version 130\n"
+                                 "uniform sampler2D atlas;\n"
+                                 "in vec2 fragUv;\n"
+                                 "in vec4 fragColor;\n"
+                                 "out vec4 outColor;\n"
+                                 "void main() {\n"
+                                 "    outColor = fragColor * texture(atlas, fragUv);\n"
+                                 "}\n";
+
+    const GLuint vertexShader = compileGl3Shader(GL3_VERTEX_SHADER, vertexSource);
+    const GLuint fragmentShader = compileGl3Shader(GL3_FRAGMENT_SHADER, fragmentSource);
+    if (!vertexShader || !fragmentShader) {
+        if (vertexShader) s_gl3.deleteShader(vertexShader);
+        if (fragmentShader) s_gl3.deleteShader(fragmentShader);
+        return false;
+    }
+
+    const GLuint program = s_gl3.createProgram();
+    s_gl3.attachShader(program, vertexShader);
+    s_gl3.attachShader(program, fragmentShader);
+    s_gl3.bindAttribLocation(program, ATTRIB_POSITION, "position");
+    s_gl3.bindAttribLocation(program, ATTRIB_UV, "uv");
+    s_gl3.bindAttribLocation(program, ATTRIB_COLOR, "color");
+    s_gl3.linkProgram(program);
+    s_gl3.deleteShader(vertexShader);
+    s_gl3.deleteShader(fragmentShader);
+
+    GLint linked = 0;
+    s_gl3.getProgramiv(program, GL3_LINK_STATUS, &linked);
+    if (!linked) {
+        s_gl3.deleteProgram(program);
+        return false;
+    }
+
+    renderer.program = program;
+    renderer.projectionLocation = s_gl3.getUniformLocation(program, "projection");
+    s_gl3.useProgram(program);
+    s_gl3.uniform1i(s_gl3.getUniformLocation(program, "atlas"), 0);
+    s_gl3.useProgram(0);
+
+    s_gl3.genVertexArrays(1, &renderer.vertexArray);
+    s_gl3.genBuffers(1, &renderer.vertexBuffer);
+    s_gl3.genBuffers(1, &renderer.indexBuffer);
+
+    // The index buffer binding is part of the vertex array, so it is set once here
+    s_gl3.bindVertexArray(renderer.vertexArray);
+    s_gl3.bindBuffer(GL3_ELEMENT_ARRAY_BUFFER, renderer.indexBuffer);
+    s_gl3.enableVertexAttribArray(ATTRIB_POSITION);
+    s_gl3.enableVertexAttribArray(ATTRIB_UV);
+    s_gl3.enableVertexAttribArray(ATTRIB_COLOR);
+    s_gl3.bindVertexArray(0);
+
+    renderer.available = true;
+    return true;
+}
+
+void destroyCoreRenderer(CoreRenderer& renderer, const sf::Window& window) {
+    // Without the window's context the objects are already gone with it
+    if (!renderer.available || !window.setActive(true)) return;
+
+    s_gl3.deleteBuffers(1, &renderer.indexBuffer);
+    s_gl3.deleteBuffers(1, &renderer.vertexBuffer);
+    s_gl3.deleteVertexArrays(1, &renderer.vertexArray);
+    s_gl3.deleteProgram(renderer.program);
+    renderer = CoreRenderer();
+}
+
+void SetupRenderStateCore(const CoreRenderer& renderer, ImDrawData* draw_data, int fb_width,
+                          int fb_height) {
+    glEnable(GL_BLEND);
+    s_gl3.blendEquation(GL3_FUNC_ADD);
+    s_gl3.blendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    glDisable(GL_CULL_FACE);
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_STENCIL_TEST);
+    glEnable(GL_SCISSOR_TEST);
+    glViewport(0, 0, (GLsizei)fb_width, (GLsizei)fb_height);
+
+    const float left = draw_data->DisplayPos.x;
+    const float right = draw_data->DisplayPos.x + draw_data->DisplaySize.x;
+    const float top = draw_data->DisplayPos.y;
+    const float bottom = draw_data->DisplayPos.y + draw_data->DisplaySize.y;
+    const float projection[16] = {
+        2.0f / (right - left),           0.0f,                            0.0f,  0.0f,
+        0.0f,                            2.0f / (top - bottom),           0.0f,  0.0f,
+        0.0f,                            0.0f,                            -1.0f, 0.0f,
+        (right + left) / (left - right), (top + bottom) / (bottom - top), 0.0f,  1.0f,
+    };
+
+    s_gl3.useProgram(renderer.program);
+    s_gl3.uniformMatrix4fv(renderer.projectionLocation, 1, GL_FALSE, projection);
+    s_gl3.activeTexture(GL3_TEXTURE0);
+    s_gl3.bindVertexArray(renderer.vertexArray);
+    s_gl3.bindBuffer(GL3_ARRAY_BUFFER, renderer.vertexBuffer);
+}
+
+// Streams every command list into one vertex and one index buffer per frame. The buffers
+// are orphaned first, so the driver hands out fresh storage instead of waiting for the
+// previous frame's draws. With upload false the buffers still hold this draw data from the
+// previous call and are drawn as they are. No GL state is queried: everything used is set
+// here and reset to the defaults afterwards.
+void RenderDrawListsCore(CoreRenderer& renderer, ImDrawData* draw_data, int fb_width,
+                         int fb_height, bool upload) {
+    SetupRenderStateCore(renderer, draw_data, fb_width, fb_height);
+
+    if (upload || !renderer.hasGeometry) {
+        const std::size_t vertexBytes = (std::size_t)draw_data->TotalVtxCount * sizeof(ImDrawVert);
+        const std::size_t indexBytes = (std::size_t)draw_data->TotalIdxCount * sizeof(ImDrawIdx);
+
+        // Grow geometrically so steady-state frames never reallocate
+        if (vertexBytes > renderer.vertexCapacity) {
+            renderer.vertexCapacity = std::max(vertexBytes, renderer.vertexCapacity * 2);
+        }
+        if (indexBytes > renderer.indexCapacity) {
+            renderer.indexCapacity = std::max(indexBytes, renderer.indexCapacity * 2);
+        }
+        s_gl3.bufferData(GL3_ARRAY_BUFFER, (std::ptrdiff_t)renderer.vertexCapacity, nullptr,
+                         GL3_STREAM_DRAW);
+        s_gl3.bufferData(GL3_ELEMENT_ARRAY_BUFFER, (std::ptrdiff_t)renderer.indexCapacity,
+                         nullptr, GL3_STREAM_DRAW);
+
+        std::size_t vertexOffset = 0;
+        std::size_t indexOffset = 0;
+        for (int n = 0; n < draw_data->CmdListsCount; n++) {
+            const ImDrawList* cmd_list = draw_data->CmdLists[n];
+            const std::size_t listVertexBytes =
+                (std::size_t)cmd_list->VtxBuffer.Size * sizeof(ImDrawVert);
+            const std::size_t listIndexBytes =
+                (std::size_t)cmd_list->IdxBuffer.Size * sizeof(ImDrawIdx);
+            s_gl3.bufferSubData(GL3_ARRAY_BUFFER, (std::ptrdiff_t)vertexOffset,
+                                (std::ptrdiff_t)listVertexBytes, cmd_list->VtxBuffer.Data);
+            s_gl3.bufferSubData(GL3_ELEMENT_ARRAY_BUFFER, (std::ptrdiff_t)indexOffset,
+                                (std::ptrdiff_t)listIndexBytes, cmd_list->IdxBuffer.Data);
+            vertexOffset += listVertexBytes;
+            indexOffset += listIndexBytes;
+        }
+        renderer.hasGeometry = true;
+    }
+
+    const ImVec2 clip_off = draw_data->DisplayPos;
+    const ImVec2 clip_scale = draw_data->FramebufferScale;
+    const GLenum indexType = sizeof(ImDrawIdx) == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    GLuint boundTexture = 0;
+    bool textureBound = false;
+
+    std::size_t vertexOffset = 0;
+    std::size_t indexOffset = 0;
+    for (int n = 0; n < draw_data->CmdListsCount; n++) {
+        const ImDrawList* cmd_list = draw_data->CmdLists[n];
+
+        // Point the attributes at this list's vertices instead of rebasing its indices
+        const char* base = reinterpret_cast<const char*>(vertexOffset);
+        s_gl3.vertexAttribPointer(ATTRIB_POSITION, 2, GL_FLOAT, GL_FALSE, sizeof(ImDrawVert),
+                                  base + IM_OFFSETOF(ImDrawVert, pos));
+        s_gl3.vertexAttribPointer(ATTRIB_UV, 2, GL_FLOAT, GL_FALSE, sizeof(ImDrawVert),
+                                  base + IM_OFFSETOF(ImDrawVert, uv));
+        s_gl3.vertexAttribPointer(ATTRIB_COLOR, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(ImDrawVert),
+                                  base + IM_OFFSETOF(ImDrawVert, col));
+
+        for (int cmd_i = 0; cmd_i < cmd_list->CmdBuffer.Size; cmd_i++) {
+            const ImDrawCmd* pcmd = &cmd_list->CmdBuffer[cmd_i];
+            if (pcmd->UserCallback) {
+                if (pcmd->UserCallback == ImDrawCallback_ResetRenderState) {
+                    SetupRenderStateCore(renderer, draw_data, fb_width, fb_height);
+                    textureBound = false;
+                } else {
+                    pcmd->UserCallback(cmd_list, pcmd);
+                }
+                continue;
+            }
+
+            ImVec4 clip_rect;
+            clip_rect.x = (pcmd->ClipRect.x - clip_off.x) * clip_scale.x;
+            clip_rect.y = (pcmd->ClipRect.y - clip_off.y) * clip_scale.y;
+            clip_rect.z = (pcmd->ClipRect.z - clip_off.x) * clip_scale.x;
+            clip_rect.w = (pcmd->ClipRect.w - clip_off.y) * clip_scale.y;
+            if (clip_rect.x >= static_cast<float>(fb_width) ||
+                clip_rect.y >= static_cast<float>(fb_height) || clip_rect.z < 0.0f ||
+                clip_rect.w < 0.0f) {
+                continue;
+            }
+
+            glScissor((int)clip_rect.x, (int)(static_cast<float>(fb_height) - clip_rect.w),
+                      (int)(clip_rect.z - clip_rect.x), (int)(clip_rect.w - clip_rect.y));
+
+            // Most commands share the font atlas, so skip redundant binds
+            const GLuint textureHandle = convertImTextureIDToGLTextureHandle(pcmd->TextureId);
+            if (!textureBound || textureHandle != boundTexture) {
+                glBindTexture(GL_TEXTURE_2D, textureHandle);
+                boundTexture = textureHandle;
+                textureBound = true;
+            }
+
+            glDrawElements(GL_TRIANGLES, (GLsizei)pcmd->ElemCount, indexType,
+                           reinterpret_cast<const void*>(indexOffset +
+                                                         pcmd->IdxOffset * sizeof(ImDrawIdx)));
+        }
+
+        vertexOffset += (std::size_t)cmd_list->VtxBuffer.Size * sizeof(ImDrawVert);
+        indexOffset += (std::size_t)cmd_list->IdxBuffer.Size * sizeof(ImDrawIdx);
+    }
+
+    // Leave the defaults SFML expects; the caller then resets SFML's own state cache
+    glDisable(GL_SCISSOR_TEST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    s_gl3.bindVertexArray(0);
+    s_gl3.bindBuffer(GL3_ARRAY_BUFFER, 0);
+    s_gl3.useProgram(0);
+}
+
 unsigned int getConnectedJoystickId() {
     for (unsigned int i = 0; i < (unsigned int)sf::Joystick::Count; ++i) {
         if (sf::Joystick::isConnected(i)) return i;
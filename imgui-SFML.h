@@ -51,6 +51,12 @@ IMGUI_SFML_API void Update(sf::Window& window, sf::RenderTarget& target, sf::Tim
 IMGUI_SFML_API void Update(const sf::Vector2i& mousePos, const sf::Vector2f& displaySize,
                            sf::Time dt);
 
+// True when the UI may look different from the last frame: input arrived since the last
+// Update, a few frames are still settling after it, or a widget is active or blinking.
+// When false, Update and the UI code can be skipped; Render then redraws the previous
+// frame's geometry without rebuilding it.
+IMGUI_SFML_NODISCARD IMGUI_SFML_API bool WantsFrame();
+
 IMGUI_SFML_API void Render(sf::RenderWindow& window);
 IMGUI_SFML_API void Render(sf::RenderTarget& target);
 IMGUI_SFML_API void Render();
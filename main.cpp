@@ -1,7 +1,35 @@
 #include <SFML/Graphics.hpp>
-#include <SFML/Graphics/Shader.hpp>
 #include "imgui.h"
 #include "imgui-SFML.h"
+#include "AllocationCounter.h"
+#include "Buddhabrot.h"
+#include "ComputeEngine.h"
+#include "CpuRenderer.h"
+#include "ExpMap.h"
+#include "FrameUniforms.h"
+#include "GlFunctions.h"
+#include "GpuHistogram.h"
+#include "GpuTimer.h"
+#include "Histogram.h"
+#include "HybridScheduler.h"
+#include "IterationEstimator.h"
+#include "IterationState.h"
+#include "MirrorPlan.h"
+#include "Kernels.h"
+#include "Nucleus.h"
+#include "Palette.h"
+#include "PrecisionPlanner.h"
+#include "ResolutionGovernor.h"
+#include "ShaderManager.h"
+#include "TemporalAccumulator.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <future>
+#include <memory>
+#include <string>
 #include <vector>
 #include <iostream>
 
@@ -10,35 +38,82 @@
 const int WIDTH = 2560;
 const int HEIGHT = 1440;
 
-class Mandelbrot {
-public:
-	/*static int calculate(double x0, double y0, int max_iteration) {
-		double x = 0.0;
-		double y = 0.0;
-		int iteration = 0;
-		double xx = x * x; // Cached squared value
-		double yy = y * y; // Cached squared value
+// Relative to the working directory, which is the project directory when run from Visual Studio
+const char* const MANDELBROT_SHADER_PATH = "mandelbrot.frag";
+const char* const COLORIZE_SHADER_PATH = "colorize.frag";
+const char* const COMPUTE_SHADER_PATH = "mandelbrot.comp";
+const char* const HISTOGRAM_SHADER_PATH = "histogram.comp";
+const char* const SHADER_CACHE_DIRECTORY = "shader_cache";
 
-		while (xx + yy <= 4.0 && iteration < max_iteration) {
-			y = 2 * x * y + y0;
-			x = xx - yy + x0;
-			xx = x * x;
-			yy = y * y;
-			iteration++;
-		}
+// Must match CDF_WIDTH in colorize.frag.
+const int CDF_TEXTURE_WIDTH = 1024;
+
+// Texture units of the colour pass; the field is drawn as the sprite texture on unit 0.
+const GLint PALETTE_TEXTURE_UNIT = 1;
+const GLint CDF_TEXTURE_UNIT = 2;
+
+// With automatic iterations, how far past the estimate a CPU tile may be raised
+const int AUTO_TILE_FACTOR = 8;
+
+// With dynamic resolution, how long the view has to stay still before a frame rendered at
+// reduced resolution is redone at full resolution
+const float REFINE_DELAY_SECONDS = 0.25f;
+
+// Time the Buddhabrot spends tracing each frame, and how far one frame may move its batch size
+const float BUDDHABROT_FRAME_MILLISECONDS = 30.0f;
+const float BUDDHABROT_BATCH_GROWTH = 2.0f;
+
+enum class RenderBackend {
+	GpuShader,
+	Cpu,
+	Hybrid,		// GpuShader and Cpu on tiles of the same frame
+	Buddhabrot,	// orbit density on the CPU, see Buddhabrot.h
+	GpuCompute	// needs OpenGL 4.3
+};
+
+enum class ColoringMode {
+	Linear,		// value / maxIterations
+	Histogram	// rank of the value in the current frame
+};
+
+enum class GpuPrecision {
+	Auto,		// double once float can no longer resolve a pixel
+	Single,
+	Double
+};
 
-		if (iteration == max_iteration) return max_iteration;
+// Everything that selects a compiled shader variant. The custom formula's code is not in
+// here; recompiling it marks the shaders dirty instead.
+struct ShaderVariant {
+	Formula formula;
+	bool doublePrecision;
+	int iterationBucket;
+	bool timeSliced;
+	bool equalize;
+	bool compute;
+	bool checkpointed;
 
-		return iteration + 1 - log(log(sqrt(xx + yy))) / log(2.0);
-	} */
+	bool operator==(const ShaderVariant&) const = default;
 };
 
+// Loop bound for maxIterations, rounded up to a power of two so dragging the slider only
+// ever touches a handful of variants.
+int iterationBucket(int iterations) {
+	int bucket = 256;
+	while (bucket < iterations) {
+		bucket *= 2;
+	}
+	return bucket;
+}
+
+// Kept as a centre and a size, not as corners: past about 1e-15 of the centre the corners
+// would round onto the same doubles, while the size still holds any scale.
 class Viewport {
 private:
-	double xMin, xMax, yMin, yMax;
+	double centerX, centerY, xRange, yRange;
 
 public:
-	Viewport() : xMin(-2.0), xMax(0.47), yMin(-1.12), yMax(1.12) {}
+	Viewport() : centerX(-0.765), centerY(0.0), xRange(2.47), yRange(2.24) {}
 	/*
 		void zoom(double zoomFactor) {
 			double centerX = (xMax + xMin) * 0.5;
@@ -54,62 +129,203 @@ public:
 		}
 		*/
 	void zoomCenter(double zoomFactor) {
-		double centerX = (xMax + xMin) * 0.5;
-		double centerY = (yMax + yMin) * 0.5;
-
-		double xRange = (xMax - xMin) * zoomFactor;
-		double yRange = (yMax - yMin) * zoomFactor;
-
-		xMin = centerX - 0.5 * xRange;
-		xMax = centerX + 0.5 * xRange;
-		yMin = centerY - 0.5 * yRange;
-		yMax = centerY + 0.5 * yRange;
+		xRange *= zoomFactor;
+		yRange *= zoomFactor;
 	}
 
 	void pan(double deltaX, double deltaY) {
-		double xRange = xMax - xMin;
-		double yRange = yMax - yMin;
-
-		xMin += xRange * deltaX;
-		xMax += xRange * deltaX;
-		yMin += yRange * deltaY;
-		yMax += yRange * deltaY;
+		centerX += xRange * deltaX;
+		centerY += yRange * deltaY;
 	}
 
 	sf::Vector2f getCenter() const {
-		return sf::Vector2f((getXMax() + getXMin()) / 2.0f, (getYMax() + getYMin()) / 2.0f);
+		return sf::Vector2f(static_cast<float>(centerX), static_cast<float>(centerY));
 	}
 
 	float getZoom() const {
-		return (getXMax() - getXMin()) / 2.0f;
+		return static_cast<float>(xRange / 2.0);
 	}
 
-	double getXMin() const { return xMin; }
-	double getXMax() const { return xMax; }
-	double getYMin() const { return yMin; }
-	double getYMax() const { return yMax; }
+	void frame(double newCenterX, double newCenterY, double newXRange, double newYRange) {
+		centerX = newCenterX;
+		centerY = newCenterY;
+		xRange = newXRange;
+		yRange = newYRange;
+	}
+
+	double getCenterX() const { return centerX; }
+	double getCenterY() const { return centerY; }
+	double getXRange() const { return xRange; }
+	double getYRange() const { return yRange; }
+	double getXMin() const { return centerX - 0.5 * xRange; }
+	double getXMax() const { return centerX + 0.5 * xRange; }
+	double getYMin() const { return centerY - 0.5 * yRange; }
+	double getYMax() const { return centerY + 0.5 * yRange; }
 };
 
 class App {
 private:
 	sf::RenderWindow window;
 	Viewport viewport;
-	sf::Shader mandelbrotShader;
-	bool needsUpdate = true;
+	ShaderManager shaders;
+	ShaderManager::SourceId mandelbrotSource = -1;
+	ShaderManager::SourceId colorizeSource = -1;
+	ShaderManager::SourceId computeSource = -1;
+	ShaderManager::SourceId histogramSource = -1;
+	GLuint mandelbrotProgram = 0;
+	GLuint colorizeProgram = 0;
+	GLuint histogramProgram = 0;	// counts the bins of the current kind of field, histogram colouring only
+	ShaderVariant activeVariant{};
+	bool shadersDirty = true;	// activeVariant does not describe the current programs
+	GpuPrecision gpuPrecision{ GpuPrecision::Auto };
+	sf::Clock reloadClock;
+	sf::RenderTexture fieldTexture;	// escape values from the last iteration pass
+	IterationState iterationState;	// replaces fieldTexture in time-sliced mode
+	bool timeSlicedAvailable = false;
+	bool timeSliced{ false };
+	int sliceIterations{ 2000 };	// per pixel and frame
+	int slicedIterations = 0;	// how far the current time-sliced render has got
+	ComputeEngine computeEngine;	// replaces fieldTexture for the GpuCompute backend
+	bool computeAvailable = false;
+	TemporalAccumulator temporalAccumulator;	// shown instead of fieldSprite while anti-aliasing
+	bool antialiasAvailable = false;
+	bool antialias{ false };
+	sf::Vector2f sampleOffset;	// of the field being iterated
+	float sampleWeight = 1.0f;	// of the colour pass being drawn
+	FrameUniforms frameUniforms;
+	sf::RectangleShape fullscreenQuad;
+	sf::RectangleShape scaledQuad;	// the corner of fieldTexture a reduced-resolution field fills
+	sf::Sprite fieldSprite;
+	sf::Sprite cpuSprite;
+	std::uint64_t lastFrameAllocations = 0;
+	bool needsUpdate = true;	// the iteration field is stale
+	bool needsRecolor = true;	// only the colours are stale
 
 	sf::Vector3f colorScale{ 1.0f, 1.0f, 1.0f };
+	std::vector<GradientStop> paletteStops = defaultGradientStops();
+	PaletteLut palette;
+	sf::Texture paletteTexture;
+	float paletteOffset{ 0.0f };
+	float paletteCycleSpeed{ 0.05f };	// palette lengths per second
+	bool cyclePalette{ false };
+	ColoringMode coloringMode{ ColoringMode::Linear };
+	IterationHistogram histogram;
+	sf::Texture cdfTexture;
+	std::vector<sf::Uint8> cdfPixels;
+	GpuHistogram gpuHistogram;
+	bool fieldBinned = false;	// the compute pass counted gpuHistogram's bins while iterating
+	std::vector<std::uint32_t> gpuBins;	// read back from gpuHistogram
+	std::vector<float> gpuField;	// CPU copy of fieldTexture, for the histogram without compute shaders
 	int maxIterations{500};
+	bool checkpointed{ true };	// bailout tested once per CHECKPOINT_ITERATIONS, on CPU and GPU
+	bool autoIterations{ false };	// maxIterations follows the view
+	IterationEstimator iterationEstimator;
+	Formula formula{ Formula::Mandelbrot };
+	sf::Vector2f juliaC{ -0.8f, 0.156f };
+	FormulaProgram customFormula;
+	char customFormulaText[256] = "z = z^3 + sin(c)";
+	std::string customFormulaError;
+
+	RenderBackend backend{ RenderBackend::GpuShader };
+	CpuRenderer cpuRenderer;
+	HybridScheduler hybridScheduler;
+	sf::VertexArray gpuTileQuads{ sf::Quads };	// the hybrid frame's GPU tiles
+	std::vector<sf::Uint8> cpuTilePixels;	// the hybrid frame's CPU tiles, packed like fieldTexture
+	GpuTimer iterationTimer;	// iterateField's passes, in fieldTexture's context
+	GpuTimer hybridTimer;	// iterateHybrid's GPU tiles, tagged with their count, in the same context
+
+	// Views straddling an axis of symmetry iterate one side and mirror it. The fragment engine
+	// draws the unique part of the field and blits it flipped over the rest.
+	bool symmetry{ true };
+	MirrorPlan gpuMirror;	// of the field in fieldTexture
+	sf::VertexArray mirrorQuads{ sf::Quads };	// the part of the field gpuMirror leaves to iterate
+
+	// Dynamic resolution: frames that follow a change are iterated at the governor's scale,
+	// and once the view has been still for REFINE_DELAY_SECONDS again at full resolution.
+	// The GPU does that in one pass; the CPU renders the full frame on another thread while
+	// the preview stays on screen.
+	bool dynamicResolution{ false };
+	ResolutionGovernor resolutionGovernor;
+	sf::Clock changeClock;	// since the last frame that followed a change
+	float gpuFieldScale = 1.0f;	// of the field in fieldTexture
+	CpuRenderer cpuPreview;	// reduced-resolution CPU frames
+	bool showingPreview = false;	// the CPU field on screen is cpuPreview's
+	std::future<void> refinement;	// cpuRenderer at full resolution, in the background
+	std::atomic<bool> cancelRefinement{ false };
+	Buddhabrot buddhabrot;	// sized on first use; each pool worker holds a full-frame buffer
+	int buddhabrotBatch = 20000;	// orbits per frame, adjusted to BUDDHABROT_FRAME_MILLISECONDS
+	int buddhabrotMillions = 100;	// orbits traced before the picture is left as it is
+	sf::Texture cpuTexture;
+	std::vector<sf::Uint8> cpuPixels;
+	bool cpuMixedPrecision{ true };
+	bool showPrecisionMap{ false };
+	sf::VertexArray precisionMap{ sf::Quads };
+
+	// Zoom video capture
+	std::unique_ptr<ExpMapCapture> zoomCapture;
+	float zoomVideoDepth{ 12.0f };
+	int zoomVideoFrames{ 600 };
+	int zoomVideoAngularSamples{ 4096 };
+	int zoomVideoRowsPerFrame{ 64 };
+	int nucleusPeriod = 0;	// of the nucleus at nucleusX, nucleusY; 0 when none was found
+	double nucleusX = 0.0;
+	double nucleusY = 0.0;
 
 public:
 	App() : window(sf::VideoMode(WIDTH, HEIGHT), "Mandelbrot Set"), needsUpdate(true) {
-		if (!mandelbrotShader.loadFromFile("C:\\Fractal Renderer\\Fractal Renderer\\mandelbrot.frag", sf::Shader::Fragment)) {
+		customFormula.compile(customFormulaText, customFormulaError);
+
+		if (!gl.load() || !frameUniforms.create()) {
+			std::cerr << "OpenGL 3.3 is required." << std::endl;
+			exit(-1);
+		}
+
+		shaders.init(SHADER_CACHE_DIRECTORY);
+		shaders.bindBlock("FrameParams", FrameUniforms::BINDING);
+		shaders.bindSampler("field", 0);
+		shaders.bindSampler("palette", PALETTE_TEXTURE_UNIT);
+		shaders.bindSampler("cdf", CDF_TEXTURE_UNIT);
+		shaders.bindSampler("iterationState", IterationState::STATE_UNIT);
+		shaders.bindSampler("previousState", IterationState::STATE_UNIT);
+		shaders.bindSampler("previousStateLow", IterationState::STATE_LOW_UNIT);
+		shaders.bindSampler("fieldValues", ComputeEngine::VALUES_UNIT);
+		mandelbrotSource = shaders.addSource(MANDELBROT_SHADER_PATH);
+		colorizeSource = shaders.addSource(COLORIZE_SHADER_PATH);
+		if (mandelbrotSource < 0 || colorizeSource < 0 || !updateShaders()) {
 			std::cerr << "Failed to load shader." << std::endl;
 			exit(-1);
 		}
+		fullscreenQuad.setSize(sf::Vector2f(WIDTH, HEIGHT));
+		fieldTexture.create(WIDTH, HEIGHT);
+		fieldSprite.setTexture(fieldTexture.getTexture(), true);
+		timeSlicedAvailable = iterationState.create(WIDTH, HEIGHT);
+		antialiasAvailable = temporalAccumulator.create(WIDTH, HEIGHT);
+		if (gl.hasCompute()) {
+			computeSource = shaders.addSource(COMPUTE_SHADER_PATH);
+			computeAvailable = computeSource >= 0 && computeEngine.create(WIDTH, HEIGHT);
+			histogramSource = shaders.addSource(HISTOGRAM_SHADER_PATH);
+		}
+		paletteTexture.create(PaletteLut::SIZE, 1);
+		paletteTexture.setSmooth(true);
+		paletteTexture.setRepeated(true);
+		applyPalette();
+		cdfTexture.create(CDF_TEXTURE_WIDTH, 1);
+		cpuRenderer.resize(WIDTH, HEIGHT);
+		iterationEstimator.resize(WIDTH, HEIGHT);
+		cpuTexture.create(WIDTH, HEIGHT);
+		cpuSprite.setTexture(cpuTexture, true);
+		cpuPixels.resize(static_cast<size_t>(WIDTH) * HEIGHT * 4);
+		cpuTilePixels.resize(static_cast<size_t>(WIDTH) * HEIGHT * 4);
+		cpuTexture.setSmooth(true);	// stretches reduced-resolution frames
+		cpuRenderer.setCancelFlag(&cancelRefinement);
 		window.setVerticalSyncEnabled(true);
 		window.setFramerateLimit(144);
 	}
 
+	~App() {
+		stopRefinement();
+	}
+
 	float getAspect() const {
 		return static_cast<float>(WIDTH) / HEIGHT;
 	}
@@ -120,47 +336,810 @@ public:
 
 		while (window.isOpen()) {
 			sf::Event event;
+			// Nothing on screen can change until the next event, so sleep until it arrives
+			if (isIdle() && window.waitEvent(event)) {
+				handleEvents(event);
+				deltaClock.restart();
+			}
 			while (window.pollEvent(event)) {
-				ImGui::SFML::ProcessEvent(event);
 				handleEvents(event);
 				/*if (event.type == sf::Event::Closed) {
 					window.close();
 				}*/
 			}
 
-			// Begin ImGui frame
-			ImGui::SFML::Update(window, deltaClock.restart());
-
-			// ImGui interface goes here
-			ImGui::Begin("Control Panel");
-			// ... your ImGui widgets ...
-			if (ImGui::SliderInt("Max Iterations", &maxIterations, 100, 100000)) {
-				needsUpdate = true;
+			// Shader edits are only noticed here, so while idle they show up with the next event
+			if (reloadClock.getElapsedTime() >= sf::seconds(0.5f)) {
+				reloadClock.restart();
+				if (shaders.reloadChanged()) {
+					shadersDirty = true;
+					needsUpdate = true;
+				}
 			}
 
-			if (ImGui::ColorEdit3("Color Scale", reinterpret_cast<float*>(&colorScale))) {
-				needsUpdate = true;
+			const std::uint64_t allocationsBefore = allocationCount();
+			sf::Time frameTime = deltaClock.restart();
+			if (ImGui::SFML::WantsFrame()) {
+				buildControlPanel(frameTime);
 			}
 
-			if 
-
-			ImGui::End();
+			if (zoomCapture && !zoomCapture->step(zoomVideoRowsPerFrame)) {
+				zoomCapture.reset();
+			}
 
-			// Render the ImGui draw lists
-			ImGui::Render();
+			if (cyclePalette) {
+				paletteOffset = std::fmod(paletteOffset + paletteCycleSpeed * frameTime.asSeconds() + 1.0f, 1.0f);
+				needsRecolor = true;
+			}
 
 			// The rest of your rendering code
 			window.clear();
 			renderMandelbrot();
 			ImGui::SFML::Render(window);
 			window.display();
+			lastFrameAllocations = allocationCount() - allocationsBefore;
 		}
 
 		// Shutdown ImGui SFML when the window is closed
 		ImGui::SFML::Shutdown();
 	}
 
+	// Times one full iteration pass of each GPU engine on a few fixed views and prints the
+	// averages, then the CPU renderer in double, in fixed128 and in mixed precision. The
+	// custom-formula scenes repeat built-in ones through the formula compiler, whose CPU
+	// interpreter only has double. Colouring is the same for every engine and is left out. The GPUs only have double, so
+	// their mid-depth numbers are for a wrong picture. The GPU engines and the double CPU
+	// pass also run with the bailout tested every step, against the checkpointed kernels.
+	void benchmark() {
+		struct Scene {
+			const char* name;
+			double centerX, centerY, width;
+			int iterations;
+			Formula formula = Formula::Mandelbrot;
+			const char* custom = nullptr;	// formula text for Formula::Custom
+		};
+		const Scene scenes[] = {
+			{ "Overview", -0.765, 0.0, 2.47, 500 },
+			{ "Overview, custom z = z^2 + c", -0.765, 0.0, 2.47, 500, Formula::Custom, "z = z^2 + c" },
+			{ "Seahorse valley", -0.7435, 0.1314, 0.002, 5000 },
+			{ "Cardioid interior", -0.2, 0.0, 0.6, 5000 },
+			{ "Cardioid interior, custom z = z^2 + c", -0.2, 0.0, 0.6, 5000, Formula::Custom, "z = z^2 + c" },
+			{ "Cardioid interior, 50000 iterations", -0.2, 0.0, 0.6, 50000 },
+			{ "Mid-depth, 1e-20 wide", -0.743643887037151, 0.131825904205330, 1e-20, 5000 },
+		};
+		const int RUNS = 5;
+
+		const Formula userFormula = formula;
+		timeSliced = false;
+		for (const Scene& scene : scenes) {
+			viewport.frame(scene.centerX, scene.centerY, scene.width, scene.width / getAspect());
+			maxIterations = scene.iterations;
+			formula = scene.formula;
+			if (scene.custom && !customFormula.compile(scene.custom, customFormulaError)) {
+				std::cout << scene.name << ": " << customFormulaError << std::endl;
+				continue;
+			}
+			std::cout << scene.name << ", " << maxIterations << " iterations" << std::endl;
+
+			struct GpuPass {
+				RenderBackend engine;
+				bool checkpointed;
+			};
+			for (GpuPass pass : { GpuPass{ RenderBackend::GpuShader, false }, GpuPass{ RenderBackend::GpuShader, true },
+					GpuPass{ RenderBackend::GpuCompute, false }, GpuPass{ RenderBackend::GpuCompute, true } }) {
+				const std::string name = std::string(pass.engine == RenderBackend::GpuShader ? "fragment" : "compute")
+					+ (pass.checkpointed ? "" : ", bailout every step");
+				if (pass.engine == RenderBackend::GpuCompute && !computeAvailable) {
+					std::cout << "  " << name << ": not available" << std::endl;
+					continue;
+				}
+				backend = pass.engine;
+				checkpointed = pass.checkpointed;
+				if (!updateShaders()) {
+					std::cout << "  " << name << ": shader failed" << std::endl;
+					continue;
+				}
+
+				// The first pass pays for compilation and driver warm-up
+				iterateField();
+				glFinish();
+				sf::Clock clock;
+				for (int i = 0; i < RUNS; ++i) {
+					iterateField();
+				}
+				glFinish();
+				const float milliseconds = clock.getElapsedTime().asSeconds() * 1000.0f / RUNS;
+				std::cout << "  " << name << ": " << milliseconds << " ms, "
+					<< static_cast<float>(WIDTH) * HEIGHT / (milliseconds * 1000.0f) << " Mpixel/s" << std::endl;
+			}
+
+			// The CPU throughout in double, throughout in fixed128 and in double-double, and with
+			// each tile in its own precision. Resizing drops the cached orbits, so every pass is a
+			// full render. Fixed128 and double-double have no checkpointed kernel.
+			KernelParams params;
+			params.maxIterations = maxIterations;
+			cpuRenderer.setTileMask({});
+			struct CpuPass {
+				Precision precision;	// Count for mixed
+				bool checkpointed;
+			};
+			for (CpuPass pass : { CpuPass{ Precision::Double, false }, CpuPass{ Precision::Double, true }, CpuPass{ Precision::Fixed128, true },
+					CpuPass{ Precision::DoubleDouble, true }, CpuPass{ Precision::Count, true } }) {
+				if (formula == Formula::Custom && (pass.precision != Precision::Double || !pass.checkpointed)) {
+					continue;
+				}
+				const Precision precision = pass.precision;
+				const bool mixed = precision == Precision::Count;
+				params.checkpointed = pass.checkpointed;
+				cpuRenderer.resize(WIDTH, HEIGHT);
+				cpuRenderer.setMixedPrecision(mixed);
+				cpuRenderer.setUniformPrecision(mixed ? Precision::Double : precision);
+				sf::Clock clock;
+				cpuRenderer.render(viewport.getCenterX(), viewport.getCenterY(), viewport.getXRange(), viewport.getYRange(), formula, params,
+					&customFormula);
+				const float milliseconds = clock.getElapsedTime().asSeconds() * 1000.0f;
+				const PrecisionPlanner& plan = cpuRenderer.getPrecisionPlan();
+				std::cout << "  cpu " << (mixed ? "mixed" : precisionName(precision)) << (pass.checkpointed ? "" : ", bailout every step") << ": "
+					<< milliseconds << " ms, "
+					<< static_cast<float>(WIDTH) * HEIGHT / (milliseconds * 1000.0f) << " Mpixel/s, "
+					<< plan.getCount(Precision::Float) << " float, " << plan.getCount(Precision::Fixed128) << " fixed128, "
+					<< plan.getCount(Precision::DoubleDouble) << " double-double of "
+					<< plan.getTilesX() * plan.getTilesY() << " tiles" << std::endl;
+			}
+			cpuRenderer.setMixedPrecision(cpuMixedPrecision);
+			cpuRenderer.setUniformPrecision(Precision::Double);
+		}
+		checkpointed = true;
+		formula = userFormula;
+		customFormula.compile(customFormulaText, customFormulaError);
+	}
+
+	// Draws frames of a fixed view the way run() does, without the overlay, and counts the
+	// heap allocations of the last STEADY_FRAMES of them: first with every frame recolouring,
+	// as when the palette cycles, then with every frame iterating the view again. Returns
+	// false when any of them allocated. Only builds with FRACTAL_COUNT_ALLOCATIONS count, which
+	// the Debug configurations define.
+	bool checkSteadyAllocations() {
+#ifdef FRACTAL_COUNT_ALLOCATIONS
+		const int WARMUP_FRAMES = 8;
+		const int STEADY_FRAMES = 32;
+
+		backend = RenderBackend::GpuShader;
+		timeSliced = false;
+		maxIterations = 500;
+		viewport.frame(-0.765, 0.0, 2.47, 2.47 / getAspect());
+		needsUpdate = true;
+		bool steady = true;
+		for (bool iterate : { false, true }) {
+			std::uint64_t allocations = 0;
+			for (int frame = 0; frame < WARMUP_FRAMES + STEADY_FRAMES; ++frame) {
+				needsUpdate = needsUpdate || iterate;
+				needsRecolor = true;
+				const std::uint64_t allocationsBefore = allocationCount();
+				window.clear();
+				renderMandelbrot();
+				window.display();
+				if (frame >= WARMUP_FRAMES) {
+					allocations += allocationCount() - allocationsBefore;
+				}
+			}
+			std::cout << "Heap allocations per frame, " << (iterate ? "iterating" : "recolouring") << ": "
+				<< static_cast<double>(allocations) / STEADY_FRAMES << std::endl;
+			steady = steady && allocations == 0;
+		}
+		return steady;
+#else
+		std::cout << "Heap allocations per frame: not counted, build the Debug configuration or define FRACTAL_COUNT_ALLOCATIONS" << std::endl;
+		return true;
+#endif
+	}
+
 private:
+	// True when the fractal and the overlay would come out exactly as last frame.
+	bool isIdle() {
+		return !needsUpdate && !needsRecolor && !zoomCapture && !cyclePalette && !isSlicing() && !isRefining() && !isAccumulating()
+			&& !isTracing() && !ImGui::SFML::WantsFrame();
+	}
+
+	// The Buddhabrot keeps adding orbits until it reaches the limit
+	bool isTracing() const {
+		return backend == RenderBackend::Buddhabrot && buddhabrot.getOrbitCount() < buddhabrotMillions * 1000000ll;
+	}
+
+	bool isGpuBackend() const {
+		return backend != RenderBackend::Cpu && backend != RenderBackend::Buddhabrot;
+	}
+
+	// Temporal anti-aliasing covers the one-pass fragment engine at full resolution
+	bool isAntialiasing() const {
+		return antialias && antialiasAvailable && backend == RenderBackend::GpuShader && !timeSliced && gpuFieldScale >= 1.0f;
+	}
+
+	bool isAccumulating() const {
+		return isAntialiasing() && !temporalAccumulator.isConverged();
+	}
+
+	// Dynamic resolution covers the one-pass fragment engine and the CPU
+	bool isScalable() const {
+		return dynamicResolution && ((backend == RenderBackend::GpuShader && !timeSliced) || backend == RenderBackend::Cpu);
+	}
+
+	// A reduced-resolution frame is on screen, or its full-resolution version is on the way
+	bool isRefining() const {
+		if (backend == RenderBackend::Cpu) {
+			return showingPreview || refinement.valid();
+		}
+		return backend == RenderBackend::GpuShader && gpuFieldScale < 1.0f;
+	}
+
+	bool refineDue() const {
+		return changeClock.getElapsedTime().asSeconds() >= REFINE_DELAY_SECONDS;
+	}
+
+	// Cancels the background CPU render and waits for it, after which cpuRenderer and the
+	// thread pool are free again. The preview stays on screen.
+	void stopRefinement() {
+		if (refinement.valid()) {
+			cancelRefinement = true;
+			refinement.get();
+			cancelRefinement = false;
+		}
+	}
+
+	const CpuRenderer& shownCpuRenderer() const {
+		return showingPreview ? cpuPreview : cpuRenderer;
+	}
+
+	bool isSlicingBackend() const {
+		return backend == RenderBackend::GpuShader && timeSliced;
+	}
+
+	// A time-sliced GPU render that still has unfinished pixels
+	bool isSlicing() const {
+		return isSlicingBackend() && slicedIterations < maxIterations;
+	}
+
+	// Runs the ImGui frame. Skipped while the panel is unchanged; ImGui::SFML::Render then
+	// redraws the previous frame's geometry.
+	void buildControlPanel(sf::Time frameTime) {
+		// Begin ImGui frame
+		ImGui::SFML::Update(window, frameTime);
+
+		// ImGui interface goes here
+		ImGui::Begin("Control Panel");
+		// ... your ImGui widgets ...
+		if (ImGui::SliderInt("Max Iterations", &maxIterations, 100, 100000)) {
+			autoIterations = false;
+			needsUpdate = true;
+		}
+		if (ImGui::Checkbox("Auto iterations", &autoIterations)) {
+			needsUpdate = true;
+		}
+		ImGui::SameLine();
+		if (ImGui::Checkbox("Checkpointed bailout", &checkpointed)) {
+			needsUpdate = true;
+		}
+		if (autoIterations) {
+			ImGui::Text("Zoom depth: %d, probe: %d (%.1f%% late)", iterationEstimator.getDepthEstimate(),
+				iterationEstimator.getProbeEstimate(), iterationEstimator.getLateFraction() * 100.0f);
+		}
+
+		if (ImGui::ColorEdit3("Color Scale", reinterpret_cast<float*>(&colorScale))) {
+			applyPalette();
+		}
+
+		const char* coloringModes[] = { "Linear", "Histogram" };
+		int coloringIndex = static_cast<int>(coloringMode);
+		if (ImGui::Combo("Coloring", &coloringIndex, coloringModes, 2)) {
+			coloringMode = static_cast<ColoringMode>(coloringIndex);
+			if (coloringMode == ColoringMode::Histogram) {
+				equalizeCachedField();
+			}
+			needsRecolor = true;
+		}
+
+		drawFormulaControls();
+
+		drawResolutionControls();
+
+		drawPaletteControls();
+
+		drawZoomVideoControls();
+
+#ifdef FRACTAL_COUNT_ALLOCATIONS
+		ImGui::Text("Heap allocations last frame: %llu", static_cast<unsigned long long>(lastFrameAllocations));
+#endif
+
+		ImGui::End();
+	}
+
+	// Iterating in float stops resolving pixels once they are smaller than the float
+	// spacing of the coordinates. The GPU iterates the whole frame in one precision, the one
+	// the most demanding tile needs.
+	bool gpuNeedsDouble() const {
+		if (formula == Formula::Custom) {
+			return false;	// the custom formula helpers are float-only
+		}
+		if (gpuPrecision != GpuPrecision::Auto) {
+			return gpuPrecision == GpuPrecision::Double;
+		}
+		double pixel = viewport.getXRange() / WIDTH;
+		double magnitude = std::max(std::max(std::abs(viewport.getXMin()), std::abs(viewport.getXMax())),
+			std::max(std::abs(viewport.getYMin()), std::abs(viewport.getYMax())));
+		return PrecisionPlanner::precisionFor(PrecisionPlanner::requiredBits(pixel, magnitude, maxIterations)) != Precision::Float;
+	}
+
+	// Switches to the shader variants for the current settings, compiling them if needed.
+	// Runs every frame but only builds define strings when the variant changed. Returns
+	// false if a variant failed; the previous program is kept in that case.
+	bool updateShaders() {
+		const bool compute = backend == RenderBackend::GpuCompute;
+		ShaderVariant variant{ formula, gpuNeedsDouble(), iterationBucket(maxIterations), isSlicingBackend(),
+			coloringMode == ColoringMode::Histogram, compute, checkpointed };
+		if (!shadersDirty && variant == activeVariant) {
+			return true;
+		}
+		activeVariant = variant;
+		shadersDirty = false;
+
+		std::string defines = formulaDefines(formula);
+		if (formula == Formula::Custom && customFormula.isValid()) {
+			defines += customFormula.glslDefines();
+		}
+		if (variant.doublePrecision) {
+			defines += "#define PRECISION_DOUBLE\n";
+		}
+		defines += "#define ITERATION_BUCKET " + std::to_string(variant.iterationBucket) + "\n";
+		if (variant.checkpointed) {
+			defines += "#define CHECKPOINT_ITERATIONS " + std::to_string(CHECKPOINT_ITERATIONS) + "\n";
+		}
+		std::string fieldDefines;
+		if (variant.timeSliced) {
+			defines += "#define TIME_SLICED\n";
+			fieldDefines = "#define FIELD_STATE\n";
+		}
+		if (variant.compute) {
+			fieldDefines = "#define FIELD_VALUES\n";
+			if (variant.equalize) {
+				defines += "#define HISTOGRAM\n";
+			}
+		}
+		GLuint iterate = shaders.get(variant.compute ? computeSource : mandelbrotSource, defines);
+		GLuint colorize = shaders.get(colorizeSource, (variant.equalize ? "#define EQUALIZE\n" : "") + fieldDefines);
+		// Without it the histogram falls back to reading the whole field
+		histogramProgram = variant.equalize && histogramSource >= 0 ? shaders.get(histogramSource, fieldDefines) : 0;
+
+		if (iterate) {
+			mandelbrotProgram = iterate;
+		}
+		else {
+			std::cerr << "Failed to compile shader for " << formulaName(formula) << std::endl;
+		}
+		if (colorize) {
+			colorizeProgram = colorize;
+		}
+		return iterate && colorize;
+	}
+
+	// Size of the field in fieldTexture, which fills its bottom-left corner
+	int fieldWidth() const {
+		return gpuFieldScale < 1.0f ? std::max(1, static_cast<int>(std::lround(WIDTH * gpuFieldScale))) : WIDTH;
+	}
+	int fieldHeight() const {
+		return gpuFieldScale < 1.0f ? std::max(1, static_cast<int>(std::lround(HEIGHT * gpuFieldScale))) : HEIGHT;
+	}
+
+	FrameParams frameParams() const {
+		FrameParams params;
+		params.viewport[0] = static_cast<float>(viewport.getXMin());
+		params.viewport[1] = static_cast<float>(viewport.getXMax());
+		params.viewport[2] = static_cast<float>(viewport.getYMin());
+		params.viewport[3] = static_cast<float>(viewport.getYMax());
+		params.viewportLow[0] = static_cast<float>(viewport.getXMin() - params.viewport[0]);
+		params.viewportLow[1] = static_cast<float>(viewport.getXMax() - params.viewport[1]);
+		params.viewportLow[2] = static_cast<float>(viewport.getYMin() - params.viewport[2]);
+		params.viewportLow[3] = static_cast<float>(viewport.getYMax() - params.viewport[3]);
+		params.juliaC[0] = juliaC.x;
+		params.juliaC[1] = juliaC.y;
+		params.resolution[0] = static_cast<float>(fieldWidth());
+		params.resolution[1] = static_cast<float>(fieldHeight());
+		params.fieldScale[0] = static_cast<float>(fieldWidth()) / WIDTH;
+		params.fieldScale[1] = static_cast<float>(fieldHeight()) / HEIGHT;
+		params.maxIterations = maxIterations;
+		params.paletteOffset = paletteOffset;
+		params.cdfBins = histogram.getBinCount();
+		params.iterationBudget = sliceIterations;
+		params.sampleOffset[0] = sampleOffset.x;
+		params.sampleOffset[1] = sampleOffset.y;
+		params.sampleWeight = sampleWeight;
+		return params;
+	}
+
+	void drawFormulaControls() {
+		const char* backends[] = { "GPU Shader", "CPU", "GPU + CPU", "Buddhabrot", "GPU Compute" };
+		int backendIndex = static_cast<int>(backend);
+		if (ImGui::Combo("Renderer", &backendIndex, backends, computeAvailable ? 5 : 4)) {
+			backend = static_cast<RenderBackend>(backendIndex);
+			needsUpdate = true;
+		}
+
+		if (backend == RenderBackend::Cpu && formula != Formula::Custom && refinement.valid()) {
+			ImGui::Text("Refining at full resolution");
+		}
+		else if (backend == RenderBackend::Cpu && formula != Formula::Custom) {
+			const CpuRenderer& shown = shownCpuRenderer();
+			ImGui::Text("Unescaped pixels kept: %d, resumed: %d", shown.getPendingCount(), shown.getResumedCount());
+			if (autoIterations) {
+				ImGui::Text("Tiles raised past the limit: %d", shown.getRaisedTileCount());
+			}
+			if (ImGui::Checkbox("Mixed precision", &cpuMixedPrecision)) {
+				needsUpdate = true;
+			}
+			ImGui::SameLine();
+			ImGui::Checkbox("Show precision map", &showPrecisionMap);
+			const PrecisionPlanner& plan = shown.getPrecisionPlan();
+			ImGui::Text("Tiles: %d float, %d double, %d fixed128, %d double-double, %d perturbed", plan.getCount(Precision::Float),
+				plan.getCount(Precision::Double), plan.getCount(Precision::Fixed128), plan.getCount(Precision::DoubleDouble),
+				plan.getCount(Precision::BigFloat));
+			if (plan.getUnservedCount() > 0) {
+				ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "%d tiles need more than double-double, which %s cannot go past; they may be wrong",
+					plan.getUnservedCount(), formulaName(formula));
+			}
+		}
+		if (backend == RenderBackend::Hybrid) {
+			ImGui::Text("GPU: %d tiles, %.0f tiles/s", hybridScheduler.getGpuTileCount(), hybridScheduler.getGpuRate());
+			ImGui::Text("CPU: %d tiles (%d past the GPU's precision), %.0f tiles/s", hybridScheduler.getCpuTileCount(),
+				hybridScheduler.getForcedTileCount(), hybridScheduler.getCpuRate());
+		}
+
+		if (backend == RenderBackend::Buddhabrot) {
+			ImGui::Text("Orbits: %.1f million, %s", buddhabrot.getOrbitCount() * 1e-6,
+				buddhabrot.isMetropolis() ? "Metropolis sampling" : "uniform sampling");
+			if (buddhabrot.isMetropolis()) {
+				ImGui::SameLine();
+				ImGui::Text("(%.0f%% accepted)", buddhabrot.getAcceptance() * 100.0f);
+			}
+			ImGui::InputInt("Orbit limit (millions)", &buddhabrotMillions);
+			buddhabrotMillions = std::max(buddhabrotMillions, 1);
+			if (formula == Formula::Custom) {
+				ImGui::Text("Custom formulas are traced as the Mandelbrot set");
+			}
+		}
+
+		if (isGpuBackend()) {
+			const char* precisions[] = { "Auto", "Float", "Double" };
+			int precisionIndex = static_cast<int>(gpuPrecision);
+			if (ImGui::Combo("Precision", &precisionIndex, precisions, 3)) {
+				gpuPrecision = static_cast<GpuPrecision>(precisionIndex);
+				needsUpdate = true;
+			}
+			ImGui::Text("Iterating in %s; shaders: %d compiled, %d from cache", activeVariant.doublePrecision ? "double" : "float",
+				shaders.getCompileCount(), shaders.getCacheHitCount());
+
+			if (backend == RenderBackend::GpuShader && timeSlicedAvailable && ImGui::Checkbox("Time-sliced", &timeSliced)) {
+				needsUpdate = true;
+			}
+			if (backend == RenderBackend::GpuShader && !timeSliced && antialiasAvailable) {
+				if (ImGui::Checkbox("Anti-alias while still", &antialias)) {
+					needsUpdate = true;
+				}
+				if (isAntialiasing()) {
+					ImGui::SameLine();
+					ImGui::Text("%d / %d samples", temporalAccumulator.getSampleCount(), TemporalAccumulator::MAX_SAMPLES);
+				}
+			}
+			if (isSlicingBackend()) {
+				ImGui::SliderInt("Iterations per frame", &sliceIterations, 100, 20000);
+				if (isSlicing()) {
+					ImGui::Text("Iterating: %d / %d", slicedIterations, maxIterations);
+				}
+			}
+		}
+
+		const char* formulas[static_cast<int>(Formula::Count)];
+		for (int i = 0; i < static_cast<int>(Formula::Count); ++i) {
+			formulas[i] = formulaName(static_cast<Formula>(i));
+		}
+		int formulaIndex = static_cast<int>(formula);
+		if (ImGui::Combo("Formula", &formulaIndex, formulas, static_cast<int>(Formula::Count))) {
+			formula = static_cast<Formula>(formulaIndex);
+			needsUpdate = true;
+		}
+
+		if (backend == RenderBackend::Cpu || (backend == RenderBackend::GpuShader && !timeSliced)) {
+			if (ImGui::Checkbox("Mirror symmetric views", &symmetry)) {
+				needsUpdate = true;
+			}
+			const int mirrored = backend == RenderBackend::Cpu ? shownCpuRenderer().getMirroredCount() : gpuMirror.getCopiedCount();
+			if (symmetry && mirrored > 0) {
+				ImGui::SameLine();
+				ImGui::Text("%d pixels mirrored", mirrored);
+			}
+		}
+
+		if (formula == Formula::Julia && ImGui::SliderFloat2("Julia C", reinterpret_cast<float*>(&juliaC), -2.0f, 2.0f)) {
+			needsUpdate = true;
+		}
+
+		if (formula == Formula::Custom) {
+			ImGui::InputText("Formula", customFormulaText, sizeof(customFormulaText));
+			if (ImGui::Button("Compile Formula")) {
+				stopRefinement();	// the background render reads the formula
+				if (customFormula.compile(customFormulaText, customFormulaError)) {
+					shadersDirty = true;
+					if (!updateShaders()) {
+						customFormulaError = "Generated shader failed to compile";
+					}
+				}
+				needsUpdate = true;
+			}
+			if (!customFormulaError.empty()) {
+				ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "%s", customFormulaError.c_str());
+			}
+			else if (customFormula.isValid()) {
+				ImGui::Text("%d instructions", customFormula.getInstructionCount());
+			}
+			const double pixel = viewport.getXRange() / WIDTH;
+			const double magnitude = std::max(std::max(std::abs(viewport.getXMin()), std::abs(viewport.getXMax())),
+				std::max(std::abs(viewport.getYMin()), std::abs(viewport.getYMax())));
+			if (PrecisionPlanner::precisionFor(PrecisionPlanner::requiredBits(pixel, magnitude, maxIterations)) > Precision::Double) {
+				ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "The view needs more than double, the most custom formulas run in; it may be wrong");
+			}
+		}
+	}
+
+	void drawResolutionControls() {
+		if (backend != RenderBackend::Cpu && (backend != RenderBackend::GpuShader || timeSliced)) {
+			return;
+		}
+		if (ImGui::Checkbox("Dynamic resolution", &dynamicResolution)) {
+			needsUpdate = true;
+		}
+		if (dynamicResolution) {
+			float budget = resolutionGovernor.getBudget();
+			if (ImGui::SliderFloat("Frame budget (ms)", &budget, 4.0f, 100.0f, "%.0f")) {
+				resolutionGovernor.setBudget(budget);
+			}
+			ImGui::Text("Scale while moving: %.0f%%%s", resolutionGovernor.getScale() * 100.0f, isRefining() ? ", refining" : "");
+		}
+	}
+
+	// Bakes the gradient stops into the lookup table and the palette texture. Nothing is
+	// iterated again; the cached field is just re-coloured.
+	void applyPalette() {
+		std::vector<GradientStop> sorted = paletteStops;
+		std::sort(sorted.begin(), sorted.end(), [](const GradientStop& a, const GradientStop& b) {
+			return a.position < b.position;
+		});
+		palette.build(sorted, colorScale);
+		paletteTexture.update(palette.getPixels());
+		needsRecolor = true;
+	}
+
+	// Builds the histogram from the field that is already on screen, without iterating.
+	void equalizeCachedField() {
+		if (backend == RenderBackend::Cpu) {
+			const FirstTouchVector<float>& iterations = shownCpuRenderer().getIterations();
+			histogram.build(iterations.data(), static_cast<int>(iterations.size()), maxIterations);
+		}
+		else if (backend == RenderBackend::Buddhabrot) {
+			const FirstTouchVector<float>& field = buddhabrot.getField();
+			histogram.build(field.data(), static_cast<int>(field.size()), maxIterations);
+		}
+		else {
+			equalizeGpuField();
+		}
+	}
+
+	// Counts the histogram of the GPU field and uploads its CDF. With compute shaders the
+	// bins are counted on the GPU and only they are read back; otherwise the whole field is.
+	// Only runs when the field changes, never for a recolour.
+	void equalizeGpuField() {
+		window.setActive(true);
+		updateShaders();	// the colouring mode may have changed since the last frame
+		if (fieldBinned || histogramProgram) {
+			if (!fieldBinned) {
+				countGpuField();
+			}
+			fieldBinned = false;
+			gpuBins.resize(gpuHistogram.getBinCount());
+			gpuHistogram.read(gpuBins.data());
+			histogram.setCounts(gpuBins.data(), maxIterations);
+			uploadCdf();
+			return;
+		}
+
+		const int pixelCount = WIDTH * HEIGHT;
+		gpuField.resize(pixelCount);
+		if (backend == RenderBackend::GpuCompute || isSlicingBackend()) {
+			if (backend == RenderBackend::GpuCompute) {
+				computeEngine.readValues(gpuField.data());
+			}
+			else {
+				iterationState.readValues(gpuField.data());
+			}
+			histogram.build(gpuField.data(), pixelCount, maxIterations);
+			uploadCdf();
+			return;
+		}
+
+		// A reduced-resolution field is only the bottom-left corner, which the image has at the
+		// bottom since it comes out top row first
+		sf::Image image = fieldTexture.getTexture().copyToImage();
+		const sf::Uint8* bytes = image.getPixelsPtr();
+		const int columns = fieldWidth();
+		const int rows = fieldHeight();
+		const int fieldCount = columns * rows;
+
+		ThreadPool::shared().parallelFor(rows, [&](int row, int) {
+			const sf::Uint8* p = bytes + static_cast<size_t>(HEIGHT - rows + row) * WIDTH * 4;
+			for (int column = 0; column < columns; ++column, p += 4) {
+				std::uint32_t bits = (std::uint32_t(p[0]) << 24) | (std::uint32_t(p[1]) << 16) | (std::uint32_t(p[2]) << 8) | p[3];
+				std::memcpy(&gpuField[static_cast<size_t>(row) * columns + column], &bits, sizeof(bits));
+			}
+		});
+
+		histogram.build(gpuField.data(), fieldCount, maxIterations);
+		uploadCdf();
+	}
+
+	// Runs histogram.comp over whichever field the colour pass reads.
+	void countGpuField() {
+		gpuHistogram.reset(maxIterations);
+		frameUniforms.update(frameParams());
+		if (isSlicingBackend()) {
+			iterationState.bindForColoring();
+			gpuHistogram.countField(histogramProgram, WIDTH, HEIGHT);
+		}
+		else if (backend == RenderBackend::GpuCompute) {
+			computeEngine.bindForColoring();
+			gpuHistogram.countField(histogramProgram, WIDTH, HEIGHT);
+		}
+		else {
+			// Bound on unit 0 and unbound again straight away, so SFML's cached binding stays right
+			GLint bound = 0;
+			glGetIntegerv(GL_TEXTURE_BINDING_2D, &bound);
+			glBindTexture(GL_TEXTURE_2D, fieldTexture.getTexture().getNativeHandle());
+			gpuHistogram.countField(histogramProgram, fieldWidth(), fieldHeight());
+			glBindTexture(GL_TEXTURE_2D, static_cast<GLuint>(bound));
+		}
+	}
+
+	// Packs the CDF into a texture the same way mandelbrot.frag packs the field.
+	void uploadCdf() {
+		const std::vector<float>& cdf = histogram.getCdf();
+		const unsigned rows = static_cast<unsigned>((cdf.size() + CDF_TEXTURE_WIDTH - 1) / CDF_TEXTURE_WIDTH);
+		if (cdfTexture.getSize().y != rows) {
+			cdfTexture.create(CDF_TEXTURE_WIDTH, rows);
+		}
+
+		cdfPixels.assign(static_cast<size_t>(CDF_TEXTURE_WIDTH) * rows * 4, 0);
+		for (size_t i = 0; i < cdf.size(); ++i) {
+			std::uint32_t bits;
+			std::memcpy(&bits, &cdf[i], sizeof(bits));
+			cdfPixels[i * 4 + 0] = static_cast<sf::Uint8>(bits >> 24);
+			cdfPixels[i * 4 + 1] = static_cast<sf::Uint8>(bits >> 16);
+			cdfPixels[i * 4 + 2] = static_cast<sf::Uint8>(bits >> 8);
+			cdfPixels[i * 4 + 3] = static_cast<sf::Uint8>(bits);
+		}
+		cdfTexture.update(cdfPixels.data());
+	}
+
+	void drawPaletteControls() {
+		if (!ImGui::CollapsingHeader("Palette")) {
+			return;
+		}
+
+		bool changed = false;
+		for (size_t i = 0; i < paletteStops.size(); ++i) {
+			ImGui::PushID(static_cast<int>(i));
+			changed |= ImGui::ColorEdit3("##color", reinterpret_cast<float*>(&paletteStops[i].color), ImGuiColorEditFlags_NoInputs);
+			ImGui::SameLine();
+			changed |= ImGui::SliderFloat("##position", &paletteStops[i].position, 0.0f, 1.0f);
+			if (paletteStops.size() > 2) {
+				ImGui::SameLine();
+				if (ImGui::Button("Remove")) {
+					paletteStops.erase(paletteStops.begin() + i);
+					changed = true;
+					ImGui::PopID();
+					break;
+				}
+			}
+			ImGui::PopID();
+		}
+
+		if (ImGui::Button("Add Stop")) {
+			sf::Color middle = palette.color(0.5f, 1);
+			paletteStops.push_back({ 0.5f, { middle.r / 255.0f, middle.g / 255.0f, middle.b / 255.0f } });
+			changed = true;
+		}
+		ImGui::SameLine();
+		if (ImGui::Button("Reset Palette")) {
+			paletteStops = defaultGradientStops();
+			changed = true;
+		}
+		if (changed) {
+			applyPalette();
+		}
+
+		if (ImGui::SliderFloat("Palette Offset", &paletteOffset, 0.0f, 1.0f)) {
+			needsRecolor = true;
+		}
+		ImGui::Checkbox("Cycle Palette", &cyclePalette);
+		ImGui::SliderFloat("Cycle Speed", &paletteCycleSpeed, -1.0f, 1.0f);
+	}
+
+	void drawZoomVideoControls() {
+		if (!ImGui::CollapsingHeader("Zoom Video")) {
+			return;
+		}
+
+		if (zoomCapture) {
+			if (zoomCapture->isComputingReference()) {
+				ImGui::Text("Computing the reference orbit...");
+			}
+			else {
+				ImGui::Text("Strip rows %d / %d", zoomCapture->getRowsRendered(), zoomCapture->getTotalRows());
+				ImGui::ProgressBar(zoomCapture->getProgress());
+			}
+			if (ImGui::Button("Cancel Capture")) {
+				zoomCapture.reset();
+			}
+			return;
+		}
+
+		ImGui::SliderFloat("Zoom Depth (log10)", &zoomVideoDepth, 1.0f, 2000.0f);
+		ImGui::InputInt("Frames", &zoomVideoFrames);
+		ImGui::InputInt("Angular Samples", &zoomVideoAngularSamples);
+		ImGui::SliderInt("Strip Rows Per Frame", &zoomVideoRowsPerFrame, 1, 1024);
+
+		const double centerX = viewport.getCenterX();
+		const double centerY = viewport.getCenterY();
+		if (ImGui::Button("Centre on Nucleus")) {
+			centerOnNucleus();
+		}
+		const bool onNucleus = nucleusPeriod > 0 && centerX == nucleusX && centerY == nucleusY;
+		if (onNucleus) {
+			ImGui::SameLine();
+			ImGui::Text("Period %d, reference of %d points instead of %d", nucleusPeriod, nucleusPeriod + 1, maxIterations + 1);
+		}
+
+		if (ImGui::Button("Capture Zoom Video")) {
+			ExpMapSettings settings;
+			settings.centerX = viewport.getCenterX();
+			settings.centerY = viewport.getCenterY();
+			settings.startHalfWidth = viewport.getXRange() * 0.5;
+			settings.zoomDepth = zoomVideoDepth;
+			settings.frameCount = zoomVideoFrames;
+			settings.angularSamples = zoomVideoAngularSamples;
+			settings.maxIterations = maxIterations;
+			settings.period = onNucleus ? nucleusPeriod : 0;
+			settings.palette = palette;
+			zoomCapture = std::make_unique<ExpMapCapture>(settings);
+		}
+	}
+
+	// Moves the view onto the lowest-period nucleus inside it, keeping the zoom. A zoom
+	// video started there zooms into that minibrot with a one-period reference orbit.
+	void centerOnNucleus() {
+		const double centerX = viewport.getCenterX();
+		const double centerY = viewport.getCenterY();
+		const double radius = viewport.getXRange() * 0.5;
+		const int period = findNucleusPeriod(centerX, centerY, radius, maxIterations);
+		double x = centerX;
+		double y = centerY;
+		// Newton can run off to another nucleus of the same period outside the view
+		if (period == 0 || !refineNucleus(x, y, period) || std::hypot(x - centerX, y - centerY) > radius) {
+			nucleusPeriod = 0;
+			return;
+		}
+		nucleusPeriod = period;
+		nucleusX = x;
+		nucleusY = y;
+		viewport.frame(x, y, viewport.getXRange(), viewport.getYRange());
+		needsUpdate = true;
+	}
+
 	void handleEvents(const sf::Event& event) {
 			ImGui::SFML::ProcessEvent(event);
 			if (event.type == sf::Event::Closed) {
@@ -206,25 +1185,492 @@ private:
 
 
 	void renderMandelbrot() {
+		if (needsUpdate) {
+			stopRefinement();
+			changeClock.restart();
+		}
+		if (autoIterations && needsUpdate) {
+			KernelParams params;
+			params.juliaX = juliaC.x;
+			params.juliaY = juliaC.y;
+			maxIterations = iterationEstimator.estimate(viewport.getCenterX(), viewport.getCenterY(), viewport.getXRange(), viewport.getYRange(),
+				formula, params, &customFormula);
+		}
 
+		if (backend == RenderBackend::Cpu) {
+			renderCpu();
+			return;
+		}
+		if (backend == RenderBackend::Buddhabrot) {
+			renderBuddhabrot();
+			return;
+		}
 
-		mandelbrotShader.setUniform("viewportXMin", static_cast<float>(viewport.getXMin()));
-		mandelbrotShader.setUniform("viewportXMax", static_cast<float>(viewport.getXMax()));
-		mandelbrotShader.setUniform("viewportYMin", static_cast<float>(viewport.getYMin()));
-		mandelbrotShader.setUniform("viewportYMax", static_cast<float>(viewport.getYMax()));
-		mandelbrotShader.setUniform("width", static_cast<float>(WIDTH));
-		mandelbrotShader.setUniform("height", static_cast<float>(HEIGHT));
-		mandelbrotShader.setUniform("maxIterations", maxIterations);
-		mandelbrotShader.setUniform("colorScale", sf::Glsl::Vec3(colorScale.x, colorScale.y, colorScale.z));
+		updateShaders();
+		if (!isScalable()) {
+			gpuFieldScale = 1.0f;
+		}
 
-		sf::RectangleShape fullscreenQuad(sf::Vector2f(WIDTH, HEIGHT));
-		window.clear(sf::Color::Red);
-		window.draw(fullscreenQuad, &mandelbrotShader);
+		// Iteration pass, only when the view or the formula changed, or to redo a
+		// reduced-resolution frame at full resolution
+		const bool refine = !needsUpdate && gpuFieldScale < 1.0f && refineDue();
+		// Anti-aliasing samples are only taken on frames that change nothing else
+		const bool sample = !needsUpdate && !refine && !needsRecolor && isAccumulating();
+		bool restartMean = needsRecolor;
+		if (isSlicingBackend()) {
+			iterateSlice();
+		}
+		else if (sample) {
+			temporalAccumulator.nextOffset(sampleOffset.x, sampleOffset.y);
+			iterateField();
+		}
+		else if (needsRecolor && isAntialiasing() && sampleOffset != sf::Vector2f(0.0f, 0.0f)) {
+			// The mean starts over from the pixel centre, not from the last jittered field
+			sampleOffset = sf::Vector2f(0.0f, 0.0f);
+			iterateField();
+		}
+		else if (needsUpdate || refine) {
+			sampleOffset = sf::Vector2f(0.0f, 0.0f);
+			if (backend == RenderBackend::Hybrid) {
+				iterateHybrid();
+			}
+			else {
+				gpuFieldScale = needsUpdate && isScalable() ? resolutionGovernor.getScale() : 1.0f;
+				iterateField();
+			}
+			needsUpdate = false;
+			restartMean = true;
+
+			if (coloringMode == ColoringMode::Histogram) {
+				equalizeGpuField();
+			}
+		}
+
+		// Colour pass, every frame
+		window.setActive(true);
+		frameUniforms.update(frameParams());
+		gl.activeTexture(GlEnum::TEXTURE0 + PALETTE_TEXTURE_UNIT);
+		glBindTexture(GL_TEXTURE_2D, paletteTexture.getNativeHandle());
+		gl.activeTexture(GlEnum::TEXTURE0 + CDF_TEXTURE_UNIT);
+		glBindTexture(GL_TEXTURE_2D, cdfTexture.getNativeHandle());
+		gl.activeTexture(GlEnum::TEXTURE0);	// SFML assumes unit 0 is active
+		if (isAntialiasing()) {
+			if (restartMean) {
+				temporalAccumulator.reset();
+			}
+			if (sample || temporalAccumulator.getSampleCount() == 0) {
+				sampleWeight = temporalAccumulator.nextWeight();
+				frameUniforms.update(frameParams());
+				sf::Texture::bind(&fieldTexture.getTexture());
+				temporalAccumulator.accumulate(colorizeProgram);
+				sampleWeight = 1.0f;
+			}
+			temporalAccumulator.present();
+			window.resetGLStates();
+			needsRecolor = false;
+			return;
+		}
+		gl.useProgram(colorizeProgram);
+		if (isSlicingBackend()) {
+			iterationState.bindForColoring();
+			window.draw(fullscreenQuad);
+		}
+		else if (backend == RenderBackend::GpuCompute) {
+			computeEngine.bindForColoring();
+			window.draw(fullscreenQuad);
+		}
+		else {
+			window.draw(fieldSprite);
+		}
+		gl.useProgram(0);
+		needsRecolor = false;
+	}
+
+	// One complete iteration pass of the fragment or compute engine. The programs are not
+	// sf::Shaders, so they are bound here and SFML draws with whatever is current.
+	void iterateField() {
+		if (backend == RenderBackend::GpuCompute) {
+			window.setActive(true);
+			frameUniforms.update(frameParams());
+			fieldBinned = activeVariant.equalize;
+			if (fieldBinned) {
+				gpuHistogram.reset(maxIterations);
+			}
+			computeEngine.render(mandelbrotProgram, maxIterations);
+			return;
+		}
+
+		fieldTexture.setActive(true);
+		frameUniforms.update(frameParams());
+		if (gpuFieldScale < 1.0f) {
+			scaledQuad.setSize(sf::Vector2f(static_cast<float>(fieldWidth()), static_cast<float>(fieldHeight())));
+			scaledQuad.setPosition(0.0f, static_cast<float>(HEIGHT - fieldHeight()));
+		}
+		planGpuMirror();
+
+		// The field is packed float bits, so it must be written without blending.
+		iterationTimer.begin(gpuFieldScale);
+		gl.useProgram(mandelbrotProgram);
+		if (gpuMirror.isActive()) {
+			fieldTexture.draw(mirrorQuads, sf::RenderStates(sf::BlendNone));
+		}
+		else {
+			fieldTexture.draw(gpuFieldScale < 1.0f ? scaledQuad : fullscreenQuad, sf::RenderStates(sf::BlendNone));
+		}
+		gl.useProgram(0);
+		if (gpuMirror.isActive()) {
+			mirrorGpuField();
+		}
+		iterationTimer.end();
+		fieldTexture.display();
+
+		// The governor goes by the passes the GPU has finished, usually the previous frame's
+		double seconds, scale;
+		while (iterationTimer.poll(seconds, scale)) {
+			resolutionGovernor.record(static_cast<float>(seconds * 1000.0), static_cast<float>(scale));
+		}
+	}
+
+	// Plans the mirror for the field iterateField is about to draw and collects the rest of the
+	// field in mirrorQuads. Jittered anti-aliasing samples are off the pixel centres, so
+	// their images are not pixels.
+	void planGpuMirror() {
+		gpuMirror.clear();
+		if (symmetry && sampleOffset == sf::Vector2f(0.0f, 0.0f)) {
+			gpuMirror.plan(formula, viewport.getCenterX(), viewport.getCenterY(), viewport.getXRange(), viewport.getYRange(), fieldWidth(), fieldHeight());
+		}
+		if (!gpuMirror.isActive()) {
+			return;
+		}
+
+		// Field rows count from the top of the field, which sits at the bottom of fieldTexture
+		const float top = static_cast<float>(HEIGHT - fieldHeight());
+		const float columns = static_cast<float>(fieldWidth());
+		const float row0 = static_cast<float>(gpuMirror.getRow0());
+		const float row1 = static_cast<float>(gpuMirror.getRow1());
+		const float column0 = static_cast<float>(gpuMirror.getColumn0());
+		const float column1 = static_cast<float>(gpuMirror.getColumn1());
+		mirrorQuads.clear();
+		auto addRect = [this](float left, float upper, float right, float lower) {
+			if (left < right && upper < lower) {
+				mirrorQuads.append(sf::Vertex(sf::Vector2f(left, upper)));
+				mirrorQuads.append(sf::Vertex(sf::Vector2f(right, upper)));
+				mirrorQuads.append(sf::Vertex(sf::Vector2f(right, lower)));
+				mirrorQuads.append(sf::Vertex(sf::Vector2f(left, lower)));
+			}
+		};
+		addRect(0.0f, top, columns, top + row0);
+		addRect(0.0f, top + row1, columns, static_cast<float>(HEIGHT));
+		addRect(0.0f, top + row0, column0, top + row1);
+		addRect(column1, top + row0, columns, top + row1);
+	}
+
+	// Copies the mirror images into the rectangle planGpuMirror left out, flipped by the blit
+	// itself. Image and copy never overlap, so fieldTexture's framebuffer can be both ends.
+	// Texture rows count up from the bottom, where field row r is fieldHeight() - 1 - r.
+	void mirrorGpuField() {
+		const int rows = fieldHeight();
+		const int row0 = gpuMirror.getRow0();
+		const int row1 = gpuMirror.getRow1();
+		const int column0 = gpuMirror.getColumn0();
+		const int column1 = gpuMirror.getColumn1();
+		const int sourceBottom = rows - 1 - gpuMirror.mirrorRow(row0);
+		const int sourceTop = rows - gpuMirror.mirrorRow(row1 - 1);
+		if (gpuMirror.isHalfTurn()) {
+			gl.blitFramebuffer(gpuMirror.mirrorColumn(column1 - 1), sourceBottom, gpuMirror.mirrorColumn(column0) + 1, sourceTop,
+				column1, rows - row0, column0, rows - row1, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+		}
+		else {
+			gl.blitFramebuffer(column0, sourceBottom, column1, sourceTop, column0, rows - row0, column1, rows - row1, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+		}
+	}
+
+	// One frame over both processors. The GPU tiles are queued first, the CPU renders its
+	// tiles while the GPU works through them, and then the CPU tiles are uploaded into
+	// fieldTexture, so the colour pass and the histogram see a single field. Both sides are
+	// timed for the next frame's split.
+	void iterateHybrid() {
+		// The CPU runs custom formulas in double only, so deeper tiles gain nothing there
+		const Precision gpuLimit = formula == Formula::Custom ? Precision::BigFloat
+			: activeVariant.doublePrecision ? Precision::Double : Precision::Float;
+		hybridScheduler.schedule(viewport.getCenterX(), viewport.getCenterY(), viewport.getXRange(), viewport.getYRange(), maxIterations,
+			gpuLimit, WIDTH, HEIGHT, CpuRenderer::TILE_SIZE);
+		const int tilesX = hybridScheduler.getTilesX();
+		const int tileCount = tilesX * hybridScheduler.getTilesY();
+		const int tileSize = hybridScheduler.getTileSize();
+
+		gpuTileQuads.clear();
+		for (int tile = 0; tile < tileCount; ++tile) {
+			if (hybridScheduler.isGpuTile(tile)) {
+				const int x0 = (tile % tilesX) * tileSize;
+				const int y0 = (tile / tilesX) * tileSize;
+				const float left = static_cast<float>(x0);
+				const float top = static_cast<float>(y0);
+				const float right = static_cast<float>(std::min(x0 + tileSize, WIDTH));
+				const float bottom = static_cast<float>(std::min(y0 + tileSize, HEIGHT));
+				gpuTileQuads.append(sf::Vertex(sf::Vector2f(left, top)));
+				gpuTileQuads.append(sf::Vertex(sf::Vector2f(right, top)));
+				gpuTileQuads.append(sf::Vertex(sf::Vector2f(right, bottom)));
+				gpuTileQuads.append(sf::Vertex(sf::Vector2f(left, bottom)));
+			}
+		}
+
+		const bool gpuTiles = gpuTileQuads.getVertexCount() > 0;
+		fieldTexture.setActive(true);
+		if (gpuTiles) {
+			frameUniforms.update(frameParams());
+			hybridTimer.begin(hybridScheduler.getGpuTileCount());
+			gl.useProgram(mandelbrotProgram);
+			fieldTexture.draw(gpuTileQuads, sf::RenderStates(sf::BlendNone));
+			gl.useProgram(0);
+			hybridTimer.end();
+			glFlush();	// the GPU starts now, not when the CPU is done
+		}
+
+		const KernelParams params = cpuParams();
+		cpuRenderer.setTileIterationCap(0);
+		cpuRenderer.setMixedPrecision(cpuMixedPrecision);
+		cpuRenderer.setTileMask(hybridScheduler.getCpuTiles());
+		sf::Clock cpuClock;
+		cpuRenderer.render(viewport.getCenterX(), viewport.getCenterY(), viewport.getXRange(), viewport.getYRange(), formula, params, &customFormula);
+		hybridScheduler.measureCpu(cpuRenderer.getRenderedTileCount(), cpuClock.getElapsedTime().asSeconds());
+
+		uploadCpuTiles();
+		fieldTexture.display();
+		// The split follows the GPU tiles that have finished, usually the previous frame's
+		double seconds, tiles;
+		while (hybridTimer.poll(seconds, tiles)) {
+			hybridScheduler.measureGpu(static_cast<int>(tiles), seconds);
+		}
+	}
+
+	// Packs the CPU field the way mandelbrot.frag packs it and writes the CPU tiles into
+	// fieldTexture, one run of neighbouring tiles at a time. Texture rows start at the bottom.
+	void uploadCpuTiles() {
+		const FirstTouchVector<float>& iterations = cpuRenderer.getIterations();
+		ThreadPool::shared().parallelFor(HEIGHT, [&](int y, int) {
+			const float* values = &iterations[static_cast<size_t>(y) * WIDTH];
+			sf::Uint8* row = &cpuTilePixels[static_cast<size_t>(HEIGHT - 1 - y) * WIDTH * 4];
+			for (int x = 0; x < WIDTH; ++x) {
+				std::uint32_t bits;
+				std::memcpy(&bits, &values[x], sizeof(bits));
+				row[x * 4 + 0] = static_cast<sf::Uint8>(bits >> 24);
+				row[x * 4 + 1] = static_cast<sf::Uint8>(bits >> 16);
+				row[x * 4 + 2] = static_cast<sf::Uint8>(bits >> 8);
+				row[x * 4 + 3] = static_cast<sf::Uint8>(bits);
+			}
+		});
+
+		const int tilesX = hybridScheduler.getTilesX();
+		const int tileSize = hybridScheduler.getTileSize();
+		sf::Texture::bind(&fieldTexture.getTexture());
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glPixelStorei(GL_UNPACK_ROW_LENGTH, WIDTH);
+		for (int ty = 0; ty < hybridScheduler.getTilesY(); ++ty) {
+			const int top = ty * tileSize;
+			const int rows = std::min(tileSize, HEIGHT - top);
+			for (int tx = 0; tx < tilesX;) {
+				if (hybridScheduler.isGpuTile(ty * tilesX + tx)) {
+					++tx;
+					continue;
+				}
+				const int first = tx;
+				while (tx < tilesX && !hybridScheduler.isGpuTile(ty * tilesX + tx)) {
+					++tx;
+				}
+				const int left = first * tileSize;
+				const int columns = std::min(tx * tileSize, WIDTH) - left;
+				glPixelStorei(GL_UNPACK_SKIP_PIXELS, left);
+				glPixelStorei(GL_UNPACK_SKIP_ROWS, HEIGHT - top - rows);
+				glTexSubImage2D(GL_TEXTURE_2D, 0, left, HEIGHT - top - rows, columns, rows, GL_RGBA, GL_UNSIGNED_BYTE, cpuTilePixels.data());
+			}
+		}
+		// SFML expects the defaults back
+		glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
+		glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
+		glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		sf::Texture::bind(nullptr);
+	}
+
+	// A view change restarts every pixel; after that each frame advances the unfinished
+	// ones by sliceIterations, so a deep render converges over several frames instead of
+	// stalling one. Finished pixels are only copied.
+	void iterateSlice() {
+		window.setActive(true);
+		if (needsUpdate) {
+			iterationState.reset();
+			slicedIterations = 0;
+			needsUpdate = false;
+		}
+		if (slicedIterations >= maxIterations) {
+			return;
+		}
+
+		frameUniforms.update(frameParams());
+		iterationState.step(mandelbrotProgram);
+		slicedIterations += sliceIterations;
+		if (slicedIterations >= maxIterations && coloringMode == ColoringMode::Histogram) {
+			equalizeGpuField();
+		}
+	}
+
+	KernelParams cpuParams() const {
+		KernelParams params;
+		params.maxIterations = maxIterations;
+		params.juliaX = juliaC.x;
+		params.juliaY = juliaC.y;
+		params.checkpointed = checkpointed;
+		return params;
+	}
+
+	void configureCpu(CpuRenderer& renderer) const {
+		// Auto mode lets tiles on an unresolved boundary go past the estimate
+		renderer.setTileIterationCap(autoIterations ? std::min(maxIterations * AUTO_TILE_FACTOR, IterationEstimator::MAX_ITERATIONS) : 0);
+		renderer.setMixedPrecision(cpuMixedPrecision);
+		renderer.setSymmetry(symmetry);
+		renderer.setTileMask({});
+	}
+
+	// The full-resolution frame on another thread. Nothing else may use cpuRenderer until it
+	// has finished or stopRefinement has cancelled it; loops that other code runs on the
+	// thread pool meanwhile stay on their own thread.
+	void startRefinement() {
+		configureCpu(cpuRenderer);
+		const KernelParams params = cpuParams();
+		const double centerX = viewport.getCenterX();
+		const double centerY = viewport.getCenterY();
+		const double xRange = viewport.getXRange();
+		const double yRange = viewport.getYRange();
+		const Formula refinedFormula = formula;
+		refinement = std::async(std::launch::async, [=, this] {
+			cpuRenderer.render(centerX, centerY, xRange, yRange, refinedFormula, params, &customFormula);
+		});
+	}
+
+	void renderCpu() {
+		if (needsUpdate) {
+			// While the view changes, frames that would go over the budget come from cpuPreview
+			const bool preview = isScalable() && resolutionGovernor.getScale() < 1.0f;
+			CpuRenderer& renderer = preview ? cpuPreview : cpuRenderer;
+			if (preview && (cpuPreview.getWidth() != resolutionGovernor.scaled(WIDTH) || cpuPreview.getHeight() != resolutionGovernor.scaled(HEIGHT))) {
+				cpuPreview.resize(resolutionGovernor.scaled(WIDTH), resolutionGovernor.scaled(HEIGHT));
+			}
+			configureCpu(renderer);
+			sf::Clock clock;
+			renderer.render(viewport.getCenterX(), viewport.getCenterY(), viewport.getXRange(), viewport.getYRange(), formula, cpuParams(), &customFormula,
+				coloringMode == ColoringMode::Histogram ? &histogram : nullptr);
+			// Resumed frames say nothing about what a new view costs
+			if (renderer.getRenderedTileCount() > 0) {
+				resolutionGovernor.record(clock.getElapsedTime().asSeconds() * 1000.0f, static_cast<float>(renderer.getWidth()) / WIDTH);
+			}
+			showingPreview = preview;
+			needsUpdate = false;
+			needsRecolor = true;
+		}
+		else if (showingPreview && !refinement.valid() && refineDue()) {
+			startRefinement();
+		}
+
+		if (refinement.valid() && refinement.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+			refinement.get();
+			showingPreview = false;
+			if (coloringMode == ColoringMode::Histogram) {
+				equalizeCachedField();
+			}
+			needsRecolor = true;
+		}
+
+		if (needsRecolor) {
+			const CpuRenderer& shown = shownCpuRenderer();
+			colorizeCpuField(shown.getIterations().data(), shown.getWidth(), shown.getHeight());
+			needsRecolor = false;
+		}
+
+		window.draw(cpuSprite);
+		// The map is drawn in full-resolution tiles
+		if (showPrecisionMap && !showingPreview) {
+			drawPrecisionMap();
+		}
+	}
+
+	// Colours a field computed on the CPU into cpuTexture and stretches cpuSprite over the window
+	void colorizeCpuField(const float* values, int rowWidth, int rows) {
+		const bool equalize = coloringMode == ColoringMode::Histogram;
+		const float* cdf = equalize ? histogram.getCdf().data() : nullptr;
+		const int cdfBins = equalize ? histogram.getBinCount() : 0;
+		// While a refinement holds the pool this runs on the calling thread alone
+		ThreadPool::shared().parallelFor(rows, [&](int y, int) {
+			size_t offset = static_cast<size_t>(y) * rowWidth;
+			palette.colorize(&values[offset], rowWidth, maxIterations, paletteOffset, &cpuPixels[offset * 4], cdf, cdfBins);
+		});
+		cpuTexture.update(cpuPixels.data(), rowWidth, rows, 0, 0);
+		cpuSprite.setTextureRect(sf::IntRect(0, 0, rowWidth, rows));
+		cpuSprite.setScale(static_cast<float>(WIDTH) / rowWidth, static_cast<float>(HEIGHT) / rows);
+	}
+
+	// Adds a frame's worth of orbits to the density and shows it. A changed view starts over
+	// inside accumulate. The batch follows the measured time, so a deep limit or a formula
+	// whose orbits rarely escape still leaves the window responsive.
+	void renderBuddhabrot() {
+		if (buddhabrot.getWidth() != WIDTH || buddhabrot.getHeight() != HEIGHT) {
+			buddhabrot.resize(WIDTH, HEIGHT);
+		}
+		if (needsUpdate || isTracing()) {
+			sf::Clock clock;
+			buddhabrot.accumulate(viewport.getCenterX(), viewport.getCenterY(), viewport.getXRange(), viewport.getYRange(), formula, cpuParams(),
+				buddhabrotBatch);
+			const float milliseconds = std::max(clock.getElapsedTime().asSeconds() * 1000.0f, 0.1f);
+			const float growth = std::clamp(BUDDHABROT_FRAME_MILLISECONDS / milliseconds, 1.0f / BUDDHABROT_BATCH_GROWTH, BUDDHABROT_BATCH_GROWTH);
+			buddhabrotBatch = std::clamp(static_cast<int>(buddhabrotBatch * growth), 1000, 100000000);
+			if (coloringMode == ColoringMode::Histogram) {
+				equalizeCachedField();
+			}
+			needsUpdate = false;
+			needsRecolor = true;
+		}
+
+		if (needsRecolor) {
+			colorizeCpuField(buddhabrot.getField().data(), buddhabrot.getWidth(), buddhabrot.getHeight());
+			needsRecolor = false;
+		}
+		window.draw(cpuSprite);
+	}
+
+	// Tints every tile with the precision the planner chose for it: green float, yellow
+	// double, blue fixed128, orange double-double, red perturbed from a BigFixed reference.
+	void drawPrecisionMap() {
+		static const sf::Color COLORS[] = { sf::Color(0, 255, 0, 60), sf::Color(255, 255, 0, 60), sf::Color(0, 128, 255, 80),
+			sf::Color(255, 128, 0, 80), sf::Color(255, 0, 0, 100) };
+		const PrecisionPlanner& plan = cpuRenderer.getPrecisionPlan();
+		const float tileSize = static_cast<float>(plan.getTileSize());
+		precisionMap.resize(static_cast<size_t>(plan.getTilesX()) * plan.getTilesY() * 4);
+		for (int ty = 0; ty < plan.getTilesY(); ++ty) {
+			for (int tx = 0; tx < plan.getTilesX(); ++tx) {
+				const int tile = ty * plan.getTilesX() + tx;
+				const sf::Color color = COLORS[static_cast<int>(plan.getTile(tile))];
+				// Inset by a pixel so the tile edges show
+				const float left = tx * tileSize + 1.0f;
+				const float top = ty * tileSize + 1.0f;
+				const float right = left + tileSize - 2.0f;
+				const float bottom = top + tileSize - 2.0f;
+				sf::Vertex* quad = &precisionMap[static_cast<size_t>(tile) * 4];
+				quad[0] = sf::Vertex(sf::Vector2f(left, top), color);
+				quad[1] = sf::Vertex(sf::Vector2f(right, top), color);
+				quad[2] = sf::Vertex(sf::Vector2f(right, bottom), color);
+				quad[3] = sf::Vertex(sf::Vector2f(left, bottom), color);
+			}
+		}
+		window.draw(precisionMap);
 	}
 };
 
-int main() {
+int main(int argc, char** argv) {
 	App app;
+	if (argc > 1 && std::strcmp(argv[1], "--benchmark") == 0) {
+		app.benchmark();
+		return app.checkSteadyAllocations() ? 0 : 1;
+	}
 	app.run();
 	return 0;
 }
\ No newline at end of file
@@ -1,71 +1,79 @@
 #version 330 core
 
-// Uniforms that you set in your C++ code
-// Uniforms that you set in your C++ code
-uniform float viewportXMin;
-uniform float viewportXMax;
-uniform float viewportYMin;
-uniform float viewportYMax;
-uniform float width;
-uniform float height;
-uniform int maxIterations;
-uniform vec3 colorScale;
+// Fragment iteration pass, one invocation per pixel. Besides the formula variants listed
+// in formula.glsl:
+//   TIME_SLICED            advance the state in IterationState by iterationBudget steps
+//                          instead of writing the packed field in one go
+#include "formula.glsl"
 
+#ifdef TIME_SLICED
+uniform sampler2D previousState;
+uniform sampler2D previousStateLow;
+
+layout(location = 0) out vec4 state;
+#ifdef PRECISION_DOUBLE
+layout(location = 1) out vec4 stateLow;
+#endif
+#else
 out vec4 color;
+#endif
 
-// Function to map the current pixel to a point in the Mandelbrot set
-vec2 mapToMandelbrot(float x, float y) {
-    float xMapped = mix(viewportXMin, viewportXMax, x / width);
-    float yMapped = mix(viewportYMin, viewportYMax, y / height);
-    return vec2(xMapped, yMapped);
+// The iteration pass only produces the escape value; colorize.frag turns it into a colour.
+// The float is stored bit for bit in the four 8-bit channels of the render target, so the
+// field survives exactly and can be re-coloured without iterating again.
+vec4 packFloat(float value) {
+    uint bits = floatBitsToUint(value);
+    return vec4(uvec4(bits >> 24u, bits >> 16u, bits >> 8u, bits) & 0xFFu) / 255.0;
 }
 
-vec3 getGradientColor(float norm) {
-    vec3 gradientColor;
-    if (norm < 0.25) {
-        gradientColor = mix(vec3(0.5, 0.0, 0.1), vec3(1.0, 0.8, 0.0), norm * 4.0);
-    } else if (norm < 0.5) {
-        gradientColor = mix(vec3(1.0, 0.8, 0.0), vec3(1.0, 0.5, 0.0), (norm - 0.25) * 4.0);
-    } else if (norm < 0.75) {
-        gradientColor = mix(vec3(1.0, 0.5, 0.0), vec3(1.0, 0.4, 0.4), (norm - 0.5) * 4.0);
+#ifdef TIME_SLICED
+void main() {
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    vec4 previous = texelFetch(previousState, pixel, 0);
+#ifdef PRECISION_DOUBLE
+    stateLow = vec4(0.0);
+#endif
+    if (previous.a < 0.0) {
+        state = previous;   // finished in an earlier slice
+        return;
+    }
+
+    complex z;
+    complex c;
+    startOrbit(gl_FragCoord.xy, z, c);
+    int iterations = int(previous.b);
+    if (iterations > 0) {
+        z = complex(previous.xy);
+#ifdef PRECISION_DOUBLE
+        z += complex(texelFetch(previousStateLow, pixel, 0).xy);
+#endif
+    }
+    float minDistance = previous.a;
+
+    if (iterate(z, c, iterations, minDistance, min(iterations + iterationBudget, maxIterations))) {
+        state = vec4(escapeValue(iterations, minDistance), 0.0, 0.0, -1.0);
+    } else if (iterations == maxIterations) {
+        state = vec4(-1.0, 0.0, 0.0, -1.0); // Never escaped
     } else {
-        gradientColor = mix(vec3(1.0, 0.4, 0.4), vec3(0.5, 0.0, 0.1), (norm - 0.75) * 4.0);
+        vec2 high = vec2(z);
+        state = vec4(high, float(iterations), minDistance);
+#ifdef PRECISION_DOUBLE
+        stateLow = vec4(vec2(z - complex(high)), 0.0, 0.0);
+#endif
     }
-    gradientColor *= colorScale; 
-    
-    return gradientColor;
 }
-
+#else
 void main() {
-    // Get the coordinates of the current pixel
-    vec2 c = mapToMandelbrot(gl_FragCoord.x, gl_FragCoord.y);
-    vec2 z = vec2(0.0, 0.0);
+    complex z;
+    complex c;
+    startOrbit(gl_FragCoord.xy + sampleOffset, z, c);
     int iterations = 0;
     float minDistance = 1000.0;
 
-    // Mandelbrot iteration loop
-    for (int i = 0; i < maxIterations; ++i) {
-        float x = (z.x * z.x - z.y * z.y) + c.x;
-        float y = (2.0 * z.x * z.y) + c.y;
-
-        z = vec2(x, y);
-
-        float dist = length(z);
-        if (dist > 2.0) {
-            break;
-        }
-        
-        // Update the minimum distance for orbit trapping
-        minDistance = min(minDistance, dist);
-
-        iterations++;
-    }
-
-    if (iterations == maxIterations) {
-        color = vec4(0.0, 0.0, 0.0, 1.0); // Green for pixels inside the Mandelbrot set
+    if (iterate(z, c, iterations, minDistance, maxIterations)) {
+        color = packFloat(escapeValue(iterations, minDistance));
     } else {
-        float norm = (float(iterations) + 1.0 - log(log(minDistance + 2.0))) / float(maxIterations);
-        vec3 gradientColor = getGradientColor(norm);
-        color = vec4(gradientColor, 1.0); 
+        color = packFloat(-1.0); // Never escaped
     }
-}
\ No newline at end of file
+}
+#endif